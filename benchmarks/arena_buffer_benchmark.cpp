@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+#include <replay_buffer/arena_buffer.h>
+#include <replay_buffer/circular_buffer.h>
+
+#include <vector>
+
+// Compares the arena against the per-record heap allocation it replaces:
+// a CircularBuffer of std::vector<float> payloads.
+
+static void BM_ArenaBufferAdd(benchmark::State& state) {
+  // access first parameter
+  const size_t payload_size = state.range(0);
+  replay_buffer::ArenaBuffer<float> buffer(1000 * payload_size *
+                                           sizeof(float));
+  const std::vector<float> payload(payload_size, 1.0f);
+
+  for (auto run : state) {
+    buffer.add(payload);
+  }
+  state.SetBytesProcessed(state.iterations() * payload_size * sizeof(float));
+}
+
+static void BM_ArenaBufferSample(benchmark::State& state) {
+  // access first parameter
+  const size_t payload_size = state.range(0);
+  replay_buffer::ArenaBuffer<float> buffer(1000 * payload_size *
+                                           sizeof(float));
+  const std::vector<float> payload(payload_size, 1.0f);
+  for (int i = 0; i < 1000; ++i) {
+    buffer.add(payload);
+  }
+
+  for (auto run : state) {
+    float sum = 0.0f;
+    for (const auto& record : buffer.sample(32)) {
+      sum += record[0];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+static void BM_CircularBufferOfVectorsAdd(benchmark::State& state) {
+  // access first parameter
+  const size_t payload_size = state.range(0);
+  replay_buffer::CircularBuffer<std::vector<float>> buffer(1000);
+
+  for (auto run : state) {
+    // Actors hand over a freshly built observation each step
+    buffer.add(std::vector<float>(payload_size, 1.0f));
+  }
+  state.SetBytesProcessed(state.iterations() * payload_size * sizeof(float));
+}
+
+static void BM_CircularBufferOfVectorsSample(benchmark::State& state) {
+  // access first parameter
+  const size_t payload_size = state.range(0);
+  replay_buffer::CircularBuffer<std::vector<float>> buffer(1000);
+  for (int i = 0; i < 1000; ++i) {
+    buffer.add(std::vector<float>(payload_size, 1.0f));
+  }
+
+  for (auto run : state) {
+    float sum = 0.0f;
+    for (const auto& record : buffer.sample(32)) {
+      sum += record[0];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+BENCHMARK(BM_ArenaBufferAdd)->Arg(17)->Arg(1024)->Arg(28224);
+BENCHMARK(BM_ArenaBufferSample)->Arg(17)->Arg(1024)->Arg(28224);
+BENCHMARK(BM_CircularBufferOfVectorsAdd)->Arg(17)->Arg(1024)->Arg(28224);
+BENCHMARK(BM_CircularBufferOfVectorsSample)->Arg(17)->Arg(1024)->Arg(28224);
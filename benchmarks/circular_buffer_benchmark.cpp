@@ -1,5 +1,14 @@
 #include <benchmark/benchmark.h>
 #include <replay_buffer/circular_buffer.h>
+#include <replay_buffer/rate_limiter.h>
+#include <replay_buffer/staging_buffer.h>
+#include <replay_buffer/static_circular_buffer.h>
+#include <replay_buffer/thread_pool.h>
+
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
 static void BM_CircularBufferAdd(benchmark::State& state) {
   // access first parameter
@@ -15,6 +24,102 @@ static void BM_CircularBufferAdd(benchmark::State& state) {
   }
 }
 
+// Actors typically send a step's worth of transitions at once; compare one
+// add() per item with a single add_batch() (state.range(1) items per call).
+static void BM_CircularBufferAddLoop(benchmark::State& state) {
+  replay_buffer::CircularBuffer<int> buffer(state.range(0));
+  const std::vector<int> batch(state.range(1), 1);
+
+  for (auto run : state) {
+    for (int item : batch) {
+      buffer.add(item);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+static void BM_CircularBufferAddBatch(benchmark::State& state) {
+  replay_buffer::CircularBuffer<int> buffer(state.range(0));
+  const std::vector<int> batch(state.range(1), 1);
+
+  for (auto run : state) {
+    buffer.add_batch(batch);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+// Heap-backed payloads, where copying costs an allocation per item
+static void BM_CircularBufferAddCopyVector(benchmark::State& state) {
+  replay_buffer::CircularBuffer<std::vector<float>> buffer(1000);
+  const std::vector<float> item(state.range(0), 1.0f);
+
+  for (auto run : state) {
+    std::vector<float> produced = item;
+    buffer.add(produced);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_CircularBufferAddMoveVector(benchmark::State& state) {
+  replay_buffer::CircularBuffer<std::vector<float>> buffer(1000);
+  const std::vector<float> item(state.range(0), 1.0f);
+
+  for (auto run : state) {
+    std::vector<float> produced = item;
+    buffer.add(std::move(produced));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Large offline-RL batches: state.range(1) pool workers besides the caller,
+// 0 meaning the serial path
+static void BM_CircularBufferSampleParallel(benchmark::State& state) {
+  replay_buffer::CircularBuffer<int> buffer(1000000);
+  for (int i = 0; i < 1000000; ++i) {
+    buffer.add(i);
+  }
+  replay_buffer::ThreadPool pool(state.range(1));
+
+  for (auto run : state) {
+    benchmark::DoNotOptimize(buffer.sample(state.range(0), pool));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Keyed (Philox) counterpart of BM_CircularBufferSampleParallel; the batch
+// is the same for every thread count
+static void BM_CircularBufferKeyedSampleParallel(benchmark::State& state) {
+  replay_buffer::CircularBuffer<int> buffer(1000000);
+  for (int i = 0; i < 1000000; ++i) {
+    buffer.add(i);
+  }
+  replay_buffer::ThreadPool pool(state.range(1));
+
+  uint64_t step = 0;
+  for (auto run : state) {
+    benchmark::DoNotOptimize(
+        buffer.sample(state.range(0), {42, step++, 0}, pool));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Long-horizon stream into a full reservoir: almost every item is rejected
+// by a single comparison, so this should be far cheaper than a FIFO add of
+// the same heap-backed payload.
+static void BM_CircularBufferReservoirAdd(benchmark::State& state) {
+  replay_buffer::CircularBuffer<std::vector<float>> buffer(
+      state.range(0), replay_buffer::RetentionPolicy::kReservoir);
+  const std::vector<float> item(64, 1.0f);
+  for (int i = 0; i < state.range(0); ++i) {
+    buffer.add(item);
+  }
+
+  for (auto run : state) {
+    buffer.add(item);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
 static void BM_CircularBufferSample(benchmark::State& state) {
   // access first parameter
   int buffer_size = state.range(0);
@@ -29,6 +134,62 @@ static void BM_CircularBufferSample(benchmark::State& state) {
   }
 }
 
+// Same as BM_CircularBufferAdd through a rate limiter that never blocks,
+// i.e. the cost of the limiter when it is not tight
+static void BM_RateLimitedCircularBufferAdd(benchmark::State& state) {
+  replay_buffer::RateLimiterConfig config;
+  config.error_tolerance = 1e18;
+  replay_buffer::RateLimitedReplayBuffer<replay_buffer::CircularBuffer<int>>
+      buffer(config, state.range(0));
+
+  for (auto run : state) {
+    buffer.add(1);
+  }
+}
+
+// Compile-time capacity: compare with BM_CircularBufferAdd and
+// BM_CircularBufferSample at the same capacity. 1024 and 131072 take the
+// mask path, 100000 a modulo by a constant. The runtime buffer also bumps a
+// seqlock version per add, which the static one does not have.
+template <size_t N>
+static void BM_StaticCircularBufferAdd(benchmark::State& state) {
+  auto buffer = std::make_unique<replay_buffer::StaticCircularBuffer<int, N>>();
+  for (size_t i = 0; i < N; ++i) {
+    buffer->add(static_cast<int>(i));
+  }
+
+  for (auto run : state) {
+    buffer->add(1);
+  }
+}
+
+template <size_t N>
+static void BM_StaticCircularBufferSample(benchmark::State& state) {
+  auto buffer = std::make_unique<replay_buffer::StaticCircularBuffer<int, N>>();
+  for (size_t i = 0; i < N; ++i) {
+    buffer->add(static_cast<int>(i));
+  }
+
+  for (auto run : state) {
+    benchmark::DoNotOptimize(buffer->sample(32));
+  }
+}
+
+static void BM_CircularBufferSampleWithoutReplacement(
+    benchmark::State& state) {
+  // access first parameter
+  int buffer_size = state.range(0);
+  replay_buffer::CircularBuffer<int> buffer(buffer_size);
+
+  for (int i = 0; i < buffer_size; ++i) {
+    buffer.add(i);
+  }
+
+  for (auto run : state) {
+    buffer.sample_without_replacement(32);
+  }
+}
+
 static void BM_CircularBufferConcurrentAdd(benchmark::State& state) {
   // access first parameter
   int buffer_size = state.range(0);
@@ -101,14 +262,99 @@ static void BM_CircularBufferConcurrentWriteAndRead(benchmark::State& state) {
   }
 }
 
-BENCHMARK(BM_CircularBufferAdd)->Arg(1000)->Arg(100000)->Arg(1000000);
-BENCHMARK(BM_CircularBufferSample)->Arg(1000)->Arg(100000)->Arg(1000000);
+// BM_CircularBufferConcurrentAdd with each thread adding through its own
+// staging writer, which takes the buffer lock once per state.range(1) items
+static void BM_StagedCircularBufferConcurrentAdd(benchmark::State& state) {
+  static std::unique_ptr<
+      replay_buffer::StagedReplayBuffer<replay_buffer::CircularBuffer<int>>>
+      staged;
+  if (state.thread_index() == 0) {
+    replay_buffer::StagingConfig config;
+    config.max_batch = state.range(1);
+    staged = std::make_unique<
+        replay_buffer::StagedReplayBuffer<replay_buffer::CircularBuffer<int>>>(
+        config, state.range(0));
+  }
+  // Google Benchmark syncs threads before the first iteration, so staged is
+  // set by then
+  std::optional<decltype(staged->writer())> writer;
+
+  for (auto run : state) {
+    if (!writer) {
+      writer.emplace(staged->writer());
+    }
+    writer->add(state.thread_index() + 1);
+  }
+}
+
+// Same traffic as BM_CircularBufferConcurrentWriteAndRead, with readers
+// copying out through the lock-free load() instead of operator[]
+static void BM_CircularBufferConcurrentWriteAndLoad(benchmark::State& state) {
+  // access first parameter
+  int buffer_size = state.range(0);
+  static replay_buffer::CircularBuffer<int> buffer(buffer_size);
+
+  // Prefill buffer
+  if (state.thread_index() == 0) {
+    for (int i = 0; i < buffer_size; ++i) {
+      buffer.add(i);
+    }
+  }
+
+  // One thread writes, all threads read
+  for (auto run : state) {
+    if (state.thread_index() == 0) {
+      buffer.add(state.thread_index() + 1);
+    } else {
+      benchmark::DoNotOptimize(buffer.load(state.thread_index()));
+    }
+  }
+}
+
+BENCHMARK(BM_CircularBufferAdd)
+    ->Arg(1000)
+    ->Arg(1024)
+    ->Arg(100000)
+    ->Arg(131072)
+    ->Arg(1000000);
+BENCHMARK(BM_RateLimitedCircularBufferAdd)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_StaticCircularBufferAdd, 1024);
+BENCHMARK_TEMPLATE(BM_StaticCircularBufferAdd, 100000);
+BENCHMARK_TEMPLATE(BM_StaticCircularBufferAdd, 131072);
+BENCHMARK(BM_CircularBufferAddLoop)
+    ->ArgsProduct({{100000}, {1, 64, 256}});
+BENCHMARK(BM_CircularBufferAddBatch)
+    ->ArgsProduct({{100000}, {1, 64, 256}});
+BENCHMARK(BM_CircularBufferAddCopyVector)->Arg(17)->Arg(1024);
+BENCHMARK(BM_CircularBufferAddMoveVector)->Arg(17)->Arg(1024);
+BENCHMARK(BM_CircularBufferSampleParallel)
+    ->ArgsProduct({{4096, 65536}, {0, 1, 3, 7}});
+BENCHMARK(BM_CircularBufferKeyedSampleParallel)
+    ->ArgsProduct({{4096, 65536}, {0, 1, 3, 7}});
+BENCHMARK(BM_CircularBufferReservoirAdd)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_CircularBufferSample)
+    ->Arg(1000)
+    ->Arg(1024)
+    ->Arg(100000)
+    ->Arg(131072)
+    ->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_StaticCircularBufferSample, 1024);
+BENCHMARK_TEMPLATE(BM_StaticCircularBufferSample, 100000);
+BENCHMARK_TEMPLATE(BM_StaticCircularBufferSample, 131072);
+BENCHMARK(BM_CircularBufferSampleWithoutReplacement)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Arg(1000000);
 BENCHMARK(BM_CircularBufferConcurrentAdd)
     ->ThreadRange(1, 8)
     ->Arg(1000)
     ->Arg(100000)
     ->Arg(1000000);
 
+BENCHMARK(BM_StagedCircularBufferConcurrentAdd)
+    ->ThreadRange(1, 8)
+    ->ArgsProduct({{100000}, {16, 256}});
+
 BENCHMARK(BM_CircularBufferConcurrentSample)
     ->ThreadRange(1, 8)
     ->Arg(1000)
@@ -126,3 +372,9 @@ BENCHMARK(BM_CircularBufferConcurrentWriteAndRead)
     ->Arg(1000)
     ->Arg(100000)
     ->Arg(1000000);
+
+BENCHMARK(BM_CircularBufferConcurrentWriteAndLoad)
+    ->ThreadRange(1, 8)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Arg(1000000);
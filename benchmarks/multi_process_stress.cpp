@@ -0,0 +1,390 @@
+// Multi-process stress harness for SharedPrioritizedReplayBuffer.
+//
+// Forks actor processes (add) and learner processes (sample followed by
+// update_priorities) against one shared-memory buffer for a fixed duration,
+// periodically SIGKILLs a random actor while it is adding and respawns it,
+// then reports throughput and latency percentiles per operation.
+// --mode=threads runs the same loops as threads against the in-process
+// PrioritizedReplayBuffer, which gives the baseline for the IPC overhead
+// (and matches the setup of the BM_*Concurrent* benchmarks).
+//
+// Usage:
+//   replay_buffer_multi_process_stress [--mode=processes|threads]
+//       [--actors=4] [--learners=1] [--capacity=100000] [--batch=32]
+//       [--seconds=5] [--kill-interval-ms=200]
+//
+// Exits with status 1 if a learner ever sampled a torn transition or the
+// sum tree is inconsistent at the end.
+
+#include <replay_buffer/metrics.h>
+#include <replay_buffer/prioritized_replay_buffer.h>
+#include <replay_buffer/shared_prioritized_replay_buffer.h>
+#include <replay_buffer/transition.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+// Every element of a transition is derived from one sequence number, so a
+// reader can tell whether it saw a partially written slot.
+using StressTransition =
+    replay_buffer::Transition<std::array<uint32_t, 32>, uint32_t>;
+
+struct Options {
+  bool use_processes = true;
+  int actors = 4;
+  int learners = 1;
+  size_t capacity = 100000;
+  size_t batch = 32;
+  double seconds = 5.0;
+  int kill_interval_ms = 200;
+};
+
+/// @brief Per-worker results, sent to the parent over a pipe.
+struct WorkerStats {
+  replay_buffer::LatencyHistogram add;
+  replay_buffer::LatencyHistogram sample;
+  replay_buffer::LatencyHistogram update;
+  uint64_t sampled_items = 0;
+  uint64_t torn = 0;
+};
+
+uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void record_latency(replay_buffer::LatencyHistogram& histogram,
+                    uint64_t start_ns) {
+  const uint64_t elapsed = now_ns() - start_ns;
+  histogram.buckets[replay_buffer::LatencyHistogram::bucket_for(elapsed)]++;
+  histogram.count++;
+  histogram.total_ns += elapsed;
+  histogram.max_ns = std::max(histogram.max_ns, elapsed);
+}
+
+void merge(const replay_buffer::LatencyHistogram& from,
+           replay_buffer::LatencyHistogram& into) {
+  for (size_t b = 0; b < replay_buffer::LatencyHistogram::kNumBuckets; b++) {
+    into.buckets[b] += from.buckets[b];
+  }
+  into.count += from.count;
+  into.total_ns += from.total_ns;
+  into.max_ns = std::max(into.max_ns, from.max_ns);
+}
+
+StressTransition make_transition(uint32_t sequence) {
+  StressTransition transition{};
+  transition.observation.fill(sequence);
+  transition.action = sequence;
+  transition.reward = static_cast<float>(sequence % 1024);
+  transition.next_observation.fill(sequence);
+  return transition;
+}
+
+bool is_torn(const StressTransition& transition) {
+  const uint32_t sequence = transition.action;
+  for (size_t i = 0; i < transition.observation.size(); i++) {
+    if (transition.observation[i] != sequence ||
+        transition.next_observation[i] != sequence) {
+      return true;
+    }
+  }
+  return transition.reward != static_cast<float>(sequence % 1024);
+}
+
+template <typename Buffer>
+WorkerStats run_actor(Buffer& buffer, int id, uint64_t deadline_ns) {
+  WorkerStats stats;
+  uint32_t sequence = static_cast<uint32_t>(id) << 24;
+  while (now_ns() < deadline_ns) {
+    const StressTransition transition = make_transition(sequence++);
+    const uint64_t start = now_ns();
+    buffer.add(transition);
+    record_latency(stats.add, start);
+  }
+  return stats;
+}
+
+template <typename Buffer>
+WorkerStats run_learner(Buffer& buffer, int id, size_t batch,
+                        uint64_t deadline_ns) {
+  WorkerStats stats;
+  std::mt19937 gen(id);
+  std::uniform_real_distribution<float> td_dist(0.1f, 10.0f);
+  std::vector<size_t> indices(batch);
+  std::vector<float> td_errors(batch);
+  while (now_ns() < deadline_ns) {
+    uint64_t start = now_ns();
+    const auto samples = buffer.sample(batch);
+    record_latency(stats.sample, start);
+    for (size_t i = 0; i < batch; i++) {
+      stats.torn += is_torn(samples[i].transition);
+      indices[i] = samples[i].index;
+      td_errors[i] = td_dist(gen);
+    }
+    stats.sampled_items += batch;
+    start = now_ns();
+    buffer.update_priorities(indices, td_errors);
+    record_latency(stats.update, start);
+  }
+  return stats;
+}
+
+template <typename Buffer>
+void prefill(Buffer& buffer, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    buffer.add(make_transition(static_cast<uint32_t>(i)));
+  }
+}
+
+/// @brief Forked worker: attaches by name, runs until the deadline and
+/// writes its stats to the pipe. Never returns.
+[[noreturn]] void run_child(const std::string& name, bool is_learner, int id,
+                            const Options& options, uint64_t deadline_ns,
+                            int write_fd) {
+  int status = 0;
+  try {
+    auto buffer = replay_buffer::SharedPrioritizedReplayBuffer<
+        StressTransition>::open(name);
+    const WorkerStats stats =
+        is_learner ? run_learner(buffer, id, options.batch, deadline_ns)
+                   : run_actor(buffer, id, deadline_ns);
+    if (write(write_fd, &stats, sizeof(stats)) !=
+        static_cast<ssize_t>(sizeof(stats))) {
+      status = 1;
+    }
+  } catch (const std::exception& error) {
+    std::fprintf(stderr, "worker %d: %s\n", id, error.what());
+    status = 1;
+  }
+  close(write_fd);
+  _exit(status);
+}
+
+struct Child {
+  pid_t pid;
+  int read_fd;
+  bool is_learner;
+};
+
+Child spawn(const std::string& name, bool is_learner, int id,
+            const Options& options, uint64_t deadline_ns) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    std::perror("pipe");
+    std::exit(1);
+  }
+  const pid_t pid = fork();
+  if (pid < 0) {
+    std::perror("fork");
+    std::exit(1);
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    run_child(name, is_learner, id, options, deadline_ns, fds[1]);
+  }
+  close(fds[1]);
+  return {pid, fds[0], is_learner};
+}
+
+/// @brief Reads a child's stats (if it lived to send them) and reaps it.
+bool collect(const Child& child, WorkerStats& stats) {
+  size_t received = 0;
+  auto* bytes = reinterpret_cast<char*>(&stats);
+  while (received < sizeof(stats)) {
+    const ssize_t n = read(child.read_fd, bytes + received,
+                           sizeof(stats) - received);
+    if (n <= 0) {
+      break;
+    }
+    received += static_cast<size_t>(n);
+  }
+  close(child.read_fd);
+  waitpid(child.pid, nullptr, 0);
+  return received == sizeof(stats);
+}
+
+void report_operation(const char* operation,
+                      const replay_buffer::LatencyHistogram& histogram,
+                      uint64_t items, double seconds) {
+  if (histogram.count == 0) {
+    return;
+  }
+  std::printf("%-8s %12llu %14.0f %10.0f %10.0f %10.0f %10.0f\n", operation,
+              static_cast<unsigned long long>(histogram.count),
+              static_cast<double>(items) / seconds, histogram.mean_ns(),
+              histogram.percentile(50.0), histogram.percentile(99.0),
+              histogram.percentile(99.9));
+}
+
+int report(const Options& options, const WorkerStats& total, double seconds,
+           uint64_t kills, uint64_t recoveries, bool consistent) {
+  std::printf(
+      "mode=%s actors=%d learners=%d capacity=%zu batch=%zu seconds=%.1f\n",
+      options.use_processes ? "processes" : "threads", options.actors,
+      options.learners, options.capacity, options.batch, seconds);
+  std::printf("%-8s %12s %14s %10s %10s %10s %10s\n", "op", "calls",
+              "items/s", "mean_ns", "p50_ns", "p99_ns", "p999_ns");
+  report_operation("add", total.add, total.add.count, seconds);
+  report_operation("sample", total.sample, total.sampled_items, seconds);
+  report_operation("update", total.update, total.sampled_items, seconds);
+  std::printf("kills=%llu recoveries=%llu torn=%llu consistent=%s\n",
+              static_cast<unsigned long long>(kills),
+              static_cast<unsigned long long>(recoveries),
+              static_cast<unsigned long long>(total.torn),
+              consistent ? "yes" : "no");
+  return total.torn == 0 && consistent ? 0 : 1;
+}
+
+void accumulate(const WorkerStats& from, WorkerStats& into) {
+  merge(from.add, into.add);
+  merge(from.sample, into.sample);
+  merge(from.update, into.update);
+  into.sampled_items += from.sampled_items;
+  into.torn += from.torn;
+}
+
+int run_processes(const Options& options) {
+  const std::string name =
+      "/replay_buffer_stress_" + std::to_string(getpid());
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = options.capacity;
+  auto buffer =
+      replay_buffer::SharedPrioritizedReplayBuffer<StressTransition>::create(
+          name, config);
+  prefill(buffer, std::min<size_t>(options.capacity, 1024));
+
+  const uint64_t start_ns = now_ns();
+  const uint64_t deadline_ns =
+      start_ns + static_cast<uint64_t>(options.seconds * 1e9);
+  std::vector<Child> children;
+  for (int i = 0; i < options.learners; i++) {
+    children.push_back(spawn(name, true, i, options, deadline_ns));
+  }
+  for (int i = 0; i < options.actors; i++) {
+    children.push_back(
+        spawn(name, false, options.learners + i, options, deadline_ns));
+  }
+
+  // Kill a random actor at each interval; it is almost always inside add()
+  // since that is all it does. Its stats die with it, the replacement
+  // starts fresh.
+  WorkerStats total;
+  uint64_t kills = 0;
+  std::mt19937 gen(0);
+  if (options.actors > 0 && options.kill_interval_ms > 0) {
+    std::uniform_int_distribution<int> pick(
+        options.learners, options.learners + options.actors - 1);
+    const auto interval = std::chrono::milliseconds(options.kill_interval_ms);
+    while (now_ns() + interval.count() * 1000000ull < deadline_ns) {
+      std::this_thread::sleep_for(interval);
+      Child& victim = children[pick(gen)];
+      kill(victim.pid, SIGKILL);
+      WorkerStats lost;
+      collect(victim, lost);
+      kills++;
+      victim = spawn(name, false, static_cast<int>(options.learners + kills),
+                     options, deadline_ns);
+    }
+  }
+
+  for (const Child& child : children) {
+    WorkerStats stats;
+    if (collect(child, stats)) {
+      accumulate(stats, total);
+    }
+  }
+  const double seconds = static_cast<double>(now_ns() - start_ns) / 1e9;
+  const int status = report(options, total, seconds, kills,
+                            buffer.recoveries(), buffer.is_consistent());
+  replay_buffer::SharedPrioritizedReplayBuffer<StressTransition>::unlink(name);
+  return status;
+}
+
+int run_threads(const Options& options) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = options.capacity;
+  replay_buffer::PrioritizedReplayBuffer<StressTransition> buffer(config);
+  prefill(buffer, std::min<size_t>(options.capacity, 1024));
+
+  const uint64_t start_ns = now_ns();
+  const uint64_t deadline_ns =
+      start_ns + static_cast<uint64_t>(options.seconds * 1e9);
+  const int workers = options.learners + options.actors;
+  std::vector<WorkerStats> stats(workers);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < workers; i++) {
+    threads.emplace_back([&, i] {
+      stats[i] = i < options.learners
+                     ? run_learner(buffer, i, options.batch, deadline_ns)
+                     : run_actor(buffer, i, deadline_ns);
+    });
+  }
+  WorkerStats total;
+  for (int i = 0; i < workers; i++) {
+    threads[i].join();
+    accumulate(stats[i], total);
+  }
+  const double seconds = static_cast<double>(now_ns() - start_ns) / 1e9;
+  return report(options, total, seconds, 0, 0, true);
+}
+
+bool parse_option(const char* argument, const char* key, std::string& value) {
+  const size_t length = std::strlen(key);
+  if (std::strncmp(argument, key, length) != 0 || argument[length] != '=') {
+    return false;
+  }
+  value = argument + length + 1;
+  return true;
+}
+
+Options parse_options(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (parse_option(argv[i], "--mode", value)) {
+      options.use_processes = value != "threads";
+    } else if (parse_option(argv[i], "--actors", value)) {
+      options.actors = std::stoi(value);
+    } else if (parse_option(argv[i], "--learners", value)) {
+      options.learners = std::stoi(value);
+    } else if (parse_option(argv[i], "--capacity", value)) {
+      options.capacity = std::stoul(value);
+    } else if (parse_option(argv[i], "--batch", value)) {
+      options.batch = std::stoul(value);
+    } else if (parse_option(argv[i], "--seconds", value)) {
+      options.seconds = std::stod(value);
+    } else if (parse_option(argv[i], "--kill-interval-ms", value)) {
+      options.kill_interval_ms = std::stoi(value);
+    } else {
+      std::fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      std::exit(2);
+    }
+  }
+  if (options.actors < 0 || options.learners < 0 || options.capacity == 0 ||
+      options.batch == 0) {
+    std::fprintf(stderr, "Invalid options\n");
+    std::exit(2);
+  }
+  return options;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  const Options options = parse_options(argc, argv);
+  return options.use_processes ? run_processes(options) : run_threads(options);
+}
@@ -1,5 +1,15 @@
 #include <benchmark/benchmark.h>
+#include <replay_buffer/buffer_registry.h>
+#include <replay_buffer/concurrent_sum_tree.h>
 #include <replay_buffer/prioritized_replay_buffer.h>
+#include <replay_buffer/sum_tree.h>
+#include <replay_buffer/thread_pool.h>
+
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
 
 #include "replay_buffer/transition.h"
 
@@ -53,6 +63,88 @@ static void BM_PrioritizedReplayBufferConcurrentAdd(benchmark::State& state) {
   }
 }
 
+// Ape-X style ingest: each actor sends state.range(1) transitions with
+// locally computed TD errors, one add_batch() per step.
+static void BM_PrioritizedReplayBufferConcurrentAddBatch(
+    benchmark::State& state) {
+  static std::unique_ptr<replay_buffer::PrioritizedReplayBuffer<
+      replay_buffer::Transition<int, int>>>
+      buffer;
+
+  if (state.thread_index() == 0) {
+    replay_buffer::PrioritizedReplayBufferConfig config;
+    config.capacity = state.range(0);
+    buffer = std::make_unique<replay_buffer::PrioritizedReplayBuffer<
+        replay_buffer::Transition<int, int>>>(config);
+  }
+
+  const std::vector<replay_buffer::Transition<int, int>> transitions(
+      state.range(1), replay_buffer::Transition<int, int>(
+                          state.thread_index(), state.thread_index(), 1.0f,
+                          state.thread_index(), false));
+  std::vector<float> td_errors(state.range(1));
+  for (size_t i = 0; i < td_errors.size(); ++i) {
+    td_errors[i] = static_cast<float>(i % 10 + 1);
+  }
+
+  for (auto run : state) {
+    buffer->add_batch(transitions, td_errors);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+// Same traffic as above through one add() per transition
+static void BM_PrioritizedReplayBufferConcurrentAddLoop(
+    benchmark::State& state) {
+  static std::unique_ptr<replay_buffer::PrioritizedReplayBuffer<
+      replay_buffer::Transition<int, int>>>
+      buffer;
+
+  if (state.thread_index() == 0) {
+    replay_buffer::PrioritizedReplayBufferConfig config;
+    config.capacity = state.range(0);
+    buffer = std::make_unique<replay_buffer::PrioritizedReplayBuffer<
+        replay_buffer::Transition<int, int>>>(config);
+  }
+
+  const replay_buffer::Transition<int, int> transition(
+      state.thread_index(), state.thread_index(), 1.0f, state.thread_index(),
+      false);
+
+  for (auto run : state) {
+    for (int64_t i = 0; i < state.range(1); ++i) {
+      buffer->add(transition);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+}
+
+// Steady-state add into a full buffer under each eviction policy
+// (state.range(1): 0 = FIFO, 1 = lowest priority, 2 = inverse priority)
+static void BM_PrioritizedReplayBufferAddWithEviction(
+    benchmark::State& state) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = state.range(0);
+  config.eviction_policy =
+      static_cast<replay_buffer::EvictionPolicy>(state.range(1));
+  replay_buffer::PrioritizedReplayBuffer<replay_buffer::Transition<int, int>>
+      buffer(config);
+
+  std::vector<size_t> indices;
+  std::vector<float> td_errors;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    buffer.add(replay_buffer::Transition<int, int>(i, i, 1.0f, i, false));
+    indices.push_back(i);
+    td_errors.push_back(static_cast<float>(i % 10 + 1));
+  }
+  buffer.update_priorities(indices, td_errors);
+
+  const replay_buffer::Transition<int, int> transition(1, 1, 1.0f, 1, false);
+  for (auto run : state) {
+    buffer.add(transition);
+  }
+}
+
 static void BM_PrioritizedReplayBufferSample(benchmark::State& state) {
   // access first parameter
   int buffer_size = state.range(0);
@@ -88,6 +180,33 @@ static void BM_PrioritizedReplayBufferSample(benchmark::State& state) {
   }
 }
 
+static void BM_PrioritizedReplayBufferSampleWithoutReplacement(
+    benchmark::State& state) {
+  // access first parameter
+  int buffer_size = state.range(0);
+
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = buffer_size;
+
+  replay_buffer::PrioritizedReplayBuffer<replay_buffer::Transition<int, int>>
+      buffer(config);
+
+  std::vector<size_t> indices;
+  std::vector<float> td_errors;
+  for (int i = 0; i < buffer_size; ++i) {
+    replay_buffer::Transition<int, int> transition(
+        i, i, static_cast<float>(i), i, false);
+    buffer.add(transition);
+    indices.push_back(i);
+    td_errors.push_back(static_cast<float>(i % 10 + 1));
+  }
+  buffer.update_priorities(indices, td_errors);
+
+  for (auto run : state) {
+    buffer.sample_without_replacement(32);
+  }
+}
+
 static void BM_PrioritizedReplayBufferConcurrentSample(
     benchmark::State& state) {
   // access first parameter
@@ -206,16 +325,132 @@ static void BM_PrioritizedReplayBufferConcurrentUpdatePriorities(
   }
 }
 
+// Large offline-RL batches: state.range(1) pool workers besides the caller,
+// 0 meaning the serial path
+static void BM_PrioritizedReplayBufferSampleParallel(benchmark::State& state) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 1000000;
+  replay_buffer::PrioritizedReplayBuffer<replay_buffer::Transition<int, int>>
+      buffer(config);
+  for (int i = 0; i < 1000000; ++i) {
+    buffer.add(replay_buffer::Transition<int, int>(i, i, 1.0f, i, false));
+  }
+  replay_buffer::ThreadPool pool(state.range(1));
+
+  for (auto run : state) {
+    benchmark::DoNotOptimize(buffer.sample(state.range(0), pool));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Full re-exponentiation and rebuild after an alpha change. Samples keep
+// running against the old tree meanwhile, so this is staleness, not stall.
+// The same 32-leaf update traffic as
+// BM_PrioritizedReplayBufferConcurrentUpdatePriorities, applied straight to
+// a sum tree: a SumTree behind an exclusive lock against ConcurrentSumTree,
+// whose updaters only meet on the atomic adds near the root.
+static void BM_SumTreeLockedConcurrentSet(benchmark::State& state) {
+  static replay_buffer::SumTree tree(state.range(0));
+  static std::mutex mutex;
+  std::mt19937 gen(state.thread_index());
+  // Static across threads, so sized by the first run's argument
+  std::uniform_int_distribution<size_t> index(0, tree.capacity() - 1);
+  std::uniform_real_distribution<float> priority(0.1f, 10.0f);
+
+  for (auto run : state) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int i = 0; i < 32; ++i) {
+      tree.set(index(gen), priority(gen));
+    }
+  }
+}
+
+static void BM_ConcurrentSumTreeConcurrentSet(benchmark::State& state) {
+  static replay_buffer::ConcurrentSumTree tree(state.range(0));
+  std::mt19937 gen(state.thread_index());
+  // Static across threads, so sized by the first run's argument
+  std::uniform_int_distribution<size_t> index(0, tree.capacity() - 1);
+  std::uniform_real_distribution<float> priority(0.1f, 10.0f);
+
+  for (auto run : state) {
+    for (int i = 0; i < 32; ++i) {
+      tree.set(index(gen), priority(gen));
+    }
+  }
+}
+
+static void BM_PrioritizedReplayBufferSetAlpha(benchmark::State& state) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = state.range(0);
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  const std::vector<int> items(config.capacity, 1);
+  std::vector<float> td_errors(config.capacity);
+  for (size_t i = 0; i < config.capacity; ++i) {
+    td_errors[i] = static_cast<float>(i % 100);
+  }
+  buffer.add_batch(items, td_errors);
+
+  float alpha = 0.5f;
+  for (auto run : state) {
+    alpha = alpha == 0.5f ? 0.7f : 0.5f;
+    buffer.set_alpha(alpha);
+    buffer.wait_for_alpha_update();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// One mixed batch of 256 over range(0) task buffers sharing 1M slots
+static void BM_ReplayBufferRegistryMixedSample(benchmark::State& state) {
+  const size_t buffers = state.range(0);
+  const size_t total = 1 << 20;
+  replay_buffer::ReplayBufferRegistryConfig config;
+  config.budget_bytes =
+      total / config.slab_size *
+      replay_buffer::ReplayBufferRegistry<
+          replay_buffer::Transition<int, int>>::slab_bytes(config.slab_size);
+  replay_buffer::ReplayBufferRegistry<replay_buffer::Transition<int, int>>
+      registry(config);
+  std::vector<replay_buffer::Transition<int, int>> items(total / buffers);
+  std::vector<float> td_errors(items.size());
+  for (size_t i = 0; i < td_errors.size(); ++i) {
+    td_errors[i] = static_cast<float>(i % 10 + 1);
+  }
+  for (size_t b = 0; b < buffers; ++b) {
+    const size_t id = registry.create_buffer(
+        "task" + std::to_string(b), {static_cast<double>(b + 1)});
+    registry.add_batch(id, items, td_errors);
+  }
+
+  for (auto run : state) {
+    benchmark::DoNotOptimize(registry.sample(256));
+  }
+  state.SetItemsProcessed(state.iterations() * 256);
+}
+
 BENCHMARK(BM_PrioritizedReplayBufferAdd)->Arg(1000)->Arg(100000)->Arg(1000000);
 BENCHMARK(BM_PrioritizedReplayBufferConcurrentAdd)
     ->ThreadRange(1, 8)
     ->Arg(1000)
     ->Arg(100000)
     ->Arg(1000000);
+BENCHMARK(BM_PrioritizedReplayBufferConcurrentAddBatch)
+    ->ThreadRange(1, 8)
+    ->ArgsProduct({{100000, 1000000}, {64, 256}})
+    ->UseRealTime();
+BENCHMARK(BM_PrioritizedReplayBufferConcurrentAddLoop)
+    ->ThreadRange(1, 8)
+    ->ArgsProduct({{100000, 1000000}, {64, 256}})
+    ->UseRealTime();
+BENCHMARK(BM_PrioritizedReplayBufferAddWithEviction)
+    ->ArgsProduct({{1000, 100000, 1000000}, {0, 1, 2}});
 BENCHMARK(BM_PrioritizedReplayBufferSample)
     ->Arg(1000)
     ->Arg(100000)
     ->Arg(1000000);
+BENCHMARK(BM_PrioritizedReplayBufferSampleWithoutReplacement)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Arg(1000000);
 BENCHMARK(BM_PrioritizedReplayBufferConcurrentSample)
     ->ThreadRange(1, 8)
     ->Arg(1000)
@@ -230,3 +465,20 @@ BENCHMARK(BM_PrioritizedReplayBufferConcurrentUpdatePriorities)
     ->Arg(1000)
     ->Arg(100000)
     ->Arg(1000000);
+BENCHMARK(BM_SumTreeLockedConcurrentSet)
+    ->ThreadRange(1, 8)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Arg(1000000);
+BENCHMARK(BM_ConcurrentSumTreeConcurrentSet)
+    ->ThreadRange(1, 8)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Arg(1000000);
+BENCHMARK(BM_PrioritizedReplayBufferSetAlpha)
+    ->Arg(100000)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ReplayBufferRegistryMixedSample)->Arg(1)->Arg(8)->Arg(64);
+BENCHMARK(BM_PrioritizedReplayBufferSampleParallel)
+    ->ArgsProduct({{4096, 65536}, {0, 1, 3, 7}});
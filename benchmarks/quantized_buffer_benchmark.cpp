@@ -0,0 +1,96 @@
+#include <benchmark/benchmark.h>
+#include <replay_buffer/quantized_buffer.h>
+
+#include <cstdint>
+#include <vector>
+
+// Sampled batches are 32 observations of state.range(0) features from a
+// buffer of 1000 observations.
+
+static std::vector<float> make_observation(size_t feature_dim, int seed) {
+  std::vector<float> observation(feature_dim);
+  for (size_t i = 0; i < feature_dim; ++i) {
+    observation[i] = static_cast<float>((seed + i) % 255);
+  }
+  return observation;
+}
+
+static void BM_QuantizedBufferUint8Add(benchmark::State& state) {
+  // access first parameter
+  const size_t feature_dim = state.range(0);
+  replay_buffer::QuantizedBuffer<uint8_t> buffer({1000, feature_dim, {}, {}});
+  const std::vector<float> observation = make_observation(feature_dim, 0);
+
+  for (auto run : state) {
+    buffer.add(observation);
+  }
+}
+
+static void BM_QuantizedBufferUint8Sample(benchmark::State& state) {
+  // access first parameter
+  const size_t feature_dim = state.range(0);
+  replay_buffer::QuantizedBuffer<uint8_t> buffer({1000, feature_dim, {}, {}});
+  for (int i = 0; i < 1000; ++i) {
+    buffer.add(make_observation(feature_dim, i));
+  }
+
+  for (auto run : state) {
+    benchmark::DoNotOptimize(buffer.sample(32));
+  }
+  state.SetBytesProcessed(state.iterations() * 32 * feature_dim *
+                          sizeof(float));
+}
+
+static void BM_QuantizedBufferFloat16Sample(benchmark::State& state) {
+  // access first parameter
+  const size_t feature_dim = state.range(0);
+  replay_buffer::QuantizedBuffer<replay_buffer::Float16> buffer(
+      {1000, feature_dim, {}, {}});
+  for (int i = 0; i < 1000; ++i) {
+    buffer.add(make_observation(feature_dim, i));
+  }
+
+  for (auto run : state) {
+    benchmark::DoNotOptimize(buffer.sample(32));
+  }
+  state.SetBytesProcessed(state.iterations() * 32 * feature_dim *
+                          sizeof(float));
+}
+
+static void BM_DequantizeUint8(benchmark::State& state) {
+  // access first parameter
+  const size_t feature_dim = state.range(0);
+  const std::vector<uint8_t> codes(feature_dim, 7);
+  const std::vector<float> scale(feature_dim, 0.5f);
+  const std::vector<float> offset(feature_dim, -1.0f);
+  std::vector<float> values(feature_dim);
+
+  for (auto run : state) {
+    replay_buffer::dequantize(std::span<const uint8_t>(codes), scale, offset,
+                              values);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * feature_dim * sizeof(float));
+}
+
+static void BM_DequantizeUint8Scalar(benchmark::State& state) {
+  // access first parameter
+  const size_t feature_dim = state.range(0);
+  const std::vector<uint8_t> codes(feature_dim, 7);
+  const std::vector<float> scale(feature_dim, 0.5f);
+  const std::vector<float> offset(feature_dim, -1.0f);
+  std::vector<float> values(feature_dim);
+
+  for (auto run : state) {
+    replay_buffer::dequantize_scalar(std::span<const uint8_t>(codes), scale,
+                                     offset, values);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * feature_dim * sizeof(float));
+}
+
+BENCHMARK(BM_QuantizedBufferUint8Add)->Arg(17)->Arg(512)->Arg(28224);
+BENCHMARK(BM_QuantizedBufferUint8Sample)->Arg(17)->Arg(512)->Arg(28224);
+BENCHMARK(BM_QuantizedBufferFloat16Sample)->Arg(17)->Arg(512)->Arg(28224);
+BENCHMARK(BM_DequantizeUint8)->Arg(17)->Arg(512)->Arg(28224);
+BENCHMARK(BM_DequantizeUint8Scalar)->Arg(17)->Arg(512)->Arg(28224);
@@ -0,0 +1,97 @@
+#include <benchmark/benchmark.h>
+#include <replay_buffer/static_sum_tree.h>
+#include <replay_buffer/sum_tree.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+// Restoring a tree of state.range(0) priorities, e.g. from a checkpoint:
+// one set() per leaf against a single bulk build().
+static void BM_SumTreeSetLoop(benchmark::State& state) {
+  replay_buffer::SumTree tree(state.range(0));
+  const std::vector<float> priorities(state.range(0), 1.0f);
+
+  for (auto run : state) {
+    for (size_t i = 0; i < priorities.size(); ++i) {
+      tree.set(i, priorities[i]);
+    }
+    benchmark::DoNotOptimize(tree.total());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_SumTreeBuild(benchmark::State& state) {
+  replay_buffer::SumTree tree(state.range(0));
+  const std::vector<float> priorities(state.range(0), 1.0f);
+
+  for (auto run : state) {
+    tree.build(priorities);
+    benchmark::DoNotOptimize(tree.total());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Single-leaf updates and samples, the per-transition paths of a
+// prioritized buffer. The static tree walks a fixed, unrolled number of
+// levels; at 100000 it pads to 131072 leaves, so compare both sizes.
+static void BM_SumTreeSet(benchmark::State& state) {
+  replay_buffer::SumTree tree(state.range(0));
+  std::mt19937 gen(0);
+
+  for (auto run : state) {
+    tree.set(gen() % state.range(0), 1.0f);
+  }
+  benchmark::DoNotOptimize(tree.total());
+}
+
+template <size_t N>
+static void BM_StaticSumTreeSet(benchmark::State& state) {
+  auto tree = std::make_unique<replay_buffer::StaticSumTree<N>>();
+  std::mt19937 gen(0);
+
+  for (auto run : state) {
+    tree->set(gen() % N, 1.0f);
+  }
+  benchmark::DoNotOptimize(tree->total());
+}
+
+static void BM_SumTreeSample(benchmark::State& state) {
+  replay_buffer::SumTree tree(state.range(0));
+  tree.build(std::vector<float>(state.range(0), 1.0f));
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> value(0.0f, tree.total());
+
+  for (auto run : state) {
+    benchmark::DoNotOptimize(tree.sample(value(gen)));
+  }
+}
+
+template <size_t N>
+static void BM_StaticSumTreeSample(benchmark::State& state) {
+  auto tree = std::make_unique<replay_buffer::StaticSumTree<N>>();
+  tree->build(std::vector<float>(N, 1.0f));
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> value(0.0f, tree->total());
+
+  for (auto run : state) {
+    benchmark::DoNotOptimize(tree->sample(value(gen)));
+  }
+}
+
+BENCHMARK(BM_SumTreeSetLoop)
+    ->Arg(100000)
+    ->Arg(10000000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SumTreeBuild)
+    ->Arg(100000)
+    ->Arg(10000000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SumTreeSet)->Arg(1024)->Arg(100000)->Arg(131072);
+BENCHMARK_TEMPLATE(BM_StaticSumTreeSet, 1024);
+BENCHMARK_TEMPLATE(BM_StaticSumTreeSet, 100000);
+BENCHMARK_TEMPLATE(BM_StaticSumTreeSet, 131072);
+BENCHMARK(BM_SumTreeSample)->Arg(1024)->Arg(100000)->Arg(131072);
+BENCHMARK_TEMPLATE(BM_StaticSumTreeSample, 1024);
+BENCHMARK_TEMPLATE(BM_StaticSumTreeSample, 100000);
+BENCHMARK_TEMPLATE(BM_StaticSumTreeSample, 131072);
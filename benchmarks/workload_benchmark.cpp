@@ -0,0 +1,357 @@
+#include <benchmark/benchmark.h>
+#include <replay_buffer/arena_buffer.h>
+#include <replay_buffer/circular_buffer.h>
+#include <replay_buffer/metrics.h>
+#include <replay_buffer/prioritized_replay_buffer.h>
+#include <replay_buffer/transition.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+// Realistic payloads: the int-only benchmarks hide copy and cache costs.
+// 17-float state / 6-float action (MuJoCo HalfCheetah-style)
+using MujocoTransition =
+    replay_buffer::Transition<std::array<float, 17>, std::array<float, 6>>;
+// 84x84x4 stacked uint8 frames (Atari DQN preprocessing)
+using AtariTransition =
+    replay_buffer::Transition<std::array<uint8_t, 84 * 84 * 4>, int>;
+
+// Atari transitions are ~56KB, so keep those buffers small enough to fit
+// comfortably in memory alongside the others.
+template <typename TransitionType>
+constexpr size_t kCapacity = sizeof(TransitionType) > 4096 ? 2000 : 100000;
+
+constexpr size_t kBatchSize = 32;
+
+static size_t resident_memory_bytes() {
+#if defined(__APPLE__)
+  mach_task_basic_info info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+    return 0;
+  }
+  return info.resident_size;
+#else
+  std::ifstream statm("/proc/self/statm");
+  size_t total_pages = 0;
+  size_t resident_pages = 0;
+  statm >> total_pages >> resident_pages;
+  return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+static uint64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static void record_latency(replay_buffer::LatencyHistogram& histogram,
+                           uint64_t start_ns) {
+  const uint64_t elapsed = now_ns() - start_ns;
+  histogram.buckets[replay_buffer::LatencyHistogram::bucket_for(elapsed)]++;
+  histogram.count++;
+  histogram.total_ns += elapsed;
+  histogram.max_ns = std::max(histogram.max_ns, elapsed);
+}
+
+/// @brief Merges per-thread latency histograms of one benchmark run and lets
+/// the last thread to finish report the percentiles. Google Benchmark sums
+/// counters across threads, so only that thread sets them.
+class LatencyReport {
+ public:
+  /// @brief Called by thread 0 before the timed loop (other threads wait on
+  /// the start barrier).
+  void reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    add_ = {};
+    sample_ = {};
+    update_ = {};
+    stale_updates_ = 0;
+    finished_ = 0;
+  }
+
+  void finish(benchmark::State& state,
+              const replay_buffer::LatencyHistogram& add,
+              const replay_buffer::LatencyHistogram& sample,
+              const replay_buffer::LatencyHistogram& update,
+              int64_t stale_updates = 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    merge(add, add_);
+    merge(sample, sample_);
+    merge(update, update_);
+    stale_updates_ += stale_updates;
+    if (++finished_ != state.threads()) {
+      return;
+    }
+    report(state, "add", add_);
+    report(state, "sample", sample_);
+    report(state, "update", update_);
+    if (update_.count > 0) {
+      // Share of priority updates dropped because the slot was overwritten
+      state.counters["stale_update_pct"] =
+          100.0 * static_cast<double>(stale_updates_) /
+          static_cast<double>(update_.count * kBatchSize);
+    }
+    state.counters["rss_mb"] =
+        static_cast<double>(resident_memory_bytes()) / (1024.0 * 1024.0);
+  }
+
+ private:
+  static void merge(const replay_buffer::LatencyHistogram& from,
+                    replay_buffer::LatencyHistogram& into) {
+    for (size_t b = 0; b < replay_buffer::LatencyHistogram::kNumBuckets; b++) {
+      into.buckets[b] += from.buckets[b];
+    }
+    into.count += from.count;
+    into.total_ns += from.total_ns;
+    into.max_ns = std::max(into.max_ns, from.max_ns);
+  }
+
+  static void report(benchmark::State& state, const std::string& name,
+                     const replay_buffer::LatencyHistogram& histogram) {
+    if (histogram.count == 0) {
+      return;
+    }
+    state.counters[name + "_p50_ns"] = histogram.percentile(50.0);
+    state.counters[name + "_p99_ns"] = histogram.percentile(99.0);
+    state.counters[name + "_p999_ns"] = histogram.percentile(99.9);
+  }
+
+  std::mutex mutex_;
+  replay_buffer::LatencyHistogram add_;
+  replay_buffer::LatencyHistogram sample_;
+  replay_buffer::LatencyHistogram update_;
+  int64_t stale_updates_ = 0;
+  int finished_ = 0;
+};
+
+template <typename TransitionType>
+static TransitionType make_transition(int seed) {
+  using Value = typename decltype(TransitionType::observation)::value_type;
+  TransitionType transition{};
+  for (size_t i = 0; i < transition.observation.size(); ++i) {
+    transition.observation[i] = static_cast<Value>((seed + i) % 251);
+  }
+  transition.next_observation = transition.observation;
+  transition.reward = static_cast<float>(seed % 7);
+  transition.done = seed % 100 == 0;
+  return transition;
+}
+
+template <typename TransitionType>
+static void BM_PayloadAdd(benchmark::State& state) {
+  replay_buffer::CircularBuffer<TransitionType> buffer(
+      kCapacity<TransitionType>);
+  const TransitionType transition = make_transition<TransitionType>(1);
+
+  for (auto run : state) {
+    buffer.add(transition);
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * sizeof(TransitionType));
+  state.counters["rss_mb"] =
+      static_cast<double>(resident_memory_bytes()) / (1024.0 * 1024.0);
+}
+
+template <typename TransitionType>
+static void BM_PayloadSample(benchmark::State& state) {
+  replay_buffer::CircularBuffer<TransitionType> buffer(
+      kCapacity<TransitionType>);
+  for (size_t i = 0; i < kCapacity<TransitionType>; ++i) {
+    buffer.add(make_transition<TransitionType>(static_cast<int>(i)));
+  }
+
+  for (auto run : state) {
+    benchmark::DoNotOptimize(buffer.sample(kBatchSize));
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+  state.SetBytesProcessed(state.iterations() * kBatchSize *
+                          sizeof(TransitionType));
+  state.counters["rss_mb"] =
+      static_cast<double>(resident_memory_bytes()) / (1024.0 * 1024.0);
+}
+
+/// @brief Mixed actor/learner workload on one PrioritizedReplayBuffer.
+/// state.range(0) is the number of actors per learner. Learner threads
+/// sample a batch and immediately write back new priorities for it through
+/// sample handles, actor threads add one transition per iteration. Reports
+/// the fraction of priority updates dropped because actors overwrote the
+/// slot in between.
+template <typename TransitionType>
+static void BM_MixedActorLearner(benchmark::State& state) {
+  static std::unique_ptr<replay_buffer::PrioritizedReplayBuffer<TransitionType>>
+      buffer;
+  static LatencyReport report;
+
+  // Registered with thread counts that are multiples of ratio + 1, so the
+  // split is exact
+  const int actors_per_learner = static_cast<int>(state.range(0));
+  const int learners = state.threads() / (actors_per_learner + 1);
+  if (learners == 0 || state.threads() % (actors_per_learner + 1) != 0) {
+    state.SkipWithError("Thread count must be a multiple of ratio + 1");
+    return;
+  }
+  const bool is_learner = state.thread_index() < learners;
+
+  if (state.thread_index() == 0) {
+    replay_buffer::PrioritizedReplayBufferConfig config;
+    config.capacity = kCapacity<TransitionType>;
+    buffer = std::make_unique<
+        replay_buffer::PrioritizedReplayBuffer<TransitionType>>(config);
+    for (size_t i = 0; i < config.capacity; ++i) {
+      buffer->add(make_transition<TransitionType>(static_cast<int>(i)));
+    }
+    report.reset();
+  }
+
+  const TransitionType transition =
+      make_transition<TransitionType>(state.thread_index());
+  std::mt19937 gen(state.thread_index());
+  std::uniform_real_distribution<float> td_dist(0.1f, 10.0f);
+  std::vector<replay_buffer::SampleHandle> handles(kBatchSize);
+  std::vector<float> td_errors(kBatchSize);
+  int64_t stale_updates = 0;
+  replay_buffer::LatencyHistogram add_latency;
+  replay_buffer::LatencyHistogram sample_latency;
+  replay_buffer::LatencyHistogram update_latency;
+
+  for (auto run : state) {
+    if (is_learner) {
+      uint64_t start = now_ns();
+      const auto samples = buffer->sample(kBatchSize);
+      record_latency(sample_latency, start);
+      for (size_t i = 0; i < kBatchSize; ++i) {
+        handles[i] = samples[i].handle();
+        td_errors[i] = td_dist(gen);
+      }
+      start = now_ns();
+      stale_updates +=
+          kBatchSize - buffer->update_priorities(handles, td_errors);
+      record_latency(update_latency, start);
+    } else {
+      const uint64_t start = now_ns();
+      buffer->add(transition);
+      record_latency(add_latency, start);
+    }
+  }
+
+  const int64_t items = is_learner ? state.iterations() * kBatchSize
+                                   : state.iterations();
+  state.SetItemsProcessed(items);
+  state.SetBytesProcessed(items * sizeof(TransitionType));
+  if (state.thread_index() == 0) {
+    // The split actually run; counters are summed over threads
+    state.counters["learners"] = learners;
+    state.counters["actors"] = state.threads() - learners;
+  }
+  report.finish(state, add_latency, sample_latency, update_latency,
+                stale_updates);
+}
+
+// Variable-length payloads between 64B and 64KB in a 64MB arena
+static std::vector<std::vector<uint8_t>> make_variable_payloads() {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> log_size(6, 16);
+  std::vector<std::vector<uint8_t>> payloads;
+  for (int i = 0; i < 256; ++i) {
+    payloads.emplace_back(size_t{1} << log_size(gen), static_cast<uint8_t>(i));
+  }
+  return payloads;
+}
+
+static void BM_VariableLengthAdd(benchmark::State& state) {
+  replay_buffer::ArenaBuffer<uint8_t> buffer(size_t{64} << 20);
+  const auto payloads = make_variable_payloads();
+  size_t bytes = 0;
+  size_t next = 0;
+
+  for (auto run : state) {
+    buffer.add(payloads[next]);
+    bytes += payloads[next].size();
+    next = (next + 1) % payloads.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(bytes);
+  state.counters["rss_mb"] =
+      static_cast<double>(resident_memory_bytes()) / (1024.0 * 1024.0);
+}
+
+static void BM_VariableLengthSample(benchmark::State& state) {
+  replay_buffer::ArenaBuffer<uint8_t> buffer(size_t{64} << 20);
+  const auto payloads = make_variable_payloads();
+  for (size_t i = 0; i < 4096; ++i) {
+    buffer.add(payloads[i % payloads.size()]);
+  }
+  size_t bytes = 0;
+
+  for (auto run : state) {
+    // Touch every sampled byte, as a learner copying into a batch would
+    for (const auto& record : buffer.sample(kBatchSize)) {
+      uint64_t sum = 0;
+      for (const uint8_t value : record) {
+        sum += value;
+      }
+      benchmark::DoNotOptimize(sum);
+      bytes += record.size();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+  state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK_TEMPLATE(BM_PayloadAdd, MujocoTransition);
+BENCHMARK_TEMPLATE(BM_PayloadAdd, AtariTransition);
+BENCHMARK_TEMPLATE(BM_PayloadSample, MujocoTransition);
+BENCHMARK_TEMPLATE(BM_PayloadSample, AtariTransition);
+BENCHMARK(BM_VariableLengthAdd);
+BENCHMARK(BM_VariableLengthSample);
+
+// Actor:learner ratios of 1, 4 and 16. Each ratio gets its own thread
+// counts, multiples of ratio + 1, so every run has exactly that split
+BENCHMARK_TEMPLATE(BM_MixedActorLearner, MujocoTransition)
+    ->Arg(1)
+    ->Threads(2)
+    ->Threads(4)
+    ->Threads(8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MixedActorLearner, MujocoTransition)
+    ->Arg(4)
+    ->Threads(5)
+    ->Threads(10)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MixedActorLearner, MujocoTransition)
+    ->Arg(16)
+    ->Threads(17)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MixedActorLearner, AtariTransition)
+    ->Arg(1)
+    ->Threads(2)
+    ->Threads(4)
+    ->Threads(8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MixedActorLearner, AtariTransition)
+    ->Arg(4)
+    ->Threads(5)
+    ->Threads(10)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MixedActorLearner, AtariTransition)
+    ->Arg(16)
+    ->Threads(17)
+    ->UseRealTime();
@@ -0,0 +1,170 @@
+#pragma once
+
+/// @file arena_buffer.h
+/// @brief Ring arena for variable-length records with a byte-budget capacity.
+/// Payloads are appended back to back into one contiguous allocation and
+/// indexed by (offset, length). When the arena wraps, the oldest records that
+/// overlap the write region are evicted.
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <random>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace replay_buffer {
+/// @brief Ring arena storing variable-length records of T contiguously.
+/// Avoids one heap allocation per record (as with std::vector members) by
+/// packing every payload into a single preallocated arena. A record never
+/// straddles the end of the arena; if it does not fit in the remaining tail,
+/// the write position wraps to the start and the tail is left unused.
+/// Views returned by operator[], at() and sample() alias arena memory and stay
+/// valid until the record they point to is evicted by a later add().
+/// @tparam T Trivially copyable element type of the payloads (e.g. float,
+/// uint8_t)
+template <typename T>
+class ArenaBuffer {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "ArenaBuffer requires a trivially copyable element type");
+
+ public:
+  explicit ArenaBuffer(size_t capacity_bytes) {
+    if (capacity_bytes < sizeof(T)) {
+      throw std::invalid_argument("Capacity must hold at least one element");
+    }
+    capacity_ = capacity_bytes / sizeof(T);
+    arena_.resize(capacity_);
+    write_offset_ = 0;
+    used_ = 0;
+    gen_ = std::mt19937(std::random_device{}());
+  }
+
+  /// @brief Number of records currently stored.
+  size_t size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return records_.size();
+  }
+
+  size_t capacity_bytes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return capacity_ * sizeof(T);
+  }
+
+  /// @brief Bytes occupied by live record payloads (excludes wrap padding).
+  size_t used_bytes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return used_ * sizeof(T);
+  }
+
+  bool is_empty() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return records_.empty();
+  }
+
+  /// @brief Appends a payload, evicting the oldest records it overlaps.
+  /// @param payload Elements to copy into the arena
+  /// @return Number of records evicted to make room
+  size_t add(std::span<const T> payload) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    const size_t length = payload.size();
+    if (length > capacity_) {
+      throw std::invalid_argument("Payload exceeds arena capacity");
+    }
+    // Live records run from the front (oldest) up to write_offset_, possibly
+    // wrapping, so only records at or past the write position can overlap it.
+    size_t evicted = 0;
+    // Records are kept contiguous, so wrap if the tail cannot hold this one.
+    // Anything still stored in the abandoned tail is older than the records
+    // at the start of the arena and goes first.
+    if (write_offset_ + length > capacity_) {
+      while (!records_.empty() && records_.front().offset >= write_offset_) {
+        used_ -= records_.front().length;
+        records_.pop_front();
+        evicted++;
+      }
+      write_offset_ = 0;
+    }
+    while (!records_.empty() && records_.front().offset >= write_offset_ &&
+           records_.front().offset < write_offset_ + length) {
+      used_ -= records_.front().length;
+      records_.pop_front();
+      evicted++;
+    }
+    std::copy(payload.begin(), payload.end(),
+              arena_.begin() + static_cast<std::ptrdiff_t>(write_offset_));
+    records_.push_back(Record{write_offset_, length});
+    used_ += length;
+    write_offset_ += length;
+    return evicted;
+  }
+
+  void clear() {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    records_.clear();
+    write_offset_ = 0;
+    used_ = 0;
+  }
+
+  std::span<const T> operator[](size_t index) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (index >= records_.size()) {
+      throw std::out_of_range("Index out of range");
+    }
+    return view(records_[index]);
+  }
+
+  std::span<const T> at(size_t index) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (index >= records_.size()) {
+      throw std::out_of_range("Index out of range");
+    }
+    return view(records_[index]);
+  }
+
+  /// @brief Samples records uniformly with replacement.
+  /// @return Zero-copy views into the arena, one per sampled record
+  std::vector<std::span<const T>> sample(size_t batch_size) const {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+
+    if (batch_size <= 0) {
+      throw std::invalid_argument("Batch size must be > 0");
+    }
+    if (batch_size > records_.size()) {
+      throw std::invalid_argument("Batch size exceeds buffer size");
+    }
+
+    std::vector<std::span<const T>> result;
+    result.reserve(batch_size);
+
+    std::uniform_int_distribution<size_t> dist(0, records_.size() - 1);
+
+    for (size_t i = 0; i < batch_size; i++) {
+      result.push_back(view(records_[dist(gen_)]));
+    }
+
+    return result;
+  }
+
+ private:
+  struct Record {
+    size_t offset;
+    size_t length;
+  };
+
+  std::span<const T> view(const Record& record) const {
+    return std::span<const T>(arena_.data() + record.offset, record.length);
+  }
+
+  size_t capacity_;
+  std::vector<T> arena_;
+  std::deque<Record> records_;
+  size_t write_offset_;
+  size_t used_;
+  mutable std::shared_mutex mutex_;
+  mutable std::mt19937 gen_;
+};
+}  // namespace replay_buffer
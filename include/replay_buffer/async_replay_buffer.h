@@ -0,0 +1,191 @@
+#pragma once
+
+/// @file async_replay_buffer.h
+/// @brief Coroutine interface over CircularBuffer and
+/// PrioritizedReplayBuffer. Operations that have to wait, such as sampling
+/// from a buffer that does not yet hold a batch, suspend the calling
+/// coroutine instead of blocking its thread; adds resume them directly.
+
+#include <coroutine>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "replay_buffer/prioritized_replay_buffer.h"
+#include "replay_buffer/task.h"
+
+namespace replay_buffer {
+/// @brief Owns a buffer and exposes awaitable add, sample and update
+/// operations. Suspended coroutines are resumed on the executor, so one
+/// executor thread can serve thousands of actor and learner coroutines.
+/// Operations that never wait run inline on the awaiting thread; they take
+/// the buffer's lock only as long as the synchronous call does.
+/// @tparam Buffer CircularBuffer<T> or PrioritizedReplayBuffer<T>
+template <typename Buffer>
+class AsyncReplayBuffer {
+ public:
+  using value_type = typename Buffer::value_type;
+  using SampleBatch = decltype(std::declval<const Buffer&>().sample(1));
+
+  /// @param args Forwarded to the Buffer constructor
+  template <typename... Args>
+  explicit AsyncReplayBuffer(Executor& executor, Args&&... args)
+      : executor_(executor), buffer_(std::forward<Args>(args)...) {}
+
+  AsyncReplayBuffer(const AsyncReplayBuffer&) = delete;
+  AsyncReplayBuffer& operator=(const AsyncReplayBuffer&) = delete;
+
+  /// @brief The wrapped buffer, for synchronous calls. Adds made through
+  /// it do not wake waiters until the next async add or notify().
+  Buffer& buffer() { return buffer_; }
+  const Buffer& buffer() const { return buffer_; }
+
+  Task<void> add_async(value_type item) {
+    buffer_.add(item);
+    notify();
+    co_return;
+  }
+
+  Task<void> add_batch_async(std::vector<value_type> items)
+    requires requires(Buffer& buffer, std::span<const value_type> span) {
+      buffer.add_batch(span);
+    }
+  {
+    buffer_.add_batch(std::span<const value_type>(items));
+    notify();
+    co_return;
+  }
+
+  /// @brief Adds with caller-computed TD errors (prioritized buffers).
+  Task<void> add_batch_async(std::vector<value_type> items,
+                             std::vector<float> td_errors)
+    requires requires(Buffer& buffer, std::span<const value_type> span,
+                      std::span<const float> errors) {
+      buffer.add_batch(span, errors);
+    }
+  {
+    buffer_.add_batch(std::span<const value_type>(items),
+                      std::span<const float>(td_errors));
+    notify();
+    co_return;
+  }
+
+  /// @brief Suspends until the buffer holds at least size items.
+  /// @throws std::invalid_argument if size exceeds the capacity
+  /// @throws std::runtime_error if the buffer is closed meanwhile
+  Task<void> wait_for_size(size_t size) {
+    if (size > buffer_.capacity()) {
+      throw std::invalid_argument("Size exceeds buffer capacity");
+    }
+    // Loops because clear() can shrink the buffer after the wake-up
+    bool reached = false;
+    while (!reached) {
+      reached = co_await SizeAwaiter{*this, size};
+    }
+  }
+
+  /// @brief Waits until batch_size items are available, then samples them.
+  Task<SampleBatch> sample_async(size_t batch_size) {
+    if (batch_size == 0) {
+      throw std::invalid_argument("Batch size must be > 0");
+    }
+    co_await wait_for_size(batch_size);
+    co_return buffer_.sample(batch_size);
+  }
+
+  Task<size_t> update_priorities_async(std::vector<SampleHandle> handles,
+                                       std::vector<float> td_errors)
+    requires requires(Buffer& buffer, const std::vector<SampleHandle>& h,
+                      const std::vector<float>& errors) {
+      buffer.update_priorities(h, errors);
+    }
+  {
+    co_return buffer_.update_priorities(handles, td_errors);
+  }
+
+  /// @brief Resumes every waiter whose condition now holds. Async adds call
+  /// this themselves; call it after adding through buffer().
+  void notify() {
+    std::vector<std::coroutine_handle<>> ready;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (waiters_.empty()) {
+        return;
+      }
+      const size_t size = buffer_.size();
+      const auto last = closed_ ? waiters_.end() : waiters_.upper_bound(size);
+      for (auto it = waiters_.begin(); it != last; ++it) {
+        ready.push_back(it->second);
+      }
+      waiters_.erase(waiters_.begin(), last);
+    }
+    for (std::coroutine_handle<> handle : ready) {
+      executor_.post(handle);
+    }
+  }
+
+  /// @brief Fails every current and future wait with std::runtime_error,
+  /// e.g. at shutdown, so no coroutine stays suspended forever.
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    notify();
+  }
+
+  /// @brief Number of coroutines suspended on this buffer.
+  size_t waiting() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return waiters_.size();
+  }
+
+ private:
+  /// @brief Suspends unless the buffer already holds size items. Checking
+  /// and registering under mutex_ means an add cannot slip in between and
+  /// leave the waiter asleep. Resumes with whether the size was reached.
+  struct SizeAwaiter {
+    AsyncReplayBuffer& self;
+    size_t size;
+    bool ready = false;
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      std::lock_guard<std::mutex> lock(self.mutex_);
+      if (self.closed_) {
+        return false;
+      }
+      if (self.buffer_.size() >= size) {
+        ready = true;
+        return false;
+      }
+      self.waiters_.emplace(size, handle);
+      return true;
+    }
+
+    bool await_resume() const {
+      if (ready) {
+        return true;
+      }
+      std::lock_guard<std::mutex> lock(self.mutex_);
+      if (self.closed_) {
+        throw std::runtime_error("Buffer closed");
+      }
+      return self.buffer_.size() >= size;
+    }
+  };
+
+  Executor& executor_;
+  Buffer buffer_;
+  mutable std::mutex mutex_;
+  // Suspended coroutines keyed by the size they wait for, so an add wakes
+  // exactly those it satisfies
+  std::multimap<size_t, std::coroutine_handle<>> waiters_;
+  bool closed_ = false;
+};
+}  // namespace replay_buffer
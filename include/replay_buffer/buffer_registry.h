@@ -0,0 +1,483 @@
+#pragma once
+
+/// @file buffer_registry.h
+/// @brief Many named prioritized buffers, e.g. one per task, sharing one
+/// slab pool sized by a global byte budget instead of each preallocating
+/// its own capacity. Buffers grow a slab at a time while the pool has free
+/// slabs and give up their oldest slabs once it runs out. A single sample()
+/// call draws a mixed batch across buffers by configurable weights.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <random>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "replay_buffer/prioritized_replay_buffer.h"
+#include "replay_buffer/sum_tree.h"
+
+namespace replay_buffer {
+struct ReplayBufferRegistryConfig {
+  /// Bytes for transitions, sum trees and generations across all buffers
+  size_t budget_bytes;
+  /// Transitions per slab, the unit buffers grow and are evicted by
+  size_t slab_size = 1024;
+  float alpha = 0.6f;
+  float beta = 0.4f;
+  float epsilon = 1e-6f;
+};
+
+struct RegistryBufferOptions {
+  /// Relative share of each mixed batch drawn from this buffer; 0 keeps it
+  /// out of sample() without removing it
+  double weight = 1.0;
+  /// Cap on the transitions held, rounded up to whole slabs. A buffer at
+  /// its cap recycles its own oldest slab instead of taking a free one.
+  size_t max_size = std::numeric_limits<size_t>::max();
+};
+
+template <typename T>
+struct MixedSample {
+  T transition;
+  /// Importance sampling weight from the probability of drawing this
+  /// transition across all buffers
+  float weight;
+  /// Id of the buffer it was drawn from
+  size_t buffer;
+  /// Index is the slot in the shared pool
+  SampleHandle handle;
+};
+
+/// @brief Hosts prioritized buffers over one preallocated slab pool. A
+/// slab holds slab_size transitions together with a sum tree over their
+/// priorities and their slot generations, so it moves between buffers as
+/// a unit.
+/// Each buffer is a FIFO of slabs: adds fill its newest slab, and a full
+/// newest slab is followed by a free slab from the pool. When none is
+/// free, the buffer holding the most slabs (the adding one on a tie) gives
+/// up its oldest slab, evicting those transitions, so memory flows to the
+/// buffers that are being written and no buffer keeps more than its share
+/// under pressure.
+/// Priorities within a buffer are proportional as in
+/// PrioritizedReplayBuffer (|td| + epsilon raised to alpha, new
+/// transitions at the buffer's maximum). Thread-safe.
+/// @tparam T Default-constructible, copy-assignable transition type
+template <typename T>
+class ReplayBufferRegistry {
+ public:
+  explicit ReplayBufferRegistry(const ReplayBufferRegistryConfig& config)
+      : slab_size_(config.slab_size),
+        alpha_(config.alpha),
+        beta_(config.beta),
+        epsilon_(config.epsilon),
+        gen_(std::random_device{}()) {
+    if (config.slab_size == 0) {
+      throw std::invalid_argument("Slab size must be greater than 0");
+    }
+    if (config.alpha < 0.0f || config.alpha > 1.0f) {
+      throw std::invalid_argument("Alpha must be between 0 and 1");
+    }
+    if (config.beta < 0.0f || config.beta > 1.0f) {
+      throw std::invalid_argument("Beta must be between 0 and 1");
+    }
+    if (config.epsilon < 0.0f) {
+      throw std::invalid_argument("Epsilon must be non-negative");
+    }
+    slab_count_ = config.budget_bytes / slab_bytes(config.slab_size);
+    if (slab_count_ == 0) {
+      throw std::invalid_argument("Budget must hold at least one slab");
+    }
+    items_.resize(slab_count_ * slab_size_);
+    trees_.resize(slab_count_ * tree_stride());
+    generations_.resize(slab_count_ * slab_size_, 0);
+    slab_owners_.resize(slab_count_, kNoOwner);
+    free_slabs_.reserve(slab_count_);
+    for (size_t slab = slab_count_; slab-- > 0;) {
+      free_slabs_.push_back(slab);
+    }
+  }
+
+  /// @brief Bytes one slab of slab_size transitions takes from the budget.
+  static constexpr size_t slab_bytes(size_t slab_size) {
+    return slab_size * (sizeof(T) + 2 * sizeof(float) + sizeof(uint64_t));
+  }
+
+  size_t slab_size() const { return slab_size_; }
+
+  size_t slab_count() const { return slab_count_; }
+
+  /// @brief Transitions the whole pool can hold.
+  size_t capacity() const { return slab_count_ * slab_size_; }
+
+  size_t free_slabs() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return free_slabs_.size();
+  }
+
+  /// @brief Registers an empty buffer. It takes no memory until its first
+  /// add.
+  /// @return Id used by the other calls; ids are never reused
+  /// @throws std::invalid_argument if the name is taken or the weight is
+  /// negative
+  size_t create_buffer(const std::string& name,
+                       const RegistryBufferOptions& options = {}) {
+    check_weight(options.weight);
+    if (options.max_size == 0) {
+      throw std::invalid_argument("Max size must be greater than 0");
+    }
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    if (ids_.contains(name)) {
+      throw std::invalid_argument("Buffer name already in use");
+    }
+    auto buffer = std::make_unique<Buffer>();
+    buffer->id = buffers_.size();
+    buffer->name = name;
+    buffer->weight = options.weight;
+    buffer->max_slabs = options.max_size / slab_size_ +
+                        (options.max_size % slab_size_ != 0 ? 1 : 0);
+    ids_.emplace(name, buffers_.size());
+    buffers_.push_back(std::move(buffer));
+    return buffers_.size() - 1;
+  }
+
+  /// @throws std::out_of_range if no live buffer has this name
+  size_t buffer_id(const std::string& name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    const auto it = ids_.find(name);
+    if (it == ids_.end()) {
+      throw std::out_of_range("Unknown buffer name");
+    }
+    return it->second;
+  }
+
+  /// @brief Drops a buffer and returns its slabs to the pool. Handles to
+  /// its transitions become stale.
+  void remove_buffer(size_t id) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    Buffer& buffer = live(id);
+    while (!buffer.slabs.empty()) {
+      release_oldest_slab(buffer);
+    }
+    ids_.erase(buffer.name);
+    buffers_[id].reset();
+  }
+
+  void set_weight(size_t id, double weight) {
+    check_weight(weight);
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    live(id).weight = weight;
+  }
+
+  size_t size(size_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return size_of(live(id));
+  }
+
+  /// @brief Slabs the buffer currently holds.
+  size_t slabs(size_t id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return live(id).slabs.size();
+  }
+
+  /// @brief Adds a transition at the buffer's maximum priority.
+  /// @return Slot in the pool it was stored in
+  size_t add(size_t id, const T& item) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    Buffer& buffer = live(id);
+    const size_t slot = next_slot(buffer);
+    items_[slot] = item;
+    generations_[slot]++;
+    set_leaf(slot, std::pow(buffer.max_raw_priority, alpha_));
+    return slot;
+  }
+
+  /// @brief Adds transitions with caller-computed TD errors under a single
+  /// lock, updating each slab's tree in one coalesced pass.
+  void add_batch(size_t id, std::span<const T> items,
+                 std::span<const float> td_errors) {
+    if (items.size() != td_errors.size()) {
+      throw std::invalid_argument("Items and TD errors must have equal size");
+    }
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    Buffer& buffer = live(id);
+    size_t done = 0;
+    while (done < items.size()) {
+      const size_t first_slot = next_slot(buffer);
+      // next_slot() took one position; the run continues to the slab's end
+      const size_t offset = first_slot % slab_size_;
+      const size_t run = std::min(items.size() - done, slab_size_ - offset);
+      buffer.tail_fill += run - 1;
+      batch_priorities_.resize(run);
+      for (size_t i = 0; i < run; i++) {
+        const size_t slot = first_slot + i;
+        const float raw_priority = std::abs(td_errors[done + i]) + epsilon_;
+        buffer.max_raw_priority =
+            std::max(buffer.max_raw_priority, raw_priority);
+        batch_priorities_[i] = std::pow(raw_priority, alpha_);
+        items_[slot] = items[done + i];
+        generations_[slot]++;
+      }
+      detail::sum_tree_set_range(tree(first_slot / slab_size_), slab_size_,
+                                 offset, batch_priorities_);
+      done += run;
+    }
+  }
+
+  /// @brief Draws batch_size transitions in one call: each picks a buffer
+  /// with probability proportional to its weight, among non-empty buffers
+  /// with a positive weight, then a transition within it in proportion to
+  /// priority. Weights are (N * P(i))^-beta, with N the number of
+  /// transitions in those buffers and P(i) the overall probability.
+  /// @throws std::invalid_argument if batch_size is 0 or no buffer can be
+  /// sampled
+  std::vector<MixedSample<T>> sample(size_t batch_size) const {
+    if (batch_size == 0) {
+      throw std::invalid_argument("Batch size must be > 0");
+    }
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    // Per-slab totals of every candidate buffer, laid out buffer after
+    // buffer, so each draw is a binary search and one slab tree walk
+    candidates_.clear();
+    slab_prefix_.clear();
+    size_t population = 0;
+    double total_weight = 0.0;
+    for (size_t id = 0; id < buffers_.size(); id++) {
+      const Buffer* buffer = buffers_[id].get();
+      if (buffer == nullptr || buffer->weight <= 0.0 ||
+          buffer->slabs.empty()) {
+        continue;
+      }
+      const size_t first = slab_prefix_.size();
+      float sum = 0.0f;
+      for (size_t slab : buffer->slabs) {
+        sum += tree(slab)[0];
+        slab_prefix_.push_back(sum);
+      }
+      if (!(sum > 0.0f)) {
+        slab_prefix_.resize(first);
+        continue;
+      }
+      candidates_.push_back({id, first, sum});
+      population += size_of(*buffer);
+      total_weight += buffer->weight;
+    }
+    if (candidates_.empty()) {
+      throw std::invalid_argument("No buffer to sample from");
+    }
+    weights_.clear();
+    for (const Candidate& candidate : candidates_) {
+      weights_.push_back(buffers_[candidate.id]->weight);
+    }
+    std::discrete_distribution<size_t> pick_buffer(weights_.begin(),
+                                                   weights_.end());
+
+    std::vector<MixedSample<T>> samples;
+    samples.reserve(batch_size);
+    while (samples.size() < batch_size) {
+      const Candidate& candidate = candidates_[pick_buffer(gen_)];
+      const Buffer& buffer = *buffers_[candidate.id];
+      const auto prefix_first = slab_prefix_.begin() + candidate.first_prefix;
+      const auto prefix_last = prefix_first + buffer.slabs.size();
+      std::uniform_real_distribution<float> dist(0.0f, candidate.total);
+      const float value = dist(gen_);
+      const auto found = std::min(std::upper_bound(prefix_first, prefix_last,
+                                                   value),
+                                  prefix_last - 1);
+      const size_t k = static_cast<size_t>(found - prefix_first);
+      const size_t slab = buffer.slabs[k];
+      const float* slab_tree = tree(slab);
+      const float within = std::clamp(
+          value - (k == 0 ? 0.0f : *(found - 1)), 0.0f, slab_tree[0]);
+      const size_t offset =
+          detail::sum_tree_sample(slab_tree, slab_size_, within);
+      const float priority = slab_tree[slab_size_ - 1 + offset];
+      if (!(priority > 0.0f)) {
+        // Rounding at a subtree edge reached an empty leaf; draw again
+        continue;
+      }
+      const size_t slot = slab * slab_size_ + offset;
+      const double probability =
+          buffer.weight / total_weight * (priority / candidate.total);
+      const float weight = static_cast<float>(
+          std::pow(static_cast<double>(population) * probability, -beta_));
+      samples.push_back(MixedSample<T>{items_[slot], weight, candidate.id,
+                                       {slot, generations_[slot]}});
+    }
+    return samples;
+  }
+
+  /// @brief Updates the priorities of sampled transitions, skipping any
+  /// whose slot has since been overwritten or given to another buffer.
+  /// @return Number of updates applied
+  size_t update_priorities(const std::vector<SampleHandle>& handles,
+                           const std::vector<float>& td_errors) {
+    if (handles.size() != td_errors.size()) {
+      throw std::invalid_argument("Handles and TD errors must have equal size");
+    }
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    size_t applied = 0;
+    for (size_t i = 0; i < handles.size(); i++) {
+      const size_t slot = handles[i].index;
+      if (slot >= capacity()) {
+        throw std::out_of_range("Index out of range");
+      }
+      const size_t owner = slab_owners_[slot / slab_size_];
+      if (owner == kNoOwner || generations_[slot] != handles[i].generation) {
+        continue;
+      }
+      const float raw_priority = std::abs(td_errors[i]) + epsilon_;
+      Buffer& buffer = *buffers_[owner];
+      buffer.max_raw_priority = std::max(buffer.max_raw_priority, raw_priority);
+      set_leaf(slot, std::pow(raw_priority, alpha_));
+      applied++;
+    }
+    return applied;
+  }
+
+ private:
+  static constexpr size_t kNoOwner = std::numeric_limits<size_t>::max();
+
+  struct Buffer {
+    size_t id;
+    std::string name;
+    double weight;
+    size_t max_slabs;
+    // Oldest first; every slab but the newest is full
+    std::deque<size_t> slabs;
+    // Transitions in the newest slab
+    size_t tail_fill = 0;
+    // Largest |td| + epsilon seen; new transitions get it raised to alpha
+    float max_raw_priority = 1.0f;
+  };
+
+  struct Candidate {
+    size_t id;
+    // Start of the buffer's slab totals in slab_prefix_
+    size_t first_prefix;
+    float total;
+  };
+
+  static void check_weight(double weight) {
+    if (!(weight >= 0.0) || std::isinf(weight)) {
+      throw std::invalid_argument("Weight must be finite and >= 0");
+    }
+  }
+
+  /// Nodes per slab tree, in SumTree's layout
+  size_t tree_stride() const { return 2 * slab_size_; }
+
+  float* tree(size_t slab) { return trees_.data() + slab * tree_stride(); }
+
+  const float* tree(size_t slab) const {
+    return trees_.data() + slab * tree_stride();
+  }
+
+  void set_leaf(size_t slot, float priority) {
+    detail::sum_tree_set(tree(slot / slab_size_), slab_size_,
+                         slot % slab_size_, priority);
+  }
+
+  Buffer& live(size_t id) {
+    if (id >= buffers_.size() || buffers_[id] == nullptr) {
+      throw std::out_of_range("Unknown buffer id");
+    }
+    return *buffers_[id];
+  }
+
+  const Buffer& live(size_t id) const {
+    if (id >= buffers_.size() || buffers_[id] == nullptr) {
+      throw std::out_of_range("Unknown buffer id");
+    }
+    return *buffers_[id];
+  }
+
+  size_t size_of(const Buffer& buffer) const {
+    return buffer.slabs.empty()
+               ? 0
+               : (buffer.slabs.size() - 1) * slab_size_ + buffer.tail_fill;
+  }
+
+  /// @brief Claims the next slot of buffer's newest slab, first giving it a
+  /// new slab if that one is full.
+  size_t next_slot(Buffer& buffer) {
+    if (buffer.slabs.empty() || buffer.tail_fill == slab_size_) {
+      buffer.slabs.push_back(acquire_slab(buffer));
+      slab_owners_[buffer.slabs.back()] = buffer.id;
+      buffer.tail_fill = 0;
+    }
+    return buffer.slabs.back() * slab_size_ + buffer.tail_fill++;
+  }
+
+  /// @brief A cleared slab for buffer: its own oldest at its cap, else a
+  /// free one, else the oldest of the buffer holding the most slabs.
+  size_t acquire_slab(Buffer& buffer) {
+    Buffer* victim = &buffer;
+    if (buffer.slabs.size() < buffer.max_slabs) {
+      if (!free_slabs_.empty()) {
+        const size_t slab = free_slabs_.back();
+        free_slabs_.pop_back();
+        return slab;
+      }
+      for (const std::unique_ptr<Buffer>& other : buffers_) {
+        if (other != nullptr && other->slabs.size() > victim->slabs.size()) {
+          victim = other.get();
+        }
+      }
+    }
+    release_oldest_slab(*victim);
+    const size_t slab = free_slabs_.back();
+    free_slabs_.pop_back();
+    return slab;
+  }
+
+  /// @brief Evicts the transitions of buffer's oldest slab and returns it
+  /// to the free list, cleared.
+  void release_oldest_slab(Buffer& buffer) {
+    const size_t slab = buffer.slabs.front();
+    buffer.slabs.pop_front();
+    if (buffer.slabs.empty()) {
+      buffer.tail_fill = 0;
+    }
+    std::fill_n(tree(slab), tree_stride(), 0.0f);
+    // Invalidate outstanding handles to the evicted transitions
+    for (size_t slot = slab * slab_size_; slot < (slab + 1) * slab_size_;
+         slot++) {
+      generations_[slot]++;
+    }
+    slab_owners_[slab] = kNoOwner;
+    free_slabs_.push_back(slab);
+  }
+
+  size_t slab_size_;
+  size_t slab_count_;
+  float alpha_;
+  float beta_;
+  float epsilon_;
+  mutable std::shared_mutex mutex_;
+  // The pool: slab s owns slots [s * slab_size_, (s + 1) * slab_size_) of
+  // items_ and generations_, and tree nodes from s * tree_stride()
+  std::vector<T> items_;
+  std::vector<float> trees_;
+  std::vector<uint64_t> generations_;
+  std::vector<size_t> slab_owners_;
+  std::vector<size_t> free_slabs_;
+  // Indexed by id; null once removed
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+  std::unordered_map<std::string, size_t> ids_;
+  mutable std::mt19937 gen_;
+  // Scratch reused across calls, guarded by the exclusive lock
+  std::vector<float> batch_priorities_;
+  mutable std::vector<Candidate> candidates_;
+  mutable std::vector<float> slab_prefix_;
+  mutable std::vector<double> weights_;
+};
+}  // namespace replay_buffer
@@ -4,31 +4,90 @@
 /// @brief Fixed-capacity circular buffer with automatic wraparound.
 /// When the buffer is full, new additions overwrite the oldest elements.
 /// Provides O(1) add and access operations.
+/// For trivially copyable element types, load() reads without taking the
+/// lock: every slot carries a seqlock version that writers bump around each
+/// overwrite, and readers retry until they copy out an unchanged element.
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <random>
 #include <shared_mutex>
+#include <span>
 #include <stdexcept>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include "replay_buffer/metrics.h"
+#include "replay_buffer/philox.h"
+#include "replay_buffer/thread_pool.h"
+#include "replay_buffer/trace.h"
+
 namespace replay_buffer {
+/// @brief Physical slots written by one batch insertion: first, first + 1,
+/// ..., first + count - 1, each taken modulo the buffer capacity.
+struct IndexRange {
+  size_t first;
+  size_t count;
+};
+
+/// @brief What a full buffer does with a new item.
+enum class RetentionPolicy {
+  /// Overwrite the oldest item: the buffer holds the most recent capacity
+  /// items.
+  kFifo,
+  /// Reservoir sampling (Algorithm L): the buffer holds a uniform sample of
+  /// every item added since construction or the last clear(). Most items
+  /// are rejected in O(1) without being copied; accepted ones overwrite a
+  /// uniformly random slot.
+  kReservoir,
+};
+
 /// @brief Fixed-capacity circular buffer with automatic wraparound.
-/// When the buffer is full, new additions overwrite the oldest elements.
+/// When the buffer is full, new additions overwrite the oldest elements
+/// (or, with RetentionPolicy::kReservoir, a random element or none).
 /// Provides O(1) add and access operations.
 /// @tparam T Type of elements stored in the buffer
 template <typename T>
 class CircularBuffer {
  public:
-  explicit CircularBuffer(size_t capacity) {
+  using value_type = T;
+
+  /// Returned by add() when reservoir retention rejects the item.
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+  /// Smallest batch that sample(batch_size, pool) splits across threads
+  static constexpr size_t kParallelSampleThreshold = 4096;
+  /// Smallest share of a parallel batch given to one task
+  static constexpr size_t kMinSamplesPerTask = 1024;
+
+  explicit CircularBuffer(size_t capacity,
+                          RetentionPolicy retention = RetentionPolicy::kFifo) {
     if (capacity == 0) {
       throw std::invalid_argument("Capacity must be greater than 0");
     }
     capacity_ = capacity;
+    retention_ = retention;
     size_ = 0;
     buffer_.resize(capacity_);
     head_ = 0;
     tail_ = 0;
+    writes_ = 0;
+    offered_ = 0;
+    next_accept_ = 0;
+    reservoir_weight_ = 0.0;
     gen_ = std::mt19937(std::random_device{}());
+    if constexpr (kLockFreeLoads) {
+      versions_ = std::make_unique<std::atomic<uint64_t>[]>(capacity_);
+    }
   }
 
   size_t size() const {
@@ -51,34 +110,126 @@ class CircularBuffer {
     return size_ == 0;
   }
 
-  size_t add(const T& item) {
+  /// @return Physical slot the item was stored in, or npos if reservoir
+  /// retention rejected it
+  size_t add(const T& item) { return store(item); }
+
+  /// @brief Moves the item into the buffer instead of copying it.
+  size_t add(T&& item) { return store(std::move(item)); }
+
+  /// @brief Constructs an item from args and moves it into the next slot.
+  /// Slots always hold live objects, so this is one construction plus a move
+  /// assignment rather than construction in place.
+  template <typename... Args>
+  size_t emplace(Args&&... args) {
+    return store(T(std::forward<Args>(args)...));
+  }
+
+  /// @brief Adds items in order under a single lock, with at most two
+  /// contiguous copies (before and after the wrap seam). Equivalent to
+  /// calling add() on each item; if there are more items than capacity, only
+  /// the last capacity of them are stored. With reservoir retention, items
+  /// beyond the free slots are offered to the reservoir one by one.
+  /// @return Slots the stored items were written to. With reservoir
+  /// retention only items stored in free slots are included.
+  IndexRange add_batch(std::span<const T> items) {
+    return add_batch(items.begin(), items.end());
+  }
+
+  /// @brief Iterator form of add_batch(). Pass std::move_iterator to move
+  /// the items instead of copying them.
+  template <std::input_iterator Iter>
+    requires std::sized_sentinel_for<Iter, Iter>
+  IndexRange add_batch(Iter first, Iter last) {
+    TraceSpan span("CircularBuffer::add_batch");
+    const uint64_t start = metrics_.now();
+    TraceSpan lock_span("CircularBuffer::lock_wait");
     std::lock_guard<std::shared_mutex> lock(mutex_);
-    size_t stored_index;
-    // Case 1: Buffer is not full, insert at tail and increment tail
-    if (size_ != capacity_) {
-      buffer_[tail_] = item;
-      stored_index = tail_;
-      tail_ = (tail_ + 1) % capacity_;
-      size_++;
+    lock_span.end();
+    metrics_.record_lock_wait(start);
+    size_t count = static_cast<size_t>(last - first);
+    size_t reservoir_count = 0;
+    if (retention_ == RetentionPolicy::kReservoir) {
+      reservoir_count = count - std::min(count, capacity_ - size_);
+      count -= reservoir_count;
     }
-    // Case 2: Buffer is full, overwrite oldest element and increment tail and
-    // head
-    else {
-      buffer_[tail_] = item;
-      stored_index = tail_;
-      tail_ = (tail_ + 1) % capacity_;
-      head_ = (head_ + 1) % capacity_;
+    // Items that a later item in the same batch would overwrite are skipped
+    const size_t stored = std::min(count, capacity_);
+    std::ranges::advance(first, count - stored);
+    tail_ = (tail_ + count - stored) % capacity_;
+
+    const size_t first_slot = tail_;
+    const uint64_t first_write = writes_ + count - stored;
+    begin_slot_writes(first_slot, stored, first_write);
+    const size_t before_seam = std::min(stored, capacity_ - tail_);
+    std::copy_n(first, before_seam, buffer_.begin() + tail_);
+    std::ranges::advance(first, before_seam);
+    std::copy_n(first, stored - before_seam, buffer_.begin());
+    std::ranges::advance(first, stored - before_seam);
+    end_slot_writes(first_slot, stored, first_write);
+
+    const size_t evicted =
+        size_ + count > capacity_ ? size_ + count - capacity_ : 0;
+    tail_ = (tail_ + stored) % capacity_;
+    size_ = std::min(size_ + count, capacity_);
+    if (size_ == capacity_) {
+      head_ = tail_;
     }
-    // Return the index of the added item
-    return stored_index;
+    writes_ += count;
+    offered_ += count;
+    if (retention_ == RetentionPolicy::kReservoir && count > 0 &&
+        size_ == capacity_ && offered_ == capacity_) {
+      start_reservoir();
+    }
+    publish();
+    metrics_.add_evictions(evicted);
+    for (size_t i = 0; i < reservoir_count; i++, ++first) {
+      offer_to_reservoir(*first);
+    }
+    metrics_.record(MetricsOperation::kAdd, start);
+    return {first_slot, stored};
   }
 
+  /// @brief Removes all elements. Storage is kept, and the next add()
+  /// continues at the current tail slot.
   void clear() {
     std::lock_guard<std::shared_mutex> lock(mutex_);
-    buffer_.clear();
     size_ = 0;
-    head_ = 0;
-    tail_ = 0;
+    head_ = tail_;
+    offered_ = 0;
+    publish();
+  }
+
+  /// @brief Copies out the element at a logical index without locking.
+  /// Retries while a writer is overwriting the slot, and re-reads the
+  /// buffer position if the element was evicted meanwhile, so the result is
+  /// always an element that was at that index at some point during the
+  /// call. Unlike operator[], the returned copy cannot change afterwards.
+  /// Writes made through the non-const operator[] or at() are not versioned
+  /// and may be observed torn.
+  T load(size_t index) const
+    requires std::is_trivially_copyable_v<T>
+  {
+    for (;;) {
+      uint64_t writes;
+      uint64_t size;
+      read_position(writes, size);
+      if (index >= size) {
+        throw std::out_of_range("Index out of range");
+      }
+      const uint64_t write = writes - size + index;
+      const size_t slot = write % capacity_;
+      const uint64_t version = versions_[slot].load(std::memory_order_acquire);
+      if (version % 2 != 0 || version >> kVersionWriteShift != write + 1) {
+        continue;
+      }
+      T result;
+      std::memcpy(static_cast<void*>(&result), &buffer_[slot], sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (versions_[slot].load(std::memory_order_relaxed) == version) {
+        return result;
+      }
+    }
   }
 
   T& operator[](size_t index) {
@@ -113,8 +264,53 @@ class CircularBuffer {
     return buffer_[(head_ + index) % capacity_];
   }
 
+  /// @brief Overwrites the element in a live slot in place. It keeps its
+  /// logical position; nothing is evicted and head/tail do not move. Used
+  /// by owners that pick eviction victims themselves.
+  template <typename U>
+  void replace(size_t slot, U&& item) {
+    const uint64_t start = metrics_.now();
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    metrics_.record_lock_wait(start);
+    if (slot >= capacity_ || (slot + capacity_ - head_) % capacity_ >= size_) {
+      throw std::out_of_range("Slot out of range");
+    }
+    replace_slot(slot, std::forward<U>(item));
+    metrics_.record(MetricsOperation::kAdd, start);
+  }
+
+  /// @brief Accesses an element by physical slot, as returned by add() and
+  /// add_batch(), rather than by logical position.
+  const T& at_slot(size_t slot) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (slot >= capacity_ || (slot + capacity_ - head_) % capacity_ >= size_) {
+      throw std::out_of_range("Slot out of range");
+    }
+    return buffer_[slot];
+  }
+
+  /// @brief Calls fn(i, element) for the element in each slots[i], under a
+  /// single shared lock. Lets parallel gathers avoid one lock per element.
+  template <typename F>
+  void visit_slots(std::span<const size_t> slots, F&& fn) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (size_t i = 0; i < slots.size(); i++) {
+      const size_t slot = slots[i];
+      if (slot >= capacity_ ||
+          (slot + capacity_ - head_) % capacity_ >= size_) {
+        throw std::out_of_range("Slot out of range");
+      }
+      fn(i, buffer_[slot]);
+    }
+  }
+
   std::vector<T> sample(size_t batch_size) const {
+    TraceSpan span("CircularBuffer::sample");
+    const uint64_t start = metrics_.now();
+    TraceSpan lock_span("CircularBuffer::lock_wait");
     std::lock_guard<std::shared_mutex> lock(mutex_);
+    lock_span.end();
+    metrics_.record_lock_wait(start);
 
     if (batch_size <= 0) {
       throw std::invalid_argument("Batch size must be > 0");
@@ -133,16 +329,341 @@ class CircularBuffer {
       result.push_back(buffer_[(head_ + index) % capacity_]);
     }
 
+    metrics_.add_samples(batch_size);
+    metrics_.record(MetricsOperation::kSample, start);
+    return result;
+  }
+
+  /// @brief Same as sample(), with large batches split across pool: each
+  /// task draws from its own RNG stream, seeded from this buffer's
+  /// generator, and copies straight into its part of the result. Batches
+  /// below kParallelSampleThreshold take the single-threaded path.
+  std::vector<T> sample(size_t batch_size, ThreadPool& pool) const {
+    if (batch_size < kParallelSampleThreshold || pool.size() == 0) {
+      return sample(batch_size);
+    }
+    TraceSpan span("CircularBuffer::sample");
+    const uint64_t start = metrics_.now();
+    TraceSpan lock_span("CircularBuffer::lock_wait");
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    lock_span.end();
+    metrics_.record_lock_wait(start);
+    if (batch_size > size_) {
+      throw std::invalid_argument("Batch size exceeds buffer size");
+    }
+
+    std::vector<T> result(batch_size);
+    const size_t tasks = pool.task_count(batch_size, kMinSamplesPerTask);
+    std::vector<std::mt19937::result_type> seeds(tasks);
+    std::generate(seeds.begin(), seeds.end(), std::ref(gen_));
+    pool.parallel_for(tasks, [&](size_t task) {
+      std::mt19937 rng(seeds[task]);
+      std::uniform_int_distribution<size_t> dist(0, size_ - 1);
+      const size_t last = (task + 1) * batch_size / tasks;
+      for (size_t i = task * batch_size / tasks; i < last; i++) {
+        result[i] = buffer_[(head_ + dist(rng)) % capacity_];
+      }
+    });
+
+    metrics_.add_samples(batch_size);
+    metrics_.record(MetricsOperation::kSample, start);
+    return result;
+  }
+
+  /// @brief Reproducible sample(): element i of the batch is drawn from
+  /// Philox4x32 keyed by (key, i) instead of the shared generator, so the
+  /// same key over the same contents always gives the same batch.
+  /// Concurrent keyed samplers share the lock and do not interleave.
+  /// @throws std::invalid_argument if batch_size is 0, exceeds the size or
+  /// exceeds kMaxKeyedBatchSize
+  std::vector<T> sample(size_t batch_size, const SampleKey& key) const {
+    return sample_keyed(batch_size, key, nullptr);
+  }
+
+  /// @brief Keyed sample() with large batches split across pool. The batch
+  /// is identical to the single-threaded one for any pool size.
+  std::vector<T> sample(size_t batch_size, const SampleKey& key,
+                        ThreadPool& pool) const {
+    return sample_keyed(batch_size, key, &pool);
+  }
+
+  /// @brief Samples batch_size distinct elements uniformly, without
+  /// replacement. Uses Floyd's algorithm, so the cost is O(batch_size)
+  /// regardless of the buffer size.
+  std::vector<T> sample_without_replacement(size_t batch_size) const {
+    const uint64_t start = metrics_.now();
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    metrics_.record_lock_wait(start);
+
+    if (batch_size <= 0) {
+      throw std::invalid_argument("Batch size must be > 0");
+    }
+    if (batch_size > size_) {
+      throw std::invalid_argument("Batch size exceeds buffer size");
+    }
+
+    // Floyd: for each j in [size - batch, size), draw t in [0, j] and take
+    // t, or j itself if t was already taken
+    std::unordered_set<size_t> chosen;
+    chosen.reserve(batch_size);
+    std::vector<size_t> indices;
+    indices.reserve(batch_size);
+    for (size_t j = size_ - batch_size; j < size_; j++) {
+      size_t index = std::uniform_int_distribution<size_t>(0, j)(gen_);
+      if (!chosen.insert(index).second) {
+        index = j;
+        chosen.insert(j);
+      }
+      indices.push_back(index);
+    }
+    // Floyd picks a uniform subset but not a uniform order (j tends to come
+    // late), so shuffle the batch
+    std::shuffle(indices.begin(), indices.end(), gen_);
+
+    std::vector<T> result;
+    result.reserve(batch_size);
+    for (const size_t index : indices) {
+      result.push_back(buffer_[(head_ + index) % capacity_]);
+    }
+
+    metrics_.add_samples(batch_size);
+    metrics_.record(MetricsOperation::kSample, start);
     return result;
   }
 
+  /// @brief Aggregates the buffer's latency histograms and counters without
+  /// blocking writers. Empty unless REPLAY_BUFFER_ENABLE_METRICS is defined.
+  MetricsSnapshot metrics_snapshot() const { return metrics_.snapshot(); }
+
  private:
+  std::vector<T> sample_keyed(size_t batch_size, const SampleKey& key,
+                              ThreadPool* pool) const {
+    TraceSpan span("CircularBuffer::sample");
+    const uint64_t start = metrics_.now();
+    TraceSpan lock_span("CircularBuffer::lock_wait");
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    lock_span.end();
+    metrics_.record_lock_wait(start);
+    if (batch_size <= 0) {
+      throw std::invalid_argument("Batch size must be > 0");
+    }
+    if (batch_size > size_) {
+      throw std::invalid_argument("Batch size exceeds buffer size");
+    }
+    if (batch_size > kMaxKeyedBatchSize) {
+      throw std::invalid_argument("Keyed batch size too large");
+    }
+
+    std::vector<T> result(batch_size);
+    const auto draw = [&](size_t first, size_t last) {
+      detail::for_each_sample_bits(key, first, last,
+                                   [&](size_t i, uint64_t bits) {
+        const size_t index = detail::scale_to_index(bits, size_);
+        result[i] = buffer_[(head_ + index) % capacity_];
+      });
+    };
+    if (pool == nullptr || batch_size < kParallelSampleThreshold ||
+        pool->size() == 0) {
+      draw(0, batch_size);
+    } else {
+      const size_t tasks = pool->task_count(batch_size, kMinSamplesPerTask);
+      pool->parallel_for(tasks, [&](size_t task) {
+        draw(task * batch_size / tasks, (task + 1) * batch_size / tasks);
+      });
+    }
+
+    metrics_.add_samples(batch_size);
+    metrics_.record(MetricsOperation::kSample, start);
+    return result;
+  }
+
+  template <typename U>
+  size_t store(U&& item) {
+    TraceSpan span("CircularBuffer::add");
+    const uint64_t start = metrics_.now();
+    TraceSpan lock_span("CircularBuffer::lock_wait");
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    lock_span.end();
+    metrics_.record_lock_wait(start);
+    if (retention_ == RetentionPolicy::kReservoir && size_ == capacity_) {
+      const size_t slot = offer_to_reservoir(std::forward<U>(item));
+      metrics_.record(MetricsOperation::kAdd, start);
+      return slot;
+    }
+    size_t stored_index;
+    begin_slot_writes(tail_, 1, writes_);
+    // Case 1: Buffer is not full, insert at tail and increment tail
+    if (size_ != capacity_) {
+      buffer_[tail_] = std::forward<U>(item);
+      end_slot_writes(tail_, 1, writes_);
+      stored_index = tail_;
+      tail_ = (tail_ + 1) % capacity_;
+      size_++;
+    }
+    // Case 2: Buffer is full, overwrite oldest element and increment tail and
+    // head
+    else {
+      buffer_[tail_] = std::forward<U>(item);
+      end_slot_writes(tail_, 1, writes_);
+      stored_index = tail_;
+      tail_ = (tail_ + 1) % capacity_;
+      head_ = (head_ + 1) % capacity_;
+      metrics_.add_evictions(1);
+    }
+    writes_++;
+    offered_++;
+    if (retention_ == RetentionPolicy::kReservoir && size_ == capacity_) {
+      start_reservoir();
+    }
+    publish();
+    metrics_.record(MetricsOperation::kAdd, start);
+    // Return the index of the added item
+    return stored_index;
+  }
+
+  /// @brief Overwrites a live slot in place, keeping its logical position.
+  /// Called with the exclusive lock held.
+  template <typename U>
+  void replace_slot(size_t slot, U&& item) {
+    if constexpr (kLockFreeLoads) {
+      // Keep the write number of the logical position so load() still maps
+      // the index to this slot, and bump the replace count so a reader that
+      // overlapped the copy sees a different version
+      const uint64_t version = versions_[slot].load(std::memory_order_relaxed);
+      versions_[slot].store(version | 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      buffer_[slot] = std::forward<U>(item);
+      const uint64_t replace_mask = (1ull << kVersionWriteShift) - 2;
+      const uint64_t replaces = (version + 2) & replace_mask;
+      versions_[slot].store(
+          (version >> kVersionWriteShift << kVersionWriteShift) | replaces,
+          std::memory_order_release);
+    } else {
+      buffer_[slot] = std::forward<U>(item);
+    }
+  }
+
+  // Algorithm L (Li, 1994). Instead of drawing a random number per item,
+  // draw how many items to skip before the next one that enters the
+  // reservoir. reservoir_weight_ is the running W of the algorithm.
+  double reservoir_uniform() {
+    return std::uniform_real_distribution<double>(
+        std::numeric_limits<double>::min(), 1.0)(gen_);
+  }
+
+  void advance_reservoir(uint64_t offer) {
+    reservoir_weight_ *= std::exp(std::log(reservoir_uniform()) /
+                                  static_cast<double>(capacity_));
+    const double skip = std::floor(std::log(reservoir_uniform()) /
+                                   std::log1p(-reservoir_weight_));
+    // Saturate: a skip this large is never reached anyway
+    next_accept_ = offer + 1 +
+                   static_cast<uint64_t>(std::min(skip, 0x1p62));
+  }
+
+  /// @brief Called when the buffer first becomes full in reservoir mode.
+  void start_reservoir() {
+    reservoir_weight_ = 1.0;
+    advance_reservoir(offered_ - 1);
+  }
+
+  /// @brief Offers an item to the full reservoir. Rejected items cost one
+  /// comparison; accepted ones overwrite a uniformly random slot.
+  /// @return Slot written, or npos if the item was rejected
+  template <typename U>
+  size_t offer_to_reservoir(U&& item) {
+    const uint64_t offer = offered_++;
+    if (offer != next_accept_) {
+      return npos;
+    }
+    const size_t slot =
+        std::uniform_int_distribution<size_t>(0, capacity_ - 1)(gen_);
+    replace_slot(slot, std::forward<U>(item));
+    advance_reservoir(offer);
+    metrics_.add_evictions(1);
+    return slot;
+  }
+
+  // Seqlock bookkeeping for load(). Called with the exclusive lock held,
+  // and compiled out for types load() does not support.
+  void begin_slot_writes(size_t first_slot, size_t count,
+                         uint64_t first_write) {
+    if constexpr (kLockFreeLoads) {
+      for (size_t i = 0; i < count; i++) {
+        versions_[(first_slot + i) % capacity_].store(
+            (first_write + i + 1) << kVersionWriteShift | 1,
+            std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_release);
+    }
+  }
+
+  void end_slot_writes(size_t first_slot, size_t count,
+                       uint64_t first_write) {
+    if constexpr (kLockFreeLoads) {
+      for (size_t i = 0; i < count; i++) {
+        versions_[(first_slot + i) % capacity_].store(
+            (first_write + i + 1) << kVersionWriteShift,
+            std::memory_order_release);
+      }
+    }
+  }
+
+  /// @brief Publishes writes_ and size_ for lock-free readers under a
+  /// buffer-wide seqlock.
+  void publish() {
+    if constexpr (kLockFreeLoads) {
+      const uint64_t sequence =
+          position_sequence_.load(std::memory_order_relaxed);
+      position_sequence_.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      published_writes_.store(writes_, std::memory_order_relaxed);
+      published_size_.store(size_, std::memory_order_relaxed);
+      position_sequence_.store(sequence + 2, std::memory_order_release);
+    }
+  }
+
+  void read_position(uint64_t& writes, uint64_t& size) const {
+    for (;;) {
+      const uint64_t sequence =
+          position_sequence_.load(std::memory_order_acquire);
+      if (sequence % 2 != 0) {
+        continue;
+      }
+      writes = published_writes_.load(std::memory_order_relaxed);
+      size = published_size_.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (position_sequence_.load(std::memory_order_relaxed) == sequence) {
+        return;
+      }
+    }
+  }
+
+  static constexpr bool kLockFreeLoads = std::is_trivially_copyable_v<T>;
+  // Slot version layout: bits 16 and up hold 1 + the write number stored in
+  // the slot (0 = never written), bits 1-15 count in-place replace() calls
+  // and bit 0 is set while the slot is being written.
+  static constexpr unsigned kVersionWriteShift = 16;
+
   size_t capacity_;
+  RetentionPolicy retention_;
   std::vector<T> buffer_;
   size_t size_;
   size_t head_;
   size_t tail_;
+  // Total number of items ever added; tail_ == writes_ % capacity_
+  uint64_t writes_;
+  // Reservoir retention: items offered since the last clear(), the offer
+  // number of the next item to accept, and Algorithm L's W
+  uint64_t offered_;
+  uint64_t next_accept_;
+  double reservoir_weight_;
+  std::unique_ptr<std::atomic<uint64_t>[]> versions_;
+  std::atomic<uint64_t> position_sequence_{0};
+  std::atomic<uint64_t> published_writes_{0};
+  std::atomic<uint64_t> published_size_{0};
   mutable std::shared_mutex mutex_;
   mutable std::mt19937 gen_;
+  [[no_unique_address]] mutable BufferMetrics metrics_;
 };
 }  // namespace replay_buffer
@@ -0,0 +1,124 @@
+#pragma once
+
+/// @file concurrent_sum_tree.h
+/// @brief Sum tree that many threads can update and sample without a lock.
+/// Priorities are stored as 64-bit fixed-point integers, and set() adds the
+/// integer delta to every ancestor with an atomic fetch_add. Integer
+/// addition is exact and commutative, so the sums match the leaves exactly
+/// once updates quiesce, whatever order they ran in.
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace replay_buffer {
+/// @brief Lock-free counterpart of SumTree, with the same 0-indexed layout
+/// (root at 0, leaf i at capacity - 1 + i) and the same interface.
+/// Concurrent set() calls, including to the same leaf, are safe. A sample()
+/// racing with updates may see some of them in one subtree and not in
+/// another; it still returns a valid leaf, and avoids subtrees whose sum it
+/// reads as zero.
+class ConcurrentSumTree {
+ public:
+  /// Fixed-point resolution: priorities are rounded to multiples of
+  /// 2^-kFractionBits (about 6e-8)
+  static constexpr unsigned kFractionBits = 24;
+  /// Largest priority a leaf can hold. The total must also stay below
+  /// 2^(64 - kFractionBits), about 1.1e12.
+  static constexpr float kMaxPriority = 1e9f;
+
+  explicit ConcurrentSumTree(size_t capacity) : capacity_(capacity) {
+    if (capacity == 0) {
+      throw std::invalid_argument("Capacity must be greater than 0");
+    }
+    tree_ = std::make_unique<std::atomic<uint64_t>[]>(2 * capacity_ - 1);
+  }
+
+  size_t capacity() const { return capacity_; }
+
+  /// @brief Sets a leaf and adds the change to each ancestor. Safe to call
+  /// from any number of threads at once.
+  void set(size_t index, float priority) {
+    if (index >= capacity_) {
+      throw std::out_of_range("Index out of range");
+    }
+    if (!(priority >= 0.0f && priority <= kMaxPriority)) {
+      throw std::invalid_argument("Priority must be in [0, kMaxPriority]");
+    }
+    size_t node = capacity_ - 1 + index;
+    const uint64_t value = to_fixed(priority);
+    // Unsigned wraparound makes new - old a valid delta in either direction
+    const uint64_t delta =
+        value - tree_[node].exchange(value, std::memory_order_relaxed);
+    if (delta == 0) {
+      return;
+    }
+    while (node > 0) {
+      node = (node - 1) / 2;
+      tree_[node].fetch_add(delta, std::memory_order_relaxed);
+    }
+  }
+
+  float get(size_t index) const {
+    if (index >= capacity_) {
+      throw std::out_of_range("Index out of range");
+    }
+    return from_fixed(
+        tree_[capacity_ - 1 + index].load(std::memory_order_relaxed));
+  }
+
+  float total() const { return from_fixed(total_fixed()); }
+
+  /// @brief The exact fixed-point total.
+  uint64_t total_fixed() const {
+    return tree_[0].load(std::memory_order_relaxed);
+  }
+
+  /// @brief Finds the leaf whose prefix-sum range contains value, as
+  /// SumTree::sample() does.
+  size_t sample(float value) const {
+    if (!(value >= 0.0f) || value > total()) {
+      throw std::out_of_range("Sample value out of range [0, total]");
+    }
+    return sample_fixed(to_fixed(value));
+  }
+
+  /// @brief sample() for a fixed-point prefix sum, e.g. a uniform draw in
+  /// [0, total_fixed()).
+  size_t sample_fixed(uint64_t value) const {
+    size_t node = 0;
+    while (node < capacity_ - 1) {
+      const uint64_t left =
+          tree_[2 * node + 1].load(std::memory_order_relaxed);
+      // A concurrent update can leave value past this subtree's children;
+      // only go right into a subtree that has something to sample
+      if (value < left ||
+          tree_[2 * node + 2].load(std::memory_order_relaxed) == 0) {
+        node = 2 * node + 1;
+        value = value < left ? value : (left > 0 ? left - 1 : 0);
+      } else {
+        value -= left;
+        node = 2 * node + 2;
+      }
+    }
+    return node - capacity_ + 1;
+  }
+
+  static uint64_t to_fixed(float priority) {
+    return static_cast<uint64_t>(std::llround(
+        std::ldexp(static_cast<double>(priority), kFractionBits)));
+  }
+
+  static float from_fixed(uint64_t value) {
+    return static_cast<float>(std::ldexp(static_cast<double>(value),
+                                         -static_cast<int>(kFractionBits)));
+  }
+
+ private:
+  size_t capacity_;
+  std::unique_ptr<std::atomic<uint64_t>[]> tree_;
+};
+}  // namespace replay_buffer
@@ -0,0 +1,223 @@
+#pragma once
+
+/// @file metrics.h
+/// @brief Optional latency histograms and counters for the buffers.
+/// Instrumentation is compiled in only when REPLAY_BUFFER_ENABLE_METRICS is
+/// defined (CMake option of the same name). Otherwise BufferMetrics is an
+/// empty type whose methods are no-ops, and the buffers pay nothing.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace replay_buffer {
+
+#if defined(REPLAY_BUFFER_ENABLE_METRICS)
+inline constexpr bool kMetricsEnabled = true;
+#else
+inline constexpr bool kMetricsEnabled = false;
+#endif
+
+/// @brief Histogram of latencies in power-of-two nanosecond buckets.
+/// Bucket 0 holds 0ns; bucket b > 0 holds latencies in [2^(b-1), 2^b) ns.
+struct LatencyHistogram {
+  static constexpr size_t kNumBuckets = 64;
+
+  std::array<uint64_t, kNumBuckets> buckets{};
+  uint64_t count = 0;
+  uint64_t total_ns = 0;
+  uint64_t max_ns = 0;
+
+  static size_t bucket_for(uint64_t ns) {
+    return std::min<size_t>(std::bit_width(ns), kNumBuckets - 1);
+  }
+
+  double mean_ns() const {
+    return count == 0 ? 0.0 : static_cast<double>(total_ns) / count;
+  }
+
+  /// @brief Estimates a latency percentile by interpolating inside the bucket
+  /// that contains it.
+  /// @param p Percentile in [0, 100]
+  double percentile(double p) const {
+    if (count == 0) {
+      return 0.0;
+    }
+    const double rank = p / 100.0 * static_cast<double>(count);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kNumBuckets; b++) {
+      if (buckets[b] == 0) {
+        continue;
+      }
+      if (static_cast<double>(seen + buckets[b]) >= rank) {
+        const double lower = b == 0 ? 0.0 : static_cast<double>(1ull << (b - 1));
+        const double upper = b == 0 ? 0.0 : lower * 2.0;
+        const double fraction =
+            (rank - static_cast<double>(seen)) / static_cast<double>(buckets[b]);
+        return std::min(lower + fraction * (upper - lower),
+                        static_cast<double>(max_ns));
+      }
+      seen += buckets[b];
+    }
+    return static_cast<double>(max_ns);
+  }
+};
+
+/// @brief Point-in-time aggregate of a buffer's metrics.
+struct MetricsSnapshot {
+  LatencyHistogram add;
+  LatencyHistogram sample;
+  LatencyHistogram update_priorities;
+  /// Time callers spent waiting to acquire the buffer's shared_mutex.
+  LatencyHistogram lock_wait;
+  uint64_t evictions = 0;
+  /// Number of items returned by sample() calls (not the number of calls).
+  uint64_t samples = 0;
+  uint64_t priority_updates = 0;
+  /// Priority updates dropped because their slot was overwritten since the
+  /// sample they refer to.
+  uint64_t stale_priority_updates = 0;
+};
+
+enum class MetricsOperation { kAdd, kSample, kUpdatePriorities, kLockWait };
+
+namespace detail {
+/// @brief Lock-free metrics recorder sharded per thread.
+/// Each thread is assigned a cache-line aligned shard on first use and
+/// updates it with relaxed atomics, so recording never contends with other
+/// threads (unless more than kNumShards threads are active).
+/// snapshot() sums the shards without stopping writers.
+class AtomicBufferMetrics {
+ public:
+  static constexpr size_t kNumShards = 16;
+
+  AtomicBufferMetrics() : shards_(std::make_unique<Shard[]>(kNumShards)) {}
+
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /// @brief Records the time elapsed since start for an operation.
+  void record(MetricsOperation operation, uint64_t start_ns) {
+    const uint64_t elapsed = now() - start_ns;
+    Histogram& histogram =
+        shards_[shard_index()].histograms[static_cast<size_t>(operation)];
+    histogram.buckets[LatencyHistogram::bucket_for(elapsed)].fetch_add(
+        1, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    histogram.total_ns.fetch_add(elapsed, std::memory_order_relaxed);
+    uint64_t current = histogram.max_ns.load(std::memory_order_relaxed);
+    while (current < elapsed &&
+           !histogram.max_ns.compare_exchange_weak(current, elapsed,
+                                                   std::memory_order_relaxed)) {
+    }
+  }
+
+  void record_lock_wait(uint64_t start_ns) {
+    record(MetricsOperation::kLockWait, start_ns);
+  }
+
+  void add_evictions(uint64_t count) {
+    shards_[shard_index()].evictions.fetch_add(count,
+                                               std::memory_order_relaxed);
+  }
+
+  void add_samples(uint64_t count) {
+    shards_[shard_index()].samples.fetch_add(count, std::memory_order_relaxed);
+  }
+
+  void add_priority_updates(uint64_t count) {
+    shards_[shard_index()].priority_updates.fetch_add(
+        count, std::memory_order_relaxed);
+  }
+
+  void add_stale_priority_updates(uint64_t count) {
+    shards_[shard_index()].stale_priority_updates.fetch_add(
+        count, std::memory_order_relaxed);
+  }
+
+  MetricsSnapshot snapshot() const {
+    MetricsSnapshot result;
+    for (size_t s = 0; s < kNumShards; s++) {
+      const Shard& shard = shards_[s];
+      merge(shard.histograms[static_cast<size_t>(MetricsOperation::kAdd)],
+            result.add);
+      merge(shard.histograms[static_cast<size_t>(MetricsOperation::kSample)],
+            result.sample);
+      merge(
+          shard.histograms[static_cast<size_t>(MetricsOperation::kUpdatePriorities)],
+          result.update_priorities);
+      merge(shard.histograms[static_cast<size_t>(MetricsOperation::kLockWait)],
+            result.lock_wait);
+      result.evictions += shard.evictions.load(std::memory_order_relaxed);
+      result.samples += shard.samples.load(std::memory_order_relaxed);
+      result.priority_updates +=
+          shard.priority_updates.load(std::memory_order_relaxed);
+      result.stale_priority_updates +=
+          shard.stale_priority_updates.load(std::memory_order_relaxed);
+    }
+    return result;
+  }
+
+ private:
+  struct Histogram {
+    std::array<std::atomic<uint64_t>, LatencyHistogram::kNumBuckets> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+  };
+
+  struct alignas(64) Shard {
+    std::array<Histogram, 4> histograms;
+    std::atomic<uint64_t> evictions{0};
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> priority_updates{0};
+    std::atomic<uint64_t> stale_priority_updates{0};
+  };
+
+  static size_t shard_index() {
+    static std::atomic<size_t> next_shard{0};
+    thread_local const size_t index =
+        next_shard.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+    return index;
+  }
+
+  static void merge(const Histogram& from, LatencyHistogram& into) {
+    for (size_t b = 0; b < LatencyHistogram::kNumBuckets; b++) {
+      into.buckets[b] += from.buckets[b].load(std::memory_order_relaxed);
+    }
+    into.count += from.count.load(std::memory_order_relaxed);
+    into.total_ns += from.total_ns.load(std::memory_order_relaxed);
+    into.max_ns =
+        std::max(into.max_ns, from.max_ns.load(std::memory_order_relaxed));
+  }
+
+  std::unique_ptr<Shard[]> shards_;
+};
+
+/// @brief Stand-in used when metrics are compiled out.
+class NullBufferMetrics {
+ public:
+  static constexpr uint64_t now() { return 0; }
+  void record(MetricsOperation, uint64_t) {}
+  void record_lock_wait(uint64_t) {}
+  void add_evictions(uint64_t) {}
+  void add_samples(uint64_t) {}
+  void add_priority_updates(uint64_t) {}
+  void add_stale_priority_updates(uint64_t) {}
+  MetricsSnapshot snapshot() const { return {}; }
+};
+}  // namespace detail
+
+using BufferMetrics =
+    std::conditional_t<kMetricsEnabled, detail::AtomicBufferMetrics,
+                       detail::NullBufferMetrics>;
+}  // namespace replay_buffer
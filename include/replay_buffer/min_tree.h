@@ -0,0 +1,84 @@
+#pragma once
+
+/// @file min_tree.h
+/// @brief Min-tree companion to SumTree for finding the lowest priority.
+///
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace replay_buffer {
+/// @brief Segment tree holding the minimum of its leaves, with the same
+/// layout as SumTree (root at 0, leaf i at capacity - 1 + i). Leaves that
+/// were never set hold +infinity, so they are never the minimum. Each leaf
+/// also carries a sequence number that breaks ties between equal values,
+/// e.g. the order transitions were written in.
+class MinTree {
+ public:
+  explicit MinTree(size_t capacity) {
+    if (capacity == 0) {
+      throw std::invalid_argument("Capacity must be greater than 0");
+    }
+    capacity_ = capacity;
+    tree_.assign(2 * capacity_ - 1,
+                 Node{std::numeric_limits<float>::infinity(), 0});
+  }
+
+  size_t capacity() const { return capacity_; }
+
+  /// @param sequence Among leaves holding the minimum, the one with the
+  /// smallest sequence wins
+  void set(size_t index, float value, uint64_t sequence = 0) {
+    if (index >= capacity_) {
+      throw std::out_of_range("Index out of range");
+    }
+    size_t tree_index = capacity_ - 1 + index;
+    tree_[tree_index] = Node{value, sequence};
+    // walk back up the parents, each taking the smaller child
+    while (tree_index > 0) {
+      tree_index = (tree_index - 1) / 2;
+      const Node& left = tree_[2 * tree_index + 1];
+      const Node& right = tree_[2 * tree_index + 2];
+      tree_[tree_index] = right < left ? right : left;
+    }
+  }
+
+  float get(size_t index) const {
+    if (index >= capacity_) {
+      throw std::out_of_range("Index out of range");
+    }
+    return tree_[capacity_ - 1 + index].value;
+  }
+
+  float min() const { return tree_[0].value; }
+
+  /// @brief Index of a leaf holding min(), found by following the smaller
+  /// child from the root in O(log n). Ties go to the smallest sequence,
+  /// then to the left.
+  size_t argmin() const {
+    size_t index = 0;
+    while (index < capacity_ - 1) {
+      const size_t left = 2 * index + 1;
+      index = tree_[left + 1] < tree_[left] ? left + 1 : left;
+    }
+    return index - capacity_ + 1;
+  }
+
+ private:
+  struct Node {
+    float value;
+    uint64_t sequence;
+
+    bool operator<(const Node& other) const {
+      return value < other.value ||
+             (value == other.value && sequence < other.sequence);
+    }
+  };
+
+  size_t capacity_;
+  std::vector<Node> tree_;
+};
+}  // namespace replay_buffer
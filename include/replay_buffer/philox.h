@@ -0,0 +1,151 @@
+#pragma once
+
+/// @file philox.h
+/// @brief Philox4x32-10 counter-based random number generator (Salmon et
+/// al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC 2011). Output is a
+/// pure function of a 128-bit counter and a 64-bit key, so any draw can be
+/// computed independently of every other, on any thread, in any order.
+/// The keyed sample() overloads use it to make batches reproducible.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace replay_buffer {
+/// @brief Philox4x32 with 10 rounds. block() is the stateless bijection;
+/// an instance also works as a UniformRandomBitGenerator that walks the
+/// counter, for use with the standard distributions.
+class Philox4x32 {
+ public:
+  using Counter = std::array<uint32_t, 4>;
+  using Key = std::array<uint32_t, 2>;
+  using result_type = uint32_t;
+
+  static constexpr size_t kRounds = 10;
+
+  /// @brief Encrypts counter under key: four independent uniform words.
+  static constexpr Counter block(Counter counter, Key key) {
+    // Scalars rather than array assignments, so the rounds stay in
+    // registers and a loop of independent blocks vectorizes
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2],
+             c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (size_t round = 0; round < kRounds; round++) {
+      const uint64_t product0 = uint64_t{kMultiplier0} * c0;
+      const uint64_t product1 = uint64_t{kMultiplier1} * c2;
+      c0 = static_cast<uint32_t>(product1 >> 32) ^ c1 ^ k0;
+      c1 = static_cast<uint32_t>(product1);
+      c2 = static_cast<uint32_t>(product0 >> 32) ^ c3 ^ k1;
+      c3 = static_cast<uint32_t>(product0);
+      k0 += kWeyl0;
+      k1 += kWeyl1;
+    }
+    return {c0, c1, c2, c3};
+  }
+
+  /// @param seed Key
+  /// @param stream Upper half of the counter; distinct streams of one seed
+  /// never overlap
+  explicit constexpr Philox4x32(uint64_t seed = 0, uint64_t stream = 0)
+      : key_{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+        counter_{0, 0, static_cast<uint32_t>(stream),
+                 static_cast<uint32_t>(stream >> 32)} {}
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  constexpr result_type operator()() {
+    if (used_ == 4) {
+      output_ = block(counter_, key_);
+      used_ = 0;
+      // 64-bit position in the lower half of the counter
+      if (++counter_[0] == 0) {
+        counter_[1]++;
+      }
+    }
+    return output_[used_++];
+  }
+
+ private:
+  static constexpr uint32_t kMultiplier0 = 0xD2511F53;
+  static constexpr uint32_t kMultiplier1 = 0xCD9E8D57;
+  static constexpr uint32_t kWeyl0 = 0x9E3779B9;
+  static constexpr uint32_t kWeyl1 = 0xBB67AE85;
+
+  Key key_;
+  Counter counter_;
+  Counter output_{};
+  size_t used_ = 4;
+};
+
+/// @brief Names one reproducible batch for the keyed sample() overloads.
+/// The same key against the same buffer contents gives a bit-identical
+/// batch, whatever the thread count; different keys give independent ones.
+struct SampleKey {
+  /// Run-wide seed
+  uint64_t seed = 0;
+  /// E.g. the training step the batch is for
+  uint64_t step = 0;
+  /// Separates samplers sharing a seed and step, e.g. a learner rank
+  uint32_t stream = 0;
+};
+
+/// Largest batch a keyed sample() can draw: element pairs are numbered by
+/// one 32-bit counter word.
+inline constexpr uint64_t kMaxKeyedBatchSize = uint64_t{1} << 33;
+
+namespace detail {
+/// @brief The block holding the bits of elements 2 * pair and 2 * pair + 1
+/// of the batch named by key. Every element pair has its own counter, so a
+/// batch can be split across threads at any boundary and still come out
+/// identical.
+constexpr Philox4x32::Counter sample_block(const SampleKey& key,
+                                          uint32_t pair) {
+  return Philox4x32::block(
+      {pair, key.stream, static_cast<uint32_t>(key.step),
+       static_cast<uint32_t>(key.step >> 32)},
+      {static_cast<uint32_t>(key.seed), static_cast<uint32_t>(key.seed >> 32)});
+}
+
+/// @brief 64 uniform bits for one element of the batch named by key.
+constexpr uint64_t sample_bits(const SampleKey& key, uint64_t element) {
+  const Philox4x32::Counter words =
+      sample_block(key, static_cast<uint32_t>(element / 2));
+  const size_t half = 2 * (element % 2);
+  return uint64_t{words[half]} | uint64_t{words[half + 1]} << 32;
+}
+
+/// @brief Calls fn(element, bits) for each element in [first, last), with
+/// the bits sample_bits() gives, computing each block once.
+template <typename F>
+constexpr void for_each_sample_bits(const SampleKey& key, uint64_t first,
+                                    uint64_t last, F&& fn) {
+  uint64_t element = first;
+  while (element < last) {
+    const Philox4x32::Counter words =
+        sample_block(key, static_cast<uint32_t>(element / 2));
+    for (size_t half = 2 * (element % 2); half < 4 && element < last;
+         half += 2, element++) {
+      fn(element, uint64_t{words[half]} | uint64_t{words[half + 1]} << 32);
+    }
+  }
+}
+
+/// @brief Uniform double in [0, 1) from the top 53 bits.
+constexpr double unit_interval(uint64_t bits) {
+  return static_cast<double>(bits >> 11) * 0x1.0p-53;
+}
+
+/// @brief Uniform index in [0, n) from 64 random bits, by scaling rather
+/// than with std::uniform_int_distribution, whose output differs between
+/// standard libraries.
+constexpr size_t scale_to_index(uint64_t bits, size_t n) {
+  const size_t index =
+      static_cast<size_t>(unit_interval(bits) * static_cast<double>(n));
+  return index < n ? index : n - 1;
+}
+}  // namespace detail
+}  // namespace replay_buffer
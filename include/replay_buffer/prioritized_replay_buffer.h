@@ -1,18 +1,64 @@
+#pragma once
+
+/// @file prioritized_replay_buffer.h
+/// @brief Proportional prioritized replay buffer (Schaul et al., 2015).
+/// Combines a CircularBuffer for storage with a SumTree over priorities.
+
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <functional>
+#include <mutex>
 #include <random>
 #include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "replay_buffer/circular_buffer.h"
+#include "replay_buffer/metrics.h"
+#include "replay_buffer/min_tree.h"
+#include "replay_buffer/philox.h"
 #include "replay_buffer/sum_tree.h"
+#include "replay_buffer/thread_pool.h"
+#include "replay_buffer/trace.h"
 
 namespace replay_buffer {
 
+/// @brief Identifies a sampled slot together with the generation of the
+/// transition it held, so updates for overwritten slots can be detected.
+struct SampleHandle {
+  size_t index;
+  uint64_t generation;
+};
+
 template <typename T>
 struct PrioritizedSample {
   T transition;
   float weight;
   size_t index;
+  /// Incremented every time the slot is written
+  uint64_t generation = 0;
+  /// Leaf priority the sample was drawn with (after alpha), so callers
+  /// combining several buffers can recompute the sampling probability
+  float priority = 0.0f;
+
+  SampleHandle handle() const { return {index, generation}; }
+};
+
+/// @brief Which transition a full buffer overwrites on add.
+enum class EvictionPolicy {
+  /// The oldest transition (ring buffer order).
+  kFifo,
+  /// The transition with the lowest priority, found with a MinTree; the
+  /// oldest of those when several share it.
+  kLowestPriority,
+  /// A transition sampled with probability proportional to 1 / priority,
+  /// from a second SumTree over inverse priorities.
+  kInversePriority,
 };
 
 struct PrioritizedReplayBufferConfig {
@@ -20,19 +66,45 @@ struct PrioritizedReplayBufferConfig {
   float alpha = 0.6f;
   float beta = 0.4f;
   float epsilon = 1e-6f;
+  EvictionPolicy eviction_policy = EvictionPolicy::kFifo;
+  /// kReservoir keeps a uniform sample of every transition ever added;
+  /// rejected transitions never enter the tree. Requires kFifo eviction.
+  RetentionPolicy retention_policy = RetentionPolicy::kFifo;
 };
 
 template <typename T>
 class PrioritizedReplayBuffer {
  public:
+  using value_type = T;
+
+  /// Smallest batch that sample(batch_size, pool) splits across threads
+  static constexpr size_t kParallelSampleThreshold = 4096;
+  /// Smallest share of a parallel batch given to one task
+  static constexpr size_t kMinSamplesPerTask = 1024;
+
   PrioritizedReplayBuffer(const PrioritizedReplayBufferConfig& config)
-      : buffer_(config.capacity),
+      : buffer_(config.capacity, config.retention_policy),
         tree_(config.capacity),
+        min_tree_(config.eviction_policy == EvictionPolicy::kLowestPriority
+                      ? config.capacity
+                      : 1),
+        inverse_tree_(
+            config.eviction_policy == EvictionPolicy::kInversePriority
+                ? config.capacity
+                : 1),
+        eviction_policy_(config.eviction_policy),
+        retention_policy_(config.retention_policy),
         capacity_(config.capacity),
         alpha_(config.alpha),
         beta_(config.beta),
         epsilon_(config.epsilon),
-        max_priority_(1.0f),
+        max_raw_priority_(1.0f),
+        raw_priorities_(config.capacity, kUnwrittenPriority),
+        generations_(config.capacity, 0),
+        write_sequences_(
+            config.eviction_policy == EvictionPolicy::kLowestPriority
+                ? config.capacity
+                : 0),
         gen_(std::random_device{}()) {
     if (config.capacity == 0) {
       throw std::invalid_argument("Capacity must be greater than 0");
@@ -46,8 +118,18 @@ class PrioritizedReplayBuffer {
     if (config.epsilon < 0.0f) {
       throw std::invalid_argument("Epsilon must be non-negative");
     }
+    if (config.retention_policy == RetentionPolicy::kReservoir &&
+        config.eviction_policy != EvictionPolicy::kFifo) {
+      throw std::invalid_argument(
+          "Reservoir retention requires FIFO eviction policy");
+    }
   }
 
+  PrioritizedReplayBuffer(const PrioritizedReplayBuffer&) = delete;
+  PrioritizedReplayBuffer& operator=(const PrioritizedReplayBuffer&) = delete;
+
+  ~PrioritizedReplayBuffer() { wait_for_alpha_update(); }
+
   size_t capacity() const {
     std::shared_lock<std::shared_mutex> lock(mutex_);
     return capacity_;
@@ -58,14 +140,67 @@ class PrioritizedReplayBuffer {
     return buffer_.size();
   }
 
+  /// @brief The alpha the tree currently reflects. After set_alpha() this
+  /// stays at the old value until the background rebuild is installed.
   float alpha() const {
     std::shared_lock<std::shared_mutex> lock(mutex_);
     return alpha_;
   }
 
-  float beta() const {
+  float beta() const { return beta_.load(std::memory_order_relaxed); }
+
+  /// @brief Sets the importance sampling exponent, e.g. to anneal it towards
+  /// 1 over training. Lock-free; batches already being sampled may use
+  /// either value.
+  void set_beta(float beta) {
+    if (beta < 0.0f || beta > 1.0f) {
+      throw std::invalid_argument("Beta must be between 0 and 1");
+    }
+    beta_.store(beta, std::memory_order_relaxed);
+  }
+
+  /// @brief Changes the priority exponent. Raw priorities (|td| + epsilon)
+  /// are kept per slot, so the tree is rebuilt from them on a background
+  /// thread, with the exponentiation split across cores, while add, sample
+  /// and update keep using the old tree. Slots written in the meantime are
+  /// recorded and replayed with the new alpha when the new tree is swapped
+  /// in under the exclusive lock. Waits for any earlier rebuild first.
+  void set_alpha(float alpha) {
+    if (alpha < 0.0f || alpha > 1.0f) {
+      throw std::invalid_argument("Alpha must be between 0 and 1");
+    }
+    std::lock_guard<std::mutex> update_lock(alpha_update_mutex_);
+    if (alpha_rebuild_.joinable()) {
+      alpha_rebuild_.join();
+    }
+    std::vector<float> raw_priorities;
+    std::vector<uint64_t> write_sequences;
+    {
+      std::lock_guard<std::shared_mutex> lock(mutex_);
+      raw_priorities = raw_priorities_;
+      write_sequences = write_sequences_;
+      dirty_slots_.clear();
+      alpha_rebuild_pending_ = true;
+    }
+    alpha_rebuild_ = std::thread(
+        [this, alpha, raw_priorities = std::move(raw_priorities),
+         write_sequences = std::move(write_sequences)]() {
+          rebuild_for_alpha(alpha, raw_priorities, write_sequences);
+        });
+  }
+
+  bool alpha_update_pending() const {
     std::shared_lock<std::shared_mutex> lock(mutex_);
-    return beta_;
+    return alpha_rebuild_pending_;
+  }
+
+  /// @brief Blocks until the tree reflects the alpha last passed to
+  /// set_alpha().
+  void wait_for_alpha_update() {
+    std::lock_guard<std::mutex> update_lock(alpha_update_mutex_);
+    if (alpha_rebuild_.joinable()) {
+      alpha_rebuild_.join();
+    }
   }
 
   float epsilon() const {
@@ -73,50 +208,555 @@ class PrioritizedReplayBuffer {
     return epsilon_;
   }
 
+  /// @brief Sum of all leaf priorities, the normalizer of the sampling
+  /// distribution.
+  float total_priority() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return tree_.total();
+  }
+
   void add(const T& item) {
+    const uint64_t start = metrics_.now();
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    metrics_.record_lock_wait(start);
+    add_locked(item);
+    metrics_.record(MetricsOperation::kAdd, start);
+  }
+
+  /// @brief Adds items at the maximum priority, like add() on each, under a
+  /// single lock.
+  void add_batch(std::span<const T> items) {
+    const uint64_t start = metrics_.now();
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    metrics_.record_lock_wait(start);
+    for (const T& item : items) {
+      add_locked(item);
+    }
+    metrics_.record(MetricsOperation::kAdd, start);
+  }
+
+  /// @brief Adds items with caller-computed initial priorities under a
+  /// single lock, e.g. TD errors computed by an actor. The tree is updated
+  /// with one coalesced pass per contiguous run of slots instead of a root
+  /// walk per item.
+  /// With a priority-based eviction policy, items that do not fit in free
+  /// slots replace victims one at a time, after the free slots are filled.
+  /// @param td_errors One per item, converted to priorities like
+  /// update_priorities() does
+  /// With reservoir retention, items that do not fit in free slots are
+  /// offered to the reservoir one at a time after the bulk copy.
+  /// @return Slots the stored items were written to. With a priority-based
+  /// eviction policy or reservoir retention only items stored in free slots
+  /// are included.
+  IndexRange add_batch(std::span<const T> items,
+                       std::span<const float> td_errors) {
+    if (items.size() != td_errors.size()) {
+      throw std::invalid_argument("Items and TD errors must have equal size");
+    }
+    const uint64_t start = metrics_.now();
     std::lock_guard<std::shared_mutex> lock(mutex_);
-    size_t stored_index = buffer_.add(item);
-    tree_.set(stored_index, max_priority_);
+    metrics_.record_lock_wait(start);
+    // With a priority-based eviction policy, free slots are filled in bulk
+    // first; only the rest of the batch evicts, once the companion trees
+    // cover every live slot
+    std::span<const T> evicting;
+    std::span<const float> evicting_td_errors;
+    if (eviction_policy_ != EvictionPolicy::kFifo) {
+      const size_t to_free =
+          std::min(capacity_ - buffer_.size(), items.size());
+      evicting = items.subspan(to_free);
+      evicting_td_errors = td_errors.subspan(to_free);
+      items = items.first(to_free);
+      td_errors = td_errors.first(to_free);
+    }
+    std::span<const T> offered;
+    std::span<const float> offered_td_errors;
+    if (retention_policy_ == RetentionPolicy::kReservoir) {
+      const size_t to_free =
+          std::min(capacity_ - buffer_.size(), items.size());
+      offered = items.subspan(to_free);
+      offered_td_errors = td_errors.subspan(to_free);
+      items = items.first(to_free);
+      td_errors = td_errors.first(to_free);
+    }
+    const IndexRange range = buffer_.add_batch(items);
+    // Only the last range.count items were stored
+    td_errors = td_errors.subspan(td_errors.size() - range.count);
+    batch_priorities_.resize(range.count);
+    for (size_t i = 0; i < range.count; i++) {
+      const size_t slot = (range.first + i) % capacity_;
+      const float raw_priority = std::abs(td_errors[i]) + epsilon_;
+      raw_priorities_[slot] = raw_priority;
+      max_raw_priority_ = std::max(max_raw_priority_, raw_priority);
+      batch_priorities_[i] = std::pow(raw_priority, alpha_);
+      begin_write(slot);
+      if (alpha_rebuild_pending_) {
+        dirty_slots_.push_back(slot);
+      }
+    }
+    const std::span<const float> priorities(batch_priorities_);
+    const size_t before_seam = std::min(range.count, capacity_ - range.first);
+    tree_.set_range(range.first, priorities.first(before_seam));
+    tree_.set_range(0, priorities.subspan(before_seam));
+    if (eviction_policy_ != EvictionPolicy::kFifo) {
+      for (size_t i = 0; i < range.count; i++) {
+        set_companion_priority((range.first + i) % capacity_, priorities[i]);
+      }
+    }
+    for (size_t i = 0; i < evicting.size(); i++) {
+      const size_t victim = choose_victim();
+      buffer_.replace(victim, evicting[i]);
+      begin_write(victim);
+      set_raw_priority(victim, std::abs(evicting_td_errors[i]) + epsilon_);
+    }
+    metrics_.add_evictions(evicting.size());
+    for (size_t i = 0; i < offered.size(); i++) {
+      const size_t slot = buffer_.add(offered[i]);
+      if (slot == CircularBuffer<T>::npos) {
+        continue;
+      }
+      begin_write(slot);
+      set_raw_priority(slot, std::abs(offered_td_errors[i]) + epsilon_);
+    }
+    metrics_.record(MetricsOperation::kAdd, start);
+    return range;
   }
 
+  /// @throws std::invalid_argument if the total priority is 0
   std::vector<replay_buffer::PrioritizedSample<T>> sample(
       size_t batch_size) const {
+    TraceSpan span("PrioritizedReplayBuffer::sample");
+    const uint64_t start = metrics_.now();
+    TraceSpan lock_span("PrioritizedReplayBuffer::lock_wait");
     std::lock_guard<std::shared_mutex> lock(mutex_);
+    lock_span.end();
+    metrics_.record_lock_wait(start);
+    const float total = tree_.total();
+    if (!(total > 0.0f)) {
+      throw std::invalid_argument("Cannot sample with zero total priority");
+    }
+    const float beta = beta_.load(std::memory_order_relaxed);
     std::vector<replay_buffer::PrioritizedSample<T>> samples;
-    std::uniform_real_distribution<float> dist(0.0f, tree_.total());
+    std::uniform_real_distribution<float> dist(0.0f, total);
+    // The float distribution can return total itself, which would walk off
+    // the right edge onto an unwritten zero-priority leaf
+    const float max_value = std::nextafter(total, 0.0f);
     for (size_t i = 0; i < batch_size; i++) {
-      float random_value = dist(gen_);
+      float random_value = std::min(dist(gen_), max_value);
       size_t index = tree_.sample(random_value);
+      const float priority = tree_.get(index);
+      float importance_sampling_weight =
+          std::pow(buffer_.size() * (priority / total), -beta);
+      // The tree is indexed by physical slot, not by logical position
+      samples.push_back(replay_buffer::PrioritizedSample<T>{
+          buffer_.at_slot(index), importance_sampling_weight, index,
+          generations_[index], priority});
+    }
+
+    metrics_.add_samples(batch_size);
+    metrics_.record(MetricsOperation::kSample, start);
+    return samples;
+  }
+
+  /// @brief Same as sample(), with large batches split across pool: each
+  /// task draws from its own RNG stream, seeded from this buffer's
+  /// generator, and does its own tree descents, gathers and importance
+  /// weights into its part of the result. Batches below
+  /// kParallelSampleThreshold take the single-threaded path.
+  /// @throws std::invalid_argument if the total priority is 0
+  std::vector<replay_buffer::PrioritizedSample<T>> sample(
+      size_t batch_size, ThreadPool& pool) const {
+    if (batch_size < kParallelSampleThreshold || pool.size() == 0) {
+      return sample(batch_size);
+    }
+    TraceSpan span("PrioritizedReplayBuffer::sample");
+    const uint64_t start = metrics_.now();
+    TraceSpan lock_span("PrioritizedReplayBuffer::lock_wait");
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    lock_span.end();
+    metrics_.record_lock_wait(start);
+    const float total = tree_.total();
+    if (!(total > 0.0f)) {
+      throw std::invalid_argument("Cannot sample with zero total priority");
+    }
+    const float beta = beta_.load(std::memory_order_relaxed);
+    const float size = static_cast<float>(buffer_.size());
+    const float max_value = std::nextafter(total, 0.0f);
+    std::vector<replay_buffer::PrioritizedSample<T>> samples(batch_size);
+    const size_t tasks = pool.task_count(batch_size, kMinSamplesPerTask);
+    std::vector<std::mt19937::result_type> seeds(tasks);
+    std::generate(seeds.begin(), seeds.end(), std::ref(gen_));
+    pool.parallel_for(tasks, [&](size_t task) {
+      std::mt19937 rng(seeds[task]);
+      std::uniform_real_distribution<float> dist(0.0f, total);
+      const size_t first = task * batch_size / tasks;
+      const size_t last = (task + 1) * batch_size / tasks;
+      std::vector<size_t> slots(last - first);
+      for (size_t i = first; i < last; i++) {
+        const size_t index = tree_.sample(std::min(dist(rng), max_value));
+        const float priority = tree_.get(index);
+        slots[i - first] = index;
+        samples[i].weight = std::pow(size * (priority / total), -beta);
+        samples[i].index = index;
+        samples[i].generation = generations_[index];
+        samples[i].priority = priority;
+      }
+      buffer_.visit_slots(slots, [&](size_t i, const T& transition) {
+        samples[first + i].transition = transition;
+      });
+    });
+
+    metrics_.add_samples(batch_size);
+    metrics_.record(MetricsOperation::kSample, start);
+    return samples;
+  }
+
+  /// @brief Reproducible sample(): element i of the batch is drawn from
+  /// Philox4x32 keyed by (key, i) instead of the shared generator, so the
+  /// same key over the same priorities always gives the same batch.
+  /// Concurrent keyed samplers share the lock and do not interleave.
+  /// @throws std::invalid_argument if batch_size is 0 or exceeds
+  /// kMaxKeyedBatchSize, or the buffer is empty
+  std::vector<replay_buffer::PrioritizedSample<T>> sample(
+      size_t batch_size, const SampleKey& key) const {
+    return sample_keyed(batch_size, key, nullptr);
+  }
+
+  /// @brief Keyed sample() with large batches split across pool. The batch
+  /// is identical to the single-threaded one for any pool size.
+  std::vector<replay_buffer::PrioritizedSample<T>> sample(
+      size_t batch_size, const SampleKey& key, ThreadPool& pool) const {
+    return sample_keyed(batch_size, key, &pool);
+  }
+
+  /// @brief Samples batch_size distinct slots proportionally to priority.
+  /// Each drawn leaf is masked to zero in the tree for the rest of the
+  /// batch and restored afterwards, so the cost stays O(batch_size log n).
+  /// Importance sampling weights use the unmasked priorities and total.
+  /// @throws std::invalid_argument if fewer than batch_size items have a
+  /// non-zero priority
+  std::vector<replay_buffer::PrioritizedSample<T>> sample_without_replacement(
+      size_t batch_size) const {
+    const uint64_t start = metrics_.now();
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    metrics_.record_lock_wait(start);
+    if (batch_size <= 0) {
+      throw std::invalid_argument("Batch size must be > 0");
+    }
+    if (batch_size > buffer_.size()) {
+      throw std::invalid_argument("Batch size exceeds buffer size");
+    }
+
+    const float total = tree_.total();
+    const float beta = beta_.load(std::memory_order_relaxed);
+    std::vector<replay_buffer::PrioritizedSample<T>> samples;
+    samples.reserve(batch_size);
+    std::vector<float> masked_priorities;
+    masked_priorities.reserve(batch_size);
+    while (samples.size() < batch_size && tree_.total() > 0.0f) {
+      std::uniform_real_distribution<float> dist(0.0f, tree_.total());
+      const size_t index = tree_.sample(dist(gen_));
+      const float priority = tree_.get(index);
+      // Rounding can land on a masked (zero) leaf at the end of the range
+      if (priority <= 0.0f) {
+        continue;
+      }
       float importance_sampling_weight =
-          std::pow(buffer_.size() * (tree_.get(index) / tree_.total()), -beta_);
+          std::pow(buffer_.size() * (priority / total), -beta);
       samples.push_back(replay_buffer::PrioritizedSample<T>{
-          buffer_[index], importance_sampling_weight, index});
+          buffer_.at_slot(index), importance_sampling_weight, index,
+          generations_[index], priority});
+      masked_priorities.push_back(priority);
+      tree_.set(index, 0.0f);
+    }
+    for (size_t i = 0; i < samples.size(); i++) {
+      tree_.set(samples[i].index, masked_priorities[i]);
+    }
+    if (samples.size() < batch_size) {
+      throw std::invalid_argument(
+          "Batch size exceeds number of items with non-zero priority");
     }
 
+    metrics_.add_samples(batch_size);
+    metrics_.record(MetricsOperation::kSample, start);
     return samples;
   }
 
   void update_priorities(const std::vector<size_t>& indices,
                          const std::vector<float>& td_errors) {
+    TraceSpan span("PrioritizedReplayBuffer::update_priorities");
+    const uint64_t start = metrics_.now();
+    TraceSpan lock_span("PrioritizedReplayBuffer::lock_wait");
     std::lock_guard<std::shared_mutex> lock(mutex_);
+    lock_span.end();
+    metrics_.record_lock_wait(start);
     for (size_t i = 0; i < indices.size(); i++) {
-      float priority = std::pow(std::abs(td_errors[i]) + epsilon_, alpha_);
-      tree_.set(indices[i], priority);
-      if (max_priority_ < priority) {
-        max_priority_ = priority;
+      if (indices[i] >= capacity_) {
+        throw std::out_of_range("Index out of range");
+      }
+      set_raw_priority(indices[i], std::abs(td_errors[i]) + epsilon_);
+    }
+    metrics_.add_priority_updates(indices.size());
+    metrics_.record(MetricsOperation::kUpdatePriorities, start);
+  }
+
+  /// @brief Updates priorities for sampled handles, dropping in O(1) any
+  /// whose slot has been overwritten since it was sampled (the TD error
+  /// belongs to the evicted transition, not the new one).
+  /// @return Number of updates applied
+  size_t update_priorities(const std::vector<SampleHandle>& handles,
+                           const std::vector<float>& td_errors) {
+    TraceSpan span("PrioritizedReplayBuffer::update_priorities");
+    const uint64_t start = metrics_.now();
+    TraceSpan lock_span("PrioritizedReplayBuffer::lock_wait");
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    lock_span.end();
+    metrics_.record_lock_wait(start);
+    size_t applied = 0;
+    for (size_t i = 0; i < handles.size(); i++) {
+      if (handles[i].index >= capacity_) {
+        throw std::out_of_range("Index out of range");
       }
+      if (generations_[handles[i].index] != handles[i].generation) {
+        continue;
+      }
+      set_raw_priority(handles[i].index, std::abs(td_errors[i]) + epsilon_);
+      applied++;
     }
+    metrics_.add_priority_updates(applied);
+    metrics_.add_stale_priority_updates(handles.size() - applied);
+    metrics_.record(MetricsOperation::kUpdatePriorities, start);
+    return applied;
+  }
+
+  /// @brief Aggregates latency histograms and counters without blocking
+  /// writers. Evictions include those of the underlying storage. Empty unless
+  /// REPLAY_BUFFER_ENABLE_METRICS is defined.
+  MetricsSnapshot metrics_snapshot() const {
+    MetricsSnapshot snapshot = metrics_.snapshot();
+    snapshot.evictions += buffer_.metrics_snapshot().evictions;
+    return snapshot;
   }
 
  private:
+  std::vector<replay_buffer::PrioritizedSample<T>> sample_keyed(
+      size_t batch_size, const SampleKey& key, ThreadPool* pool) const {
+    TraceSpan span("PrioritizedReplayBuffer::sample");
+    const uint64_t start = metrics_.now();
+    TraceSpan lock_span("PrioritizedReplayBuffer::lock_wait");
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    lock_span.end();
+    metrics_.record_lock_wait(start);
+    if (batch_size <= 0) {
+      throw std::invalid_argument("Batch size must be > 0");
+    }
+    if (batch_size > kMaxKeyedBatchSize) {
+      throw std::invalid_argument("Keyed batch size too large");
+    }
+    const float total = tree_.total();
+    if (!(total > 0.0f)) {
+      throw std::invalid_argument("Buffer is empty");
+    }
+    const float beta = beta_.load(std::memory_order_relaxed);
+    const float size = static_cast<float>(buffer_.size());
+    // Largest value sample() accepts that cannot walk past the last leaf
+    const float max_value = std::nextafter(total, 0.0f);
+    std::vector<replay_buffer::PrioritizedSample<T>> samples(batch_size);
+    const auto draw = [&](size_t first, size_t last) {
+      std::vector<size_t> slots(last - first);
+      detail::for_each_sample_bits(key, first, last,
+                                   [&](size_t i, uint64_t bits) {
+        const float value = std::min(
+            static_cast<float>(detail::unit_interval(bits) * total),
+            max_value);
+        const size_t index = tree_.sample(value);
+        const float priority = tree_.get(index);
+        slots[i - first] = index;
+        samples[i].weight = std::pow(size * (priority / total), -beta);
+        samples[i].index = index;
+        samples[i].generation = generations_[index];
+        samples[i].priority = priority;
+      });
+      buffer_.visit_slots(slots, [&](size_t i, const T& transition) {
+        samples[first + i].transition = transition;
+      });
+    };
+    if (pool == nullptr || batch_size < kParallelSampleThreshold ||
+        pool->size() == 0) {
+      draw(0, batch_size);
+    } else {
+      const size_t tasks = pool->task_count(batch_size, kMinSamplesPerTask);
+      pool->parallel_for(tasks, [&](size_t task) {
+        draw(task * batch_size / tasks, (task + 1) * batch_size / tasks);
+      });
+    }
+
+    metrics_.add_samples(batch_size);
+    metrics_.record(MetricsOperation::kSample, start);
+    return samples;
+  }
+
+  // Priorities below this are clamped before inverting for eviction
+  static constexpr float kMinEvictionPriority = 1e-6f;
+  // Raw priority of a slot that has never been written; its leaf stays 0
+  // whatever alpha is
+  static constexpr float kUnwrittenPriority = -1.0f;
+  // Below this many leaves per thread, starting a thread costs more than
+  // the pow() calls it takes over
+  static constexpr size_t kMinLeavesPerRebuildThread = 1 << 14;
+
+  /// @brief Stores a raw priority (|td| + epsilon) and sets the leaf to it
+  /// raised to the current alpha.
+  void set_raw_priority(size_t slot, float raw_priority) {
+    raw_priorities_[slot] = raw_priority;
+    max_raw_priority_ = std::max(max_raw_priority_, raw_priority);
+    const float priority = std::pow(raw_priority, alpha_);
+    tree_.set(slot, priority);
+    set_companion_priority(slot, priority);
+    if (alpha_rebuild_pending_) {
+      dirty_slots_.push_back(slot);
+    }
+  }
+
+  void set_companion_priority(size_t slot, float priority) {
+    set_companion_priority(min_tree_, inverse_tree_, write_sequences_, slot,
+                           priority);
+  }
+
+  void set_companion_priority(MinTree& min_tree, SumTree& inverse_tree,
+                              const std::vector<uint64_t>& write_sequences,
+                              size_t slot, float priority) const {
+    if (eviction_policy_ == EvictionPolicy::kLowestPriority) {
+      min_tree.set(slot, priority, write_sequences[slot]);
+    } else if (eviction_policy_ == EvictionPolicy::kInversePriority) {
+      inverse_tree.set(slot, 1.0f / std::max(priority, kMinEvictionPriority));
+    }
+  }
+
+  /// @brief Body of the set_alpha() background thread. Builds fresh trees
+  /// from a snapshot of the raw priorities without holding the lock, then
+  /// swaps them in and replays the slots written since the snapshot.
+  void rebuild_for_alpha(float alpha, const std::vector<float>& raw,
+                         const std::vector<uint64_t>& write_sequences) {
+    std::vector<float> leaves(capacity_);
+    const size_t threads = std::clamp<size_t>(
+        capacity_ / kMinLeavesPerRebuildThread, 1,
+        std::max(1u, std::thread::hardware_concurrency()));
+    const size_t chunk = (capacity_ + threads - 1) / threads;
+    {
+      std::vector<std::jthread> workers;
+      for (size_t first = 0; first < capacity_; first += chunk) {
+        workers.emplace_back([&, first]() {
+          const size_t last = std::min(capacity_, first + chunk);
+          for (size_t i = first; i < last; i++) {
+            leaves[i] = raw[i] == kUnwrittenPriority ? 0.0f
+                                                     : std::pow(raw[i], alpha);
+          }
+        });
+      }
+    }
+    SumTree tree(capacity_);
+    tree.build(leaves);
+    MinTree min_tree(min_tree_.capacity());
+    SumTree inverse_tree(inverse_tree_.capacity());
+    if (eviction_policy_ != EvictionPolicy::kFifo) {
+      for (size_t i = 0; i < capacity_; i++) {
+        if (raw[i] != kUnwrittenPriority) {
+          set_companion_priority(min_tree, inverse_tree, write_sequences, i,
+                                 leaves[i]);
+        }
+      }
+    }
+
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    for (size_t slot : dirty_slots_) {
+      const float priority = std::pow(raw_priorities_[slot], alpha);
+      tree.set(slot, priority);
+      set_companion_priority(min_tree, inverse_tree, write_sequences_, slot,
+                             priority);
+    }
+    tree_ = std::move(tree);
+    min_tree_ = std::move(min_tree);
+    inverse_tree_ = std::move(inverse_tree);
+    alpha_ = alpha;
+    dirty_slots_.clear();
+    alpha_rebuild_pending_ = false;
+  }
+
+  /// @brief Stores item at the maximum priority. Caller holds the lock.
+  void add_locked(const T& item) {
+    size_t stored_index;
+    if (eviction_policy_ != EvictionPolicy::kFifo &&
+        buffer_.size() == capacity_) {
+      stored_index = choose_victim();
+      buffer_.replace(stored_index, item);
+      metrics_.add_evictions(1);
+    } else {
+      stored_index = buffer_.add(item);
+      if (stored_index == CircularBuffer<T>::npos) {
+        // Rejected by reservoir retention
+        return;
+      }
+    }
+    begin_write(stored_index);
+    set_raw_priority(stored_index, max_raw_priority_);
+  }
+
+  /// @brief Records that slot now holds a new transition: bumps its
+  /// generation and, for kLowestPriority, gives it the next write sequence
+  /// so that among equal priorities the oldest transition is evicted first.
+  /// Called before the slot's priority is set.
+  void begin_write(size_t slot) {
+    generations_[slot]++;
+    if (eviction_policy_ == EvictionPolicy::kLowestPriority) {
+      write_sequences_[slot] = next_write_sequence_++;
+    }
+  }
+
+  /// @brief Picks the slot a full buffer overwrites, in O(log n).
+  size_t choose_victim() {
+    if (eviction_policy_ == EvictionPolicy::kLowestPriority) {
+      return min_tree_.argmin();
+    }
+    std::uniform_real_distribution<float> dist(0.0f, inverse_tree_.total());
+    return inverse_tree_.sample(dist(gen_));
+  }
+
   replay_buffer::CircularBuffer<T> buffer_;
-  replay_buffer::SumTree tree_;
+  // Mutable because sample_without_replacement() masks leaves for the
+  // duration of a batch (under the exclusive lock)
+  mutable replay_buffer::SumTree tree_;
+  // Companions for priority-based eviction; single-leaf placeholders when
+  // the policy does not use them
+  replay_buffer::MinTree min_tree_;
+  replay_buffer::SumTree inverse_tree_;
+  EvictionPolicy eviction_policy_;
+  RetentionPolicy retention_policy_;
   mutable std::shared_mutex mutex_;
   size_t capacity_;
   float alpha_;
-  float beta_;
+  // Read on every sample; atomic so set_beta() needs no lock
+  std::atomic<float> beta_;
   float epsilon_;
-  float max_priority_;
+  // Largest |td| + epsilon seen; new transitions get it raised to alpha
+  float max_raw_priority_;
+  // Per-slot |td| + epsilon before exponentiation, so alpha can change
+  std::vector<float> raw_priorities_;
+  // set_alpha() state. While a rebuild is pending, slots whose priority
+  // changes are appended to dirty_slots_ and replayed when it is installed.
+  std::thread alpha_rebuild_;
+  std::mutex alpha_update_mutex_;
+  bool alpha_rebuild_pending_ = false;
+  std::vector<size_t> dirty_slots_;
+  // Per-slot write counts, matched against SampleHandle::generation
+  std::vector<uint64_t> generations_;
+  // kLowestPriority only: when each slot was last written, breaking
+  // MinTree ties in favor of evicting the oldest transition
+  std::vector<uint64_t> write_sequences_;
+  uint64_t next_write_sequence_ = 0;
+  // Scratch space for add_batch(), reused to avoid allocating per batch
+  std::vector<float> batch_priorities_;
   mutable std::mt19937 gen_;
+  [[no_unique_address]] mutable BufferMetrics metrics_;
 };
 }  // namespace replay_buffer
@@ -0,0 +1,213 @@
+#pragma once
+
+/// @file quantize.h
+/// @brief Per-feature affine quantization kernels for observation storage.
+/// Values are encoded as code = (x - offset) / scale and decoded as
+/// x = code * scale + offset, with codes stored either as uint8 (rounded and
+/// clamped to [0, 255]) or as IEEE half precision floats.
+/// Dequantization is vectorized with AVX2, SSE2 or NEON when the compiler
+/// targets them, and falls back to the scalar kernels otherwise.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace replay_buffer {
+/// @brief IEEE 754 binary16 value stored as raw bits.
+struct Float16 {
+  uint16_t bits;
+};
+
+/// @brief Converts a float to half precision, rounding to nearest even.
+inline Float16 float_to_half(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+  bits &= 0x7fffffffu;
+
+  // Infinity and NaN (keep NaNs quiet)
+  if (bits >= 0x7f800000u) {
+    return {static_cast<uint16_t>(sign | 0x7c00u |
+                                  (bits > 0x7f800000u ? 0x200u : 0u))};
+  }
+  // Anything that rounds past 65504 overflows to infinity
+  if (bits >= 0x477ff000u) {
+    return {static_cast<uint16_t>(sign | 0x7c00u)};
+  }
+  // Below the smallest normal half (2^-14): subnormal or zero
+  if (bits < 0x38800000u) {
+    if (bits < 0x33000000u) {
+      return {sign};
+    }
+    const uint32_t exponent = bits >> 23;
+    const uint32_t mantissa = (bits & 0x7fffffu) | 0x800000u;
+    const uint32_t shift = 126 - exponent;
+    uint32_t half = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1u))) {
+      half++;
+    }
+    return {static_cast<uint16_t>(sign | half)};
+  }
+  // Normal: rebias the exponent from 127 to 15 and round the mantissa
+  uint32_t half = (bits >> 13) - (112u << 10);
+  const uint32_t remainder = bits & 0x1fffu;
+  if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+    half++;
+  }
+  return {static_cast<uint16_t>(sign | half)};
+}
+
+/// @brief Converts a half precision value to float (exact).
+inline float half_to_float(Float16 value) {
+  const uint32_t sign = static_cast<uint32_t>(value.bits & 0x8000u) << 16;
+  const uint32_t exponent = (value.bits >> 10) & 0x1fu;
+  uint32_t mantissa = value.bits & 0x3ffu;
+  uint32_t bits;
+  if (exponent == 0x1f) {
+    bits = sign | 0x7f800000u | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  } else if (mantissa == 0) {
+    bits = sign;
+  } else {
+    // Subnormal: shift until the implicit bit appears
+    uint32_t normalized_exponent = 113;
+    while ((mantissa & 0x400u) == 0) {
+      mantissa <<= 1;
+      normalized_exponent--;
+    }
+    bits = sign | (normalized_exponent << 23) | ((mantissa & 0x3ffu) << 13);
+  }
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+/// @brief Encodes values as uint8 codes, rounding and clamping to [0, 255].
+/// @param values Input values, one per feature
+/// @param inverse_scale Per-feature 1 / scale
+/// @param offset Per-feature offset
+/// @param codes Output codes, same length as values
+inline void quantize(std::span<const float> values,
+                     std::span<const float> inverse_scale,
+                     std::span<const float> offset, std::span<uint8_t> codes) {
+  for (size_t i = 0; i < values.size(); i++) {
+    const float code =
+        std::nearbyint((values[i] - offset[i]) * inverse_scale[i]);
+    codes[i] = static_cast<uint8_t>(std::clamp(code, 0.0f, 255.0f));
+  }
+}
+
+/// @brief Encodes values as half precision codes.
+inline void quantize(std::span<const float> values,
+                     std::span<const float> inverse_scale,
+                     std::span<const float> offset, std::span<Float16> codes) {
+  for (size_t i = 0; i < values.size(); i++) {
+    codes[i] = float_to_half((values[i] - offset[i]) * inverse_scale[i]);
+  }
+}
+
+/// @brief Reference scalar decoder for uint8 codes.
+inline void dequantize_scalar(std::span<const uint8_t> codes,
+                              std::span<const float> scale,
+                              std::span<const float> offset,
+                              std::span<float> values) {
+  for (size_t i = 0; i < codes.size(); i++) {
+    values[i] = static_cast<float>(codes[i]) * scale[i] + offset[i];
+  }
+}
+
+/// @brief Reference scalar decoder for half precision codes.
+inline void dequantize_scalar(std::span<const Float16> codes,
+                              std::span<const float> scale,
+                              std::span<const float> offset,
+                              std::span<float> values) {
+  for (size_t i = 0; i < codes.size(); i++) {
+    values[i] = half_to_float(codes[i]) * scale[i] + offset[i];
+  }
+}
+
+/// @brief Decodes uint8 codes using the widest available SIMD path.
+inline void dequantize(std::span<const uint8_t> codes,
+                       std::span<const float> scale,
+                       std::span<const float> offset, std::span<float> values) {
+  [[maybe_unused]] const size_t n = codes.size();
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 8 <= n; i += 8) {
+    const __m128i packed =
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes.data() + i));
+    const __m256 widened = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(packed));
+    const __m256 scaled =
+        _mm256_mul_ps(widened, _mm256_loadu_ps(scale.data() + i));
+    _mm256_storeu_ps(values.data() + i,
+                     _mm256_add_ps(scaled, _mm256_loadu_ps(offset.data() + i)));
+  }
+#elif defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 4 <= n; i += 4) {
+    int32_t packed;
+    std::memcpy(&packed, codes.data() + i, sizeof(packed));
+    const __m128i bytes = _mm_cvtsi32_si128(packed);
+    const __m128i words = _mm_unpacklo_epi8(bytes, zero);
+    const __m128 widened = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+    const __m128 scaled = _mm_mul_ps(widened, _mm_loadu_ps(scale.data() + i));
+    _mm_storeu_ps(values.data() + i,
+                  _mm_add_ps(scaled, _mm_loadu_ps(offset.data() + i)));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 8 <= n; i += 8) {
+    const uint16x8_t words = vmovl_u8(vld1_u8(codes.data() + i));
+    const float32x4_t low = vcvtq_f32_u32(vmovl_u16(vget_low_u16(words)));
+    const float32x4_t high = vcvtq_f32_u32(vmovl_u16(vget_high_u16(words)));
+    vst1q_f32(values.data() + i,
+              vmlaq_f32(vld1q_f32(offset.data() + i), low,
+                        vld1q_f32(scale.data() + i)));
+    vst1q_f32(values.data() + i + 4,
+              vmlaq_f32(vld1q_f32(offset.data() + i + 4), high,
+                        vld1q_f32(scale.data() + i + 4)));
+  }
+#endif
+  dequantize_scalar(codes.subspan(i), scale.subspan(i), offset.subspan(i),
+                    values.subspan(i));
+}
+
+/// @brief Decodes half precision codes using hardware conversion when
+/// available (F16C on x86, NEON on AArch64).
+inline void dequantize(std::span<const Float16> codes,
+                       std::span<const float> scale,
+                       std::span<const float> offset, std::span<float> values) {
+  [[maybe_unused]] const size_t n = codes.size();
+  size_t i = 0;
+#if defined(__F16C__) && defined(__AVX__)
+  for (; i + 8 <= n; i += 8) {
+    const __m256 widened = _mm256_cvtph_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes.data() + i)));
+    const __m256 scaled =
+        _mm256_mul_ps(widened, _mm256_loadu_ps(scale.data() + i));
+    _mm256_storeu_ps(values.data() + i,
+                     _mm256_add_ps(scaled, _mm256_loadu_ps(offset.data() + i)));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (; i + 4 <= n; i += 4) {
+    const float32x4_t widened = vcvt_f32_f16(vreinterpret_f16_u16(
+        vld1_u16(reinterpret_cast<const uint16_t*>(codes.data() + i))));
+    vst1q_f32(values.data() + i,
+              vmlaq_f32(vld1q_f32(offset.data() + i), widened,
+                        vld1q_f32(scale.data() + i)));
+  }
+#endif
+  dequantize_scalar(codes.subspan(i), scale.subspan(i), offset.subspan(i),
+                    values.subspan(i));
+}
+}  // namespace replay_buffer
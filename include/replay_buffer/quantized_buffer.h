@@ -0,0 +1,203 @@
+#pragma once
+
+/// @file quantized_buffer.h
+/// @brief Fixed-capacity ring column of quantized float observations.
+/// Observations are quantized on add() and dequantized with SIMD kernels
+/// while gathering sampled rows.
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "replay_buffer/quantize.h"
+
+namespace replay_buffer {
+
+struct QuantizedBufferConfig {
+  size_t capacity;
+  size_t feature_dim;
+  /// Per-feature scale; empty means 1 for every feature.
+  std::vector<float> scale;
+  /// Per-feature offset; empty means 0 for every feature.
+  std::vector<float> offset;
+};
+
+/// @brief Ring buffer of fixed-width float observations stored as codes.
+/// Uses the same slot layout as CircularBuffer (add() returns the physical
+/// slot), so it can be kept alongside a CircularBuffer or
+/// PrioritizedReplayBuffer holding the rest of the transition and gathered
+/// by the indices they return.
+/// @tparam Code Storage type per feature: uint8_t (4x smaller) or Float16
+/// (2x smaller)
+template <typename Code>
+class QuantizedBuffer {
+  static_assert(std::is_same_v<Code, uint8_t> || std::is_same_v<Code, Float16>,
+                "QuantizedBuffer supports uint8_t and Float16 codes");
+
+ public:
+  explicit QuantizedBuffer(const QuantizedBufferConfig& config) {
+    if (config.capacity == 0) {
+      throw std::invalid_argument("Capacity must be greater than 0");
+    }
+    if (config.feature_dim == 0) {
+      throw std::invalid_argument("Feature dimension must be greater than 0");
+    }
+    if (!config.scale.empty() && config.scale.size() != config.feature_dim) {
+      throw std::invalid_argument("Scale must have one entry per feature");
+    }
+    if (!config.offset.empty() && config.offset.size() != config.feature_dim) {
+      throw std::invalid_argument("Offset must have one entry per feature");
+    }
+    capacity_ = config.capacity;
+    feature_dim_ = config.feature_dim;
+    scale_ = config.scale.empty() ? std::vector<float>(feature_dim_, 1.0f)
+                                  : config.scale;
+    offset_ = config.offset.empty() ? std::vector<float>(feature_dim_, 0.0f)
+                                    : config.offset;
+    inverse_scale_.resize(feature_dim_);
+    for (size_t i = 0; i < feature_dim_; i++) {
+      if (!(scale_[i] > 0.0f)) {
+        throw std::invalid_argument("Scale must be positive");
+      }
+      inverse_scale_[i] = 1.0f / scale_[i];
+    }
+    codes_.resize(capacity_ * feature_dim_);
+    size_ = 0;
+    head_ = 0;
+    tail_ = 0;
+    gen_ = std::mt19937(std::random_device{}());
+  }
+
+  size_t size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return size_;
+  }
+
+  size_t capacity() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return capacity_;
+  }
+
+  size_t feature_dim() const { return feature_dim_; }
+
+  bool is_full() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return size_ == capacity_;
+  }
+
+  bool is_empty() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return size_ == 0;
+  }
+
+  /// @brief Quantizes and stores one observation, overwriting the oldest when
+  /// full.
+  /// @param observation feature_dim float values
+  /// @return Physical slot the observation was stored in
+  size_t add(std::span<const float> observation) {
+    if (observation.size() != feature_dim_) {
+      throw std::invalid_argument("Observation size must match feature_dim");
+    }
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    const size_t stored_index = tail_;
+    quantize(observation, inverse_scale_, offset_, row(stored_index));
+    tail_ = (tail_ + 1) % capacity_;
+    if (size_ != capacity_) {
+      size_++;
+    } else {
+      head_ = (head_ + 1) % capacity_;
+    }
+    return stored_index;
+  }
+
+  /// @brief Removes all observations. Like CircularBuffer::clear(), the
+  /// next add() continues at the current tail slot.
+  void clear() {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    size_ = 0;
+    head_ = tail_;
+  }
+
+  /// @brief Dequantizes the observation at a logical index (0 = oldest).
+  void get(size_t index, std::span<float> out) const {
+    if (out.size() != feature_dim_) {
+      throw std::invalid_argument("Output size must match feature_dim");
+    }
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    if (index >= size_) {
+      throw std::out_of_range("Index out of range");
+    }
+    dequantize(row((head_ + index) % capacity_), scale_, offset_, out);
+  }
+
+  /// @brief Dequantizes the rows at the given physical slots into out.
+  /// @param slots Slots as returned by add() or a companion buffer's sample
+  /// @param out Row-major output of slots.size() * feature_dim floats
+  void gather(std::span<const size_t> slots, std::span<float> out) const {
+    if (out.size() != slots.size() * feature_dim_) {
+      throw std::invalid_argument("Output size must be slots * feature_dim");
+    }
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (size_t i = 0; i < slots.size(); i++) {
+      if (slots[i] >= capacity_) {
+        throw std::out_of_range("Slot out of range");
+      }
+      dequantize(row(slots[i]), scale_, offset_,
+                 out.subspan(i * feature_dim_, feature_dim_));
+    }
+  }
+
+  /// @brief Samples observations uniformly with replacement.
+  /// @return Row-major batch_size * feature_dim dequantized floats
+  std::vector<float> sample(size_t batch_size) const {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+
+    if (batch_size <= 0) {
+      throw std::invalid_argument("Batch size must be > 0");
+    }
+    if (batch_size > size_) {
+      throw std::invalid_argument("Batch size exceeds buffer size");
+    }
+
+    std::vector<float> result(batch_size * feature_dim_);
+    std::span<float> out(result);
+
+    std::uniform_int_distribution<size_t> dist(0, size_ - 1);
+
+    for (size_t i = 0; i < batch_size; i++) {
+      size_t index = dist(gen_);
+      dequantize(row((head_ + index) % capacity_), scale_, offset_,
+                 out.subspan(i * feature_dim_, feature_dim_));
+    }
+
+    return result;
+  }
+
+ private:
+  std::span<Code> row(size_t slot) {
+    return std::span<Code>(codes_.data() + slot * feature_dim_, feature_dim_);
+  }
+
+  std::span<const Code> row(size_t slot) const {
+    return std::span<const Code>(codes_.data() + slot * feature_dim_,
+                                 feature_dim_);
+  }
+
+  size_t capacity_;
+  size_t feature_dim_;
+  std::vector<float> scale_;
+  std::vector<float> inverse_scale_;
+  std::vector<float> offset_;
+  std::vector<Code> codes_;
+  size_t size_;
+  size_t head_;
+  size_t tail_;
+  mutable std::shared_mutex mutex_;
+  mutable std::mt19937 gen_;
+};
+}  // namespace replay_buffer
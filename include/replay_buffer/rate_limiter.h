@@ -0,0 +1,303 @@
+#pragma once
+
+/// @file rate_limiter.h
+/// @brief Keeps learners' sampling and actors' inserts at a target
+/// samples-per-insert ratio by blocking whichever side runs ahead.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#include "replay_buffer/prioritized_replay_buffer.h"
+
+namespace replay_buffer {
+struct RateLimiterConfig {
+  /// Target number of sampled items per inserted item
+  double samples_per_insert = 1.0;
+  /// Sampling blocks until this many items have been inserted
+  size_t min_size_to_sample = 1;
+  /// How far, in sampled items, either side may run ahead of the target
+  /// ratio before it blocks. Must be >= 0; 0 makes the sides alternate.
+  double error_tolerance = 100.0;
+};
+
+/// @brief Calls and time spent blocked on each side, since construction.
+struct RateLimiterStats {
+  uint64_t inserts = 0;
+  uint64_t samples = 0;
+  uint64_t insert_waits = 0;
+  uint64_t sample_waits = 0;
+  std::chrono::nanoseconds insert_blocked{0};
+  std::chrono::nanoseconds sample_blocked{0};
+};
+
+/// @brief Tracks diff = inserts * samples_per_insert - samples and lets
+/// inserts through while diff <= target + tolerance, and samples through
+/// while diff >= target - tolerance, where target is samples_per_insert *
+/// min_size_to_sample (the headroom left by the initial fill). The check
+/// is made before a call's count is applied, so a batch may overshoot the
+/// window by its own size but the two sides can never both be blocked.
+/// Inserts are never blocked before min_size_to_sample.
+/// Calls that need not wait take one uncontended mutex and signal a
+/// condition variable only if the other side has a waiter.
+class RateLimiter {
+ public:
+  explicit RateLimiter(const RateLimiterConfig& config) : config_(config) {
+    if (!(config.samples_per_insert > 0.0)) {
+      throw std::invalid_argument("Samples per insert must be > 0");
+    }
+    if (!(config.error_tolerance >= 0.0)) {
+      throw std::invalid_argument("Error tolerance must be >= 0");
+    }
+    target_ = config.samples_per_insert *
+              static_cast<double>(config.min_size_to_sample);
+  }
+
+  const RateLimiterConfig& config() const { return config_; }
+
+  /// @brief Blocks until count items may be inserted, then records them.
+  /// @throws std::runtime_error if the limiter is closed
+  void acquire_insert(size_t count = 1) {
+    try_acquire_insert(count, std::nullopt);
+  }
+
+  /// @brief Blocks until a batch of count may be sampled, then records it.
+  /// @throws std::runtime_error if the limiter is closed
+  void acquire_sample(size_t count) { try_acquire_sample(count, std::nullopt); }
+
+  /// @brief acquire_insert() that gives up after timeout, so callers can
+  /// back off and do other work.
+  /// @return Whether the insert was recorded
+  bool try_acquire_insert(
+      size_t count, std::optional<std::chrono::nanoseconds> timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!wait(lock, insert_ready_, insert_waiters_, stats_.insert_waits,
+              stats_.insert_blocked, timeout,
+              [&]() { return can_insert(); })) {
+      return false;
+    }
+    inserts_ += count;
+    stats_.inserts += count;
+    lock.unlock();
+    if (sample_waiters_.load(std::memory_order_relaxed) > 0) {
+      sample_ready_.notify_all();
+    }
+    return true;
+  }
+
+  /// @return Whether the sample was recorded
+  bool try_acquire_sample(
+      size_t count, std::optional<std::chrono::nanoseconds> timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!wait(lock, sample_ready_, sample_waiters_, stats_.sample_waits,
+              stats_.sample_blocked, timeout,
+              [&]() { return can_sample(); })) {
+      return false;
+    }
+    samples_ += count;
+    stats_.samples += count;
+    lock.unlock();
+    if (insert_waiters_.load(std::memory_order_relaxed) > 0) {
+      insert_ready_.notify_all();
+    }
+    return true;
+  }
+
+  /// @brief Takes back an acquired insert whose buffer write failed.
+  void cancel_insert(size_t count = 1) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      inserts_ -= count;
+      stats_.inserts -= count;
+    }
+    insert_ready_.notify_all();
+  }
+
+  /// @brief Takes back an acquired sample whose buffer read failed.
+  void cancel_sample(size_t count) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      samples_ -= count;
+      stats_.samples -= count;
+    }
+    sample_ready_.notify_all();
+  }
+
+  /// @brief Wakes every blocked caller with std::runtime_error and fails
+  /// all later calls, e.g. at shutdown.
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    insert_ready_.notify_all();
+    sample_ready_.notify_all();
+  }
+
+  RateLimiterStats stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+ private:
+  double diff() const {
+    return static_cast<double>(inserts_) * config_.samples_per_insert -
+           static_cast<double>(samples_);
+  }
+
+  bool can_insert() const {
+    return inserts_ < config_.min_size_to_sample ||
+           diff() <= target_ + config_.error_tolerance;
+  }
+
+  bool can_sample() const {
+    return inserts_ >= config_.min_size_to_sample &&
+           diff() >= target_ - config_.error_tolerance;
+  }
+
+  /// @brief Waits on ready until allowed() or timeout, counting the wait
+  /// and its duration. Returns false on timeout, throws once closed.
+  template <typename Allowed>
+  bool wait(std::unique_lock<std::mutex>& lock, std::condition_variable& ready,
+            std::atomic<size_t>& waiters, uint64_t& waits,
+            std::chrono::nanoseconds& blocked,
+            std::optional<std::chrono::nanoseconds> timeout, Allowed allowed) {
+    if (closed_) {
+      throw std::runtime_error("Rate limiter closed");
+    }
+    if (allowed()) {
+      return true;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const auto done = [&]() { return closed_ || allowed(); };
+    waiters++;
+    waits++;
+    bool ready_in_time = true;
+    if (timeout) {
+      ready_in_time = ready.wait_for(lock, *timeout, done);
+    } else {
+      ready.wait(lock, done);
+    }
+    waiters--;
+    blocked += std::chrono::steady_clock::now() - start;
+    if (closed_) {
+      throw std::runtime_error("Rate limiter closed");
+    }
+    return ready_in_time;
+  }
+
+  RateLimiterConfig config_;
+  double target_;
+  mutable std::mutex mutex_;
+  std::condition_variable insert_ready_;
+  std::condition_variable sample_ready_;
+  uint64_t inserts_ = 0;
+  uint64_t samples_ = 0;
+  // Changed under the lock but read after it, to skip notifying when
+  // nobody waits. A waiter registers under the lock before it sleeps, so a
+  // notifier that changed the counts after that sees it.
+  std::atomic<size_t> insert_waiters_{0};
+  std::atomic<size_t> sample_waiters_{0};
+  bool closed_ = false;
+  RateLimiterStats stats_;
+};
+
+/// @brief A CircularBuffer or PrioritizedReplayBuffer whose add and sample
+/// calls go through a RateLimiter. Blocking calls wait as long as needed;
+/// try_ calls give up after a timeout.
+/// @tparam Buffer CircularBuffer<T> or PrioritizedReplayBuffer<T>
+template <typename Buffer>
+class RateLimitedReplayBuffer {
+ public:
+  using value_type = typename Buffer::value_type;
+  using SampleBatch = decltype(std::declval<const Buffer&>().sample(1));
+
+  /// @param args Forwarded to the Buffer constructor
+  template <typename... Args>
+  explicit RateLimitedReplayBuffer(const RateLimiterConfig& config,
+                                   Args&&... args)
+      : limiter_(config), buffer_(std::forward<Args>(args)...) {}
+
+  /// @brief The wrapped buffer. Calls made on it directly bypass the
+  /// limiter.
+  Buffer& buffer() { return buffer_; }
+  const Buffer& buffer() const { return buffer_; }
+
+  RateLimiter& limiter() { return limiter_; }
+
+  void add(const value_type& item) {
+    limiter_.acquire_insert();
+    guarded_insert(1, [&]() { buffer_.add(item); });
+  }
+
+  bool try_add(const value_type& item, std::chrono::nanoseconds timeout) {
+    if (!limiter_.try_acquire_insert(1, timeout)) {
+      return false;
+    }
+    guarded_insert(1, [&]() { buffer_.add(item); });
+    return true;
+  }
+
+  /// @brief Forwards to Buffer::add_batch(), counting every item.
+  template <typename... Args>
+  void add_batch(std::span<const value_type> items, Args&&... args) {
+    limiter_.acquire_insert(items.size());
+    guarded_insert(items.size(), [&]() {
+      buffer_.add_batch(items, std::forward<Args>(args)...);
+    });
+  }
+
+  SampleBatch sample(size_t batch_size) {
+    limiter_.acquire_sample(batch_size);
+    return guarded_sample(batch_size);
+  }
+
+  std::optional<SampleBatch> try_sample(size_t batch_size,
+                                        std::chrono::nanoseconds timeout) {
+    if (!limiter_.try_acquire_sample(batch_size, timeout)) {
+      return std::nullopt;
+    }
+    return guarded_sample(batch_size);
+  }
+
+  /// @brief Priority updates are not rate limited.
+  template <typename... Args>
+  auto update_priorities(Args&&... args) {
+    return buffer_.update_priorities(std::forward<Args>(args)...);
+  }
+
+  RateLimiterStats stats() const { return limiter_.stats(); }
+
+  void close() { limiter_.close(); }
+
+ private:
+  template <typename F>
+  void guarded_insert(size_t count, F&& insert) {
+    try {
+      insert();
+    } catch (...) {
+      limiter_.cancel_insert(count);
+      throw;
+    }
+  }
+
+  SampleBatch guarded_sample(size_t batch_size) {
+    try {
+      return buffer_.sample(batch_size);
+    } catch (...) {
+      limiter_.cancel_sample(batch_size);
+      throw;
+    }
+  }
+
+  RateLimiter limiter_;
+  Buffer buffer_;
+};
+}  // namespace replay_buffer
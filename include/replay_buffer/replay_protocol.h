@@ -0,0 +1,230 @@
+#pragma once
+
+/// @file replay_protocol.h
+/// @brief Wire protocol between ReplayServer and ShardedReplayClient.
+/// Every message is a fixed header followed by a payload of plain structs
+/// and arrays of T copied byte for byte, so both ends must run on the same
+/// architecture and be built with the same T.
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace replay_buffer::detail {
+enum class ReplayOp : uint32_t {
+  /// Payload: count, count items, and count TD errors if has_td_errors.
+  /// Reply: none.
+  kAdd = 1,
+  /// Payload: batch size. Reply: ShardStats, then batch WireSample<T>.
+  kSample = 2,
+  /// Payload: count, count WireHandle, count TD errors. Reply: applied.
+  kUpdatePriorities = 3,
+  /// Payload: none. Reply: ShardStats.
+  kStats = 4,
+};
+
+enum class ReplayStatus : uint32_t {
+  kOk = 0,
+  /// Payload is the exception message
+  kError = 1,
+};
+
+/// Largest batch one kSample request may ask a shard for
+inline constexpr uint64_t kMaxSampleBatch = uint64_t{1} << 20;
+
+struct MessageHeader {
+  uint32_t code;  // ReplayOp for requests, ReplayStatus for replies
+  uint32_t reserved;
+  uint64_t bytes;  // payload size
+};
+
+struct AddRequest {
+  uint64_t count;
+  uint64_t has_td_errors;
+};
+
+struct ShardStats {
+  float total_priority;
+  uint32_t reserved;
+  uint64_t size;
+};
+
+struct WireHandle {
+  uint64_t index;
+  uint64_t generation;
+};
+
+template <typename T>
+struct WireSample {
+  T transition;
+  float priority;
+  uint64_t index;
+  uint64_t generation;
+};
+
+/// @brief Sends all of data, retrying partial writes. MSG_NOSIGNAL turns a
+/// closed peer into an error instead of SIGPIPE.
+inline void send_all(int fd, const void* data, size_t bytes) {
+  const char* cursor = static_cast<const char*>(data);
+  while (bytes > 0) {
+    const ssize_t sent = ::send(fd, cursor, bytes, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "send");
+    }
+    cursor += sent;
+    bytes -= static_cast<size_t>(sent);
+  }
+}
+
+/// @brief Receives exactly bytes. Returns false if the peer closed the
+/// connection before the first byte.
+inline bool recv_all(int fd, void* data, size_t bytes) {
+  char* cursor = static_cast<char*>(data);
+  const size_t expected = bytes;
+  while (bytes > 0) {
+    const ssize_t received = ::recv(fd, cursor, bytes, 0);
+    if (received < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "recv");
+    }
+    if (received == 0) {
+      if (bytes == expected) {
+        return false;
+      }
+      throw std::runtime_error("Connection closed mid-message");
+    }
+    cursor += received;
+    bytes -= static_cast<size_t>(received);
+  }
+  return true;
+}
+
+/// @brief Accumulates a payload from structs and arrays of trivially
+/// copyable values.
+class MessageWriter {
+ public:
+  template <typename V>
+  void put(const V& value) {
+    static_assert(std::is_trivially_copyable_v<V>);
+    put_bytes(&value, sizeof(V));
+  }
+
+  template <typename V>
+  void put(std::span<const V> values) {
+    static_assert(std::is_trivially_copyable_v<V>);
+    put_bytes(values.data(), values.size_bytes());
+  }
+
+  /// @brief Drops anything put since the last send().
+  void clear() { bytes_.resize(sizeof(MessageHeader)); }
+
+  /// @brief Sends the header and payload in one write.
+  void send(int fd, uint32_t code) {
+    MessageHeader header{code, 0, bytes_.size() - sizeof(MessageHeader)};
+    std::memcpy(bytes_.data(), &header, sizeof(header));
+    send_all(fd, bytes_.data(), bytes_.size());
+    bytes_.resize(sizeof(MessageHeader));
+  }
+
+ private:
+  void put_bytes(const void* data, size_t size) {
+    const size_t offset = bytes_.size();
+    bytes_.resize(offset + size);
+    if (size > 0) {
+      std::memcpy(bytes_.data() + offset, data, size);
+    }
+  }
+
+  std::vector<char> bytes_ = std::vector<char>(sizeof(MessageHeader));
+};
+
+/// @brief Reads structs and arrays back out of a received payload,
+/// checking that the payload is long enough.
+class MessageReader {
+ public:
+  /// @brief Receives one message. Returns false on a clean close.
+  bool receive(int fd) {
+    MessageHeader header;
+    if (!recv_all(fd, &header, sizeof(header))) {
+      return false;
+    }
+    code_ = header.code;
+    bytes_.resize(header.bytes);
+    offset_ = 0;
+    if (header.bytes > 0 && !recv_all(fd, bytes_.data(), header.bytes)) {
+      throw std::runtime_error("Connection closed mid-message");
+    }
+    return true;
+  }
+
+  uint32_t code() const { return code_; }
+
+  template <typename V>
+  V get() {
+    static_assert(std::is_trivially_copyable_v<V>);
+    V value;
+    std::memcpy(&value, take(sizeof(V)), sizeof(V));
+    return value;
+  }
+
+  /// @brief Copies count values out of the payload, which is not aligned
+  /// for V.
+  template <typename V>
+  std::vector<V> get_array(size_t count) {
+    static_assert(std::is_trivially_copyable_v<V>);
+    if (count > remaining() / sizeof(V)) {
+      throw std::runtime_error("Truncated message");
+    }
+    std::vector<V> values(count);
+    if (count > 0) {
+      std::memcpy(values.data(), take(count * sizeof(V)), count * sizeof(V));
+    }
+    return values;
+  }
+
+  std::string rest_as_string() {
+    std::string text(bytes_.data() + offset_, remaining());
+    offset_ = bytes_.size();
+    return text;
+  }
+
+ private:
+  size_t remaining() const { return bytes_.size() - offset_; }
+
+  const char* take(size_t size) {
+    if (size > remaining()) {
+      throw std::runtime_error("Truncated message");
+    }
+    const char* data = bytes_.data() + offset_;
+    offset_ += size;
+    return data;
+  }
+
+  uint32_t code_ = 0;
+  std::vector<char> bytes_;
+  size_t offset_ = 0;
+};
+
+/// @brief Disables Nagle's algorithm: requests are small and latency bound.
+inline void set_no_delay(int fd) {
+  const int enable = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+}
+}  // namespace replay_buffer::detail
@@ -0,0 +1,269 @@
+#pragma once
+
+/// @file replay_server.h
+/// @brief TCP server holding one shard of a distributed prioritized replay
+/// buffer. Clients (see sharded_replay_client.h) add to it, sample from it
+/// and route priority updates back to it.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "replay_buffer/prioritized_replay_buffer.h"
+#include "replay_buffer/replay_protocol.h"
+
+namespace replay_buffer {
+/// @brief Serves a PrioritizedReplayBuffer shard over TCP, one thread per
+/// client connection. Requests on a connection are handled in order; the
+/// buffer's own locking orders requests across connections.
+/// @tparam T Trivially copyable transition type, sent byte for byte
+template <typename T>
+class ReplayServer {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "ReplayServer requires a trivially copyable transition type");
+
+ public:
+  /// @param port Port to listen on; 0 picks a free one (see port())
+  /// @param host IPv4 address to bind
+  explicit ReplayServer(const PrioritizedReplayBufferConfig& config,
+                        uint16_t port = 0,
+                        const std::string& host = "127.0.0.1")
+      : buffer_(config) {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+      throw std::system_error(errno, std::generic_category(), "socket");
+    }
+    const int reuse = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+      ::close(listen_fd_);
+      throw std::invalid_argument("Invalid IPv4 address: " + host);
+    }
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address),
+               sizeof(address)) < 0 ||
+        ::listen(listen_fd_, SOMAXCONN) < 0) {
+      const int error = errno;
+      ::close(listen_fd_);
+      throw std::system_error(error, std::generic_category(), "bind");
+    }
+    socklen_t length = sizeof(address);
+    ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length);
+    port_ = ntohs(address.sin_port);
+    acceptor_ = std::thread([this]() { accept_loop(); });
+  }
+
+  ReplayServer(const ReplayServer&) = delete;
+  ReplayServer& operator=(const ReplayServer&) = delete;
+
+  ~ReplayServer() { stop(); }
+
+  uint16_t port() const { return port_; }
+
+  /// @brief The shard, for local inspection; clients go through the socket.
+  PrioritizedReplayBuffer<T>& buffer() { return buffer_; }
+
+  /// @brief Client connections currently open.
+  size_t connection_count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connections_.size();
+  }
+
+  /// @brief Stops accepting, closes every connection and joins the threads.
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopped_) {
+        return;
+      }
+      stopped_ = true;
+      // Unblocks accept() and every recv()
+      ::shutdown(listen_fd_, SHUT_RDWR);
+      for (auto& [id, connection] : connections_) {
+        ::shutdown(connection.fd, SHUT_RDWR);
+      }
+    }
+    // Connection threads leave connections_ alone once stopped_ is set
+    acceptor_.join();
+    for (auto& [id, connection] : connections_) {
+      connection.thread.join();
+      ::close(connection.fd);
+    }
+    for (std::thread& thread : finished_) {
+      thread.join();
+    }
+    ::close(listen_fd_);
+  }
+
+ private:
+  void accept_loop() {
+    while (true) {
+      const int fd = ::accept(listen_fd_, nullptr, nullptr);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopped_) {
+        if (fd >= 0) {
+          ::close(fd);
+        }
+        return;
+      }
+      reap_finished();
+      if (fd < 0) {
+        continue;
+      }
+      detail::set_no_delay(fd);
+      const uint64_t id = next_connection_id_++;
+      connections_.emplace(
+          id, Connection{fd, std::thread([this, id, fd]() {
+                           serve(fd);
+                           retire(id);
+                         })});
+    }
+  }
+
+  /// @brief Closes a connection whose client went away and hands its
+  /// thread to the acceptor to join, so a long-running shard does not
+  /// accumulate fds and threads. After stop() the connection is left for
+  /// stop() to close.
+  void retire(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) {
+      return;
+    }
+    const auto connection = connections_.find(id);
+    ::close(connection->second.fd);
+    // Moving the calling thread's own handle is fine; it is joined later
+    finished_.push_back(std::move(connection->second.thread));
+    connections_.erase(connection);
+  }
+
+  /// @brief Joins threads that have retired. Called with mutex_ held;
+  /// retired threads no longer take it, so the joins return promptly.
+  void reap_finished() {
+    for (std::thread& thread : finished_) {
+      thread.join();
+    }
+    finished_.clear();
+  }
+
+  void serve(int fd) {
+    detail::MessageReader request;
+    detail::MessageWriter reply;
+    try {
+      while (request.receive(fd)) {
+        try {
+          reply.clear();
+          handle(request, reply);
+          reply.send(fd, static_cast<uint32_t>(detail::ReplayStatus::kOk));
+        } catch (const std::system_error&) {
+          throw;
+        } catch (const std::exception& error) {
+          // Bad requests are reported to the client, not fatal to the server
+          detail::MessageWriter message;
+          const std::string text = error.what();
+          message.put(std::span<const char>(text.data(), text.size()));
+          message.send(fd,
+                       static_cast<uint32_t>(detail::ReplayStatus::kError));
+        }
+      }
+    } catch (const std::exception&) {
+      // Socket failure or shutdown: drop the connection
+    }
+  }
+
+  void handle(detail::MessageReader& request, detail::MessageWriter& reply) {
+    switch (static_cast<detail::ReplayOp>(request.code())) {
+      case detail::ReplayOp::kAdd: {
+        const auto header = request.get<detail::AddRequest>();
+        const std::vector<T> items = request.get_array<T>(header.count);
+        if (header.has_td_errors != 0) {
+          const std::vector<float> td_errors =
+              request.get_array<float>(header.count);
+          buffer_.add_batch(items, td_errors);
+        } else {
+          for (const T& item : items) {
+            buffer_.add(item);
+          }
+        }
+        return;
+      }
+      case detail::ReplayOp::kSample: {
+        const auto batch_size = request.get<uint64_t>();
+        // Bound what a request can make the shard allocate, and keep an
+        // empty shard from sampling a zero-width distribution
+        if (batch_size == 0 || batch_size > detail::kMaxSampleBatch) {
+          throw std::invalid_argument("Batch size must be in [1, " +
+                                      std::to_string(detail::kMaxSampleBatch) +
+                                      "]");
+        }
+        if (buffer_.size() == 0 || !(buffer_.total_priority() > 0.0f)) {
+          throw std::invalid_argument("Cannot sample from an empty shard");
+        }
+        const std::vector<PrioritizedSample<T>> samples =
+            buffer_.sample(batch_size);
+        reply.put(stats());
+        for (const PrioritizedSample<T>& sample : samples) {
+          reply.put(detail::WireSample<T>{sample.transition, sample.priority,
+                                          sample.index, sample.generation});
+        }
+        return;
+      }
+      case detail::ReplayOp::kUpdatePriorities: {
+        const auto count = request.get<uint64_t>();
+        const std::vector<detail::WireHandle> wire_handles =
+            request.get_array<detail::WireHandle>(count);
+        const std::vector<float> td_errors = request.get_array<float>(count);
+        std::vector<SampleHandle> handles(count);
+        for (size_t i = 0; i < count; i++) {
+          handles[i] = {wire_handles[i].index, wire_handles[i].generation};
+        }
+        reply.put(static_cast<uint64_t>(
+            buffer_.update_priorities(handles, td_errors)));
+        return;
+      }
+      case detail::ReplayOp::kStats:
+        reply.put(stats());
+        return;
+    }
+    throw std::invalid_argument("Unknown request");
+  }
+
+  detail::ShardStats stats() const {
+    return {buffer_.total_priority(), 0, buffer_.size()};
+  }
+
+  PrioritizedReplayBuffer<T> buffer_;
+  int listen_fd_;
+  uint16_t port_;
+  std::thread acceptor_;
+  struct Connection {
+    int fd;
+    std::thread thread;
+  };
+
+  // All guarded by mutex_. Keyed by id rather than fd, since a closed fd
+  // number can be reused by the next accept() before its thread is joined
+  std::mutex mutex_;
+  bool stopped_ = false;
+  uint64_t next_connection_id_ = 0;
+  std::unordered_map<uint64_t, Connection> connections_;
+  // Threads of retired connections, joined by the acceptor
+  std::vector<std::thread> finished_;
+};
+}  // namespace replay_buffer
@@ -0,0 +1,437 @@
+#pragma once
+
+/// @file sharded_replay_client.h
+/// @brief Client for a prioritized replay buffer sharded across several
+/// ReplayServer processes. Samples globally in proportion to each shard's
+/// total priority and routes priority updates back to the owning shard.
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "replay_buffer/prioritized_replay_buffer.h"
+#include "replay_buffer/replay_protocol.h"
+
+namespace replay_buffer {
+struct ShardEndpoint {
+  std::string host;
+  uint16_t port;
+};
+
+struct ShardedReplayClientConfig {
+  std::vector<ShardEndpoint> shards;
+  /// Importance sampling exponent, applied to global probabilities
+  float beta = 0.4f;
+  /// How often a background thread re-reads shard totals; zero disables it
+  /// and totals change only through refresh_totals() and sample replies
+  std::chrono::milliseconds refresh_interval{100};
+};
+
+/// @brief Identifies a sampled transition across the cluster.
+struct ShardedSampleHandle {
+  size_t shard;
+  SampleHandle handle;
+};
+
+template <typename T>
+struct ShardedSample {
+  T transition;
+  /// Importance sampling weight from the global sampling probability
+  float weight;
+  ShardedSampleHandle handle;
+};
+
+/// @brief Talks to every shard over one TCP connection each. A batch is
+/// split into per-shard counts drawn from the cached shard totals; the
+/// sub-requests are all sent before any reply is read, so shards sample in
+/// parallel. Thread-safe: requests to one shard are serialized, and
+/// multi-shard calls lock connections in shard order.
+/// @tparam T Trivially copyable transition type matching the servers
+template <typename T>
+class ShardedReplayClient {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "ShardedReplayClient requires a trivially copyable type");
+
+ public:
+  explicit ShardedReplayClient(const ShardedReplayClientConfig& config)
+      : beta_(config.beta), gen_(std::random_device{}()) {
+    if (config.shards.empty()) {
+      throw std::invalid_argument("At least one shard is required");
+    }
+    if (config.beta < 0.0f || config.beta > 1.0f) {
+      throw std::invalid_argument("Beta must be between 0 and 1");
+    }
+    for (const ShardEndpoint& endpoint : config.shards) {
+      connections_.push_back(std::make_unique<Connection>(endpoint));
+    }
+    stats_.resize(connections_.size());
+    refresh_totals();
+    if (config.refresh_interval.count() > 0) {
+      refresher_ = std::jthread([this, interval = config.refresh_interval](
+                                    std::stop_token stop) {
+        std::mutex mutex;
+        std::condition_variable_any wake;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+          wake.wait_for(lock, stop, interval, [] { return false; });
+          if (stop.stop_requested()) {
+            return;
+          }
+          try {
+            refresh_totals();
+          } catch (const std::exception&) {
+            // Keep the last known totals; the next request will surface
+            // the failure to the caller
+          }
+        }
+      });
+    }
+  }
+
+  ShardedReplayClient(const ShardedReplayClient&) = delete;
+  ShardedReplayClient& operator=(const ShardedReplayClient&) = delete;
+
+  size_t shard_count() const { return connections_.size(); }
+
+  /// @brief Re-reads every shard's total priority and size, querying all
+  /// shards before waiting on any.
+  void refresh_totals() {
+    auto locks = lock_all();
+    detail::MessageWriter request;
+    for (const auto& connection : connections_) {
+      request.send(connection->fd,
+                   static_cast<uint32_t>(detail::ReplayOp::kStats));
+    }
+    std::vector<detail::ShardStats> stats(connections_.size());
+    for (size_t shard = 0; shard < connections_.size(); shard++) {
+      stats[shard] =
+          connections_[shard]->receive().template get<detail::ShardStats>();
+    }
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_ = std::move(stats);
+  }
+
+  /// @brief Cached total priority of each shard.
+  std::vector<float> shard_totals() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    std::vector<float> totals;
+    for (const detail::ShardStats& stats : stats_) {
+      totals.push_back(stats.total_priority);
+    }
+    return totals;
+  }
+
+  /// @brief Cached number of transitions across all shards.
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    size_t total = 0;
+    for (const detail::ShardStats& stats : stats_) {
+      total += stats.size;
+    }
+    return total;
+  }
+
+  /// @brief Adds transitions with the maximum priority of the receiving
+  /// shard. Batches go to shards round robin.
+  /// @return Shard the batch was sent to
+  size_t add_batch(std::span<const T> items) {
+    return send_add(items, std::span<const float>());
+  }
+
+  /// @brief Adds transitions with caller-computed TD errors.
+  /// @return Shard the batch was sent to
+  size_t add_batch(std::span<const T> items,
+                   std::span<const float> td_errors) {
+    if (items.size() != td_errors.size()) {
+      throw std::invalid_argument("Items and TD errors must have equal size");
+    }
+    return send_add(items, td_errors);
+  }
+
+  size_t add(const T& item) { return add_batch(std::span<const T>(&item, 1)); }
+
+  /// @brief Samples batch_size transitions with probability proportional to
+  /// priority across the whole cluster. Shard counts are drawn from the
+  /// cached totals; weights use the probability that was actually used:
+  /// P(shard) from the cached totals times P(item | shard) from the totals
+  /// the shard reports with its sample.
+  std::vector<ShardedSample<T>> sample(size_t batch_size) {
+    if (batch_size == 0) {
+      throw std::invalid_argument("Batch size must be > 0");
+    }
+    if (batch_size > detail::kMaxSampleBatch) {
+      throw std::invalid_argument("Batch size exceeds the protocol maximum");
+    }
+    std::vector<detail::ShardStats> cached;
+    std::vector<size_t> counts(connections_.size(), 0);
+    double cached_total = 0.0;
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      cached = stats_;
+      for (const detail::ShardStats& shard : cached) {
+        cached_total += shard.total_priority;
+      }
+      if (cached_total <= 0.0) {
+        throw std::invalid_argument("Cannot sample from an empty cluster");
+      }
+      // Multinomial split as a chain of binomials
+      double remaining_total = cached_total;
+      size_t remaining = batch_size;
+      for (size_t shard = 0; shard < cached.size() && remaining > 0; shard++) {
+        const double share = cached[shard].total_priority / remaining_total;
+        counts[shard] =
+            share >= 1.0 ? remaining
+                         : std::binomial_distribution<size_t>(
+                               remaining, std::max(share, 0.0))(gen_);
+        remaining -= counts[shard];
+        remaining_total -= cached[shard].total_priority;
+      }
+      // Rounding can leave a remainder after the last non-empty shard
+      for (size_t shard = cached.size(); remaining > 0 && shard-- > 0;) {
+        if (cached[shard].total_priority > 0.0f) {
+          counts[shard] += remaining;
+          remaining = 0;
+        }
+      }
+    }
+
+    auto locks = lock_all();
+    detail::MessageWriter request;
+    for (size_t shard = 0; shard < connections_.size(); shard++) {
+      if (counts[shard] > 0) {
+        request.put(static_cast<uint64_t>(counts[shard]));
+        request.send(connections_[shard]->fd,
+                     static_cast<uint32_t>(detail::ReplayOp::kSample));
+      }
+    }
+    // Read every reply before reporting a failure, so no connection is
+    // left with an unread reply
+    std::vector<std::vector<detail::WireSample<T>>> replies(
+        connections_.size());
+    std::vector<detail::ShardStats> stats = cached;
+    std::string error;
+    for (size_t shard = 0; shard < connections_.size(); shard++) {
+      if (counts[shard] == 0) {
+        continue;
+      }
+      try {
+        detail::MessageReader& reply = connections_[shard]->receive();
+        stats[shard] = reply.template get<detail::ShardStats>();
+        replies[shard] =
+            reply.template get_array<detail::WireSample<T>>(counts[shard]);
+      } catch (const std::exception& failure) {
+        if (error.empty()) {
+          error = "Shard " + std::to_string(shard) + ": " + failure.what();
+        }
+      }
+    }
+    if (!error.empty()) {
+      throw std::runtime_error(error);
+    }
+
+    const double cluster_size = static_cast<double>(std::accumulate(
+        stats.begin(), stats.end(), uint64_t{0},
+        [](uint64_t sum, const detail::ShardStats& shard) {
+          return sum + shard.size;
+        }));
+    const float beta = beta_.load(std::memory_order_relaxed);
+    std::vector<ShardedSample<T>> samples;
+    samples.reserve(batch_size);
+    for (size_t shard = 0; shard < connections_.size(); shard++) {
+      const double shard_probability =
+          cached[shard].total_priority / cached_total;
+      for (const detail::WireSample<T>& sample : replies[shard]) {
+        const double probability = shard_probability * sample.priority /
+                                   stats[shard].total_priority;
+        samples.push_back(ShardedSample<T>{
+            sample.transition,
+            static_cast<float>(std::pow(cluster_size * probability, -beta)),
+            {shard, {static_cast<size_t>(sample.index), sample.generation}}});
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      for (size_t shard = 0; shard < connections_.size(); shard++) {
+        if (counts[shard] > 0) {
+          stats_[shard] = stats[shard];
+        }
+      }
+    }
+    return samples;
+  }
+
+  /// @brief Sends each update to the shard that owns it, all shards at
+  /// once. Updates for transitions overwritten since sampling are dropped
+  /// by the shards.
+  /// @return Number of updates applied
+  size_t update_priorities(const std::vector<ShardedSampleHandle>& handles,
+                           const std::vector<float>& td_errors) {
+    if (handles.size() != td_errors.size()) {
+      throw std::invalid_argument("Handles and TD errors must have equal size");
+    }
+    std::vector<std::vector<detail::WireHandle>> shard_handles(
+        connections_.size());
+    std::vector<std::vector<float>> shard_errors(connections_.size());
+    for (size_t i = 0; i < handles.size(); i++) {
+      const size_t shard = handles[i].shard;
+      if (shard >= connections_.size()) {
+        throw std::out_of_range("Shard out of range");
+      }
+      shard_handles[shard].push_back(
+          {handles[i].handle.index, handles[i].handle.generation});
+      shard_errors[shard].push_back(td_errors[i]);
+    }
+
+    auto locks = lock_all();
+    detail::MessageWriter request;
+    for (size_t shard = 0; shard < connections_.size(); shard++) {
+      if (shard_handles[shard].empty()) {
+        continue;
+      }
+      request.put(static_cast<uint64_t>(shard_handles[shard].size()));
+      request.put(std::span<const detail::WireHandle>(shard_handles[shard]));
+      request.put(std::span<const float>(shard_errors[shard]));
+      request.send(connections_[shard]->fd,
+                   static_cast<uint32_t>(detail::ReplayOp::kUpdatePriorities));
+    }
+    size_t applied = 0;
+    std::string error;
+    for (size_t shard = 0; shard < connections_.size(); shard++) {
+      if (shard_handles[shard].empty()) {
+        continue;
+      }
+      try {
+        applied += connections_[shard]->receive().template get<uint64_t>();
+      } catch (const std::exception& failure) {
+        if (error.empty()) {
+          error = "Shard " + std::to_string(shard) + ": " + failure.what();
+        }
+      }
+    }
+    if (!error.empty()) {
+      throw std::runtime_error(error);
+    }
+    return applied;
+  }
+
+  float beta() const { return beta_.load(std::memory_order_relaxed); }
+
+  void set_beta(float beta) {
+    if (beta < 0.0f || beta > 1.0f) {
+      throw std::invalid_argument("Beta must be between 0 and 1");
+    }
+    beta_.store(beta, std::memory_order_relaxed);
+  }
+
+ private:
+  /// @brief One TCP connection to a shard, with the scratch reply it reads
+  /// into.
+  struct Connection {
+    explicit Connection(const ShardEndpoint& endpoint) {
+      addrinfo hints{};
+      hints.ai_family = AF_INET;
+      hints.ai_socktype = SOCK_STREAM;
+      addrinfo* addresses = nullptr;
+      const std::string port = std::to_string(endpoint.port);
+      const int result = ::getaddrinfo(endpoint.host.c_str(), port.c_str(),
+                                       &hints, &addresses);
+      if (result != 0) {
+        throw std::runtime_error("Cannot resolve " + endpoint.host + ": " +
+                                 ::gai_strerror(result));
+      }
+      fd = ::socket(AF_INET, SOCK_STREAM, 0);
+      if (fd < 0) {
+        ::freeaddrinfo(addresses);
+        throw std::system_error(errno, std::generic_category(), "socket");
+      }
+      const int connected =
+          ::connect(fd, addresses->ai_addr, addresses->ai_addrlen);
+      const int error = errno;
+      ::freeaddrinfo(addresses);
+      if (connected < 0) {
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(),
+                                "connect to " + endpoint.host + ":" + port);
+      }
+      detail::set_no_delay(fd);
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    ~Connection() { ::close(fd); }
+
+    /// @brief Reads the next reply, throwing the server's message if the
+    /// request failed there.
+    detail::MessageReader& receive() {
+      if (!reply.receive(fd)) {
+        throw std::runtime_error("Shard closed the connection");
+      }
+      if (reply.code() != static_cast<uint32_t>(detail::ReplayStatus::kOk)) {
+        throw std::runtime_error(reply.rest_as_string());
+      }
+      return reply;
+    }
+
+    int fd = -1;
+    std::mutex mutex;
+    detail::MessageReader reply;
+  };
+
+  /// @brief Sends a batch to the next shard in round robin order.
+  size_t send_add(std::span<const T> items, std::span<const float> td_errors) {
+    const size_t shard =
+        next_shard_.fetch_add(1, std::memory_order_relaxed) %
+        connections_.size();
+    Connection& connection = *connections_[shard];
+    std::lock_guard<std::mutex> lock(connection.mutex);
+    detail::MessageWriter request;
+    request.put(detail::AddRequest{items.size(), td_errors.empty() ? 0u : 1u});
+    request.put(items);
+    request.put(td_errors);
+    request.send(connection.fd, static_cast<uint32_t>(detail::ReplayOp::kAdd));
+    connection.receive();
+    return shard;
+  }
+
+  std::vector<std::unique_lock<std::mutex>> lock_all() {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (const auto& connection : connections_) {
+      locks.emplace_back(connection->mutex);
+    }
+    return locks;
+  }
+
+  std::vector<std::unique_ptr<Connection>> connections_;
+  // Shard totals and sizes from the last refresh or sample reply
+  mutable std::mutex stats_mutex_;
+  std::vector<detail::ShardStats> stats_;
+  std::atomic<float> beta_;
+  std::atomic<size_t> next_shard_{0};
+  // Guarded by stats_mutex_
+  std::mt19937 gen_;
+  // Declared last so it stops before the members it uses are destroyed
+  std::jthread refresher_;
+};
+}  // namespace replay_buffer
@@ -0,0 +1,365 @@
+#pragma once
+
+/// @file shared_prioritized_replay_buffer.h
+/// @brief Prioritized replay buffer living in POSIX shared memory.
+/// Several processes attach to one named segment and add, sample and update
+/// priorities concurrently. The segment holds a header with a process-shared
+/// robust mutex, the sum tree and the transition slots, so nothing in it
+/// points into any one process's address space.
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "replay_buffer/prioritized_replay_buffer.h"
+#include "replay_buffer/sum_tree.h"
+
+namespace replay_buffer {
+/// @brief Proportional prioritized replay buffer shared between processes.
+/// Writes are ordered so that a process killed while holding the lock never
+/// leaves a torn transition visible: an overwritten slot is dropped from the
+/// live range before it is copied into, and only added back once the copy is
+/// complete. The next process to lock the mutex after such a crash rebuilds
+/// the tree from the live slots (see recoveries()).
+/// @tparam T Trivially copyable transition type
+template <typename T>
+class SharedPrioritizedReplayBuffer {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Shared memory slots require a trivially copyable type");
+
+ public:
+  /// @brief Creates and initializes a new named segment. Fails if the name
+  /// already exists.
+  /// @param name POSIX shared memory name, e.g. "/replay_buffer"
+  static SharedPrioritizedReplayBuffer create(
+      const std::string& name, const PrioritizedReplayBufferConfig& config) {
+    if (config.capacity == 0) {
+      throw std::invalid_argument("Capacity must be greater than 0");
+    }
+    if (config.alpha < 0.0f || config.alpha > 1.0f) {
+      throw std::invalid_argument("Alpha must be between 0 and 1");
+    }
+    if (config.beta < 0.0f || config.beta > 1.0f) {
+      throw std::invalid_argument("Beta must be between 0 and 1");
+    }
+    if (config.epsilon < 0.0f) {
+      throw std::invalid_argument("Epsilon must be non-negative");
+    }
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+    const size_t bytes = segment_size(config.capacity);
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+      const int error = errno;
+      close(fd);
+      shm_unlink(name.c_str());
+      throw std::system_error(error, std::generic_category(), "ftruncate");
+    }
+    SharedPrioritizedReplayBuffer buffer(fd, bytes);
+    buffer.initialize(config);
+    return buffer;
+  }
+
+  /// @brief Attaches to a segment created by create() in any process.
+  static SharedPrioritizedReplayBuffer open(const std::string& name) {
+    const int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      const int error = errno;
+      close(fd);
+      throw std::system_error(error, std::generic_category(), "fstat");
+    }
+    SharedPrioritizedReplayBuffer buffer(fd, static_cast<size_t>(info.st_size));
+    if (buffer.header_->magic != kMagic ||
+        buffer.header_->element_size != sizeof(T) ||
+        segment_size(buffer.header_->capacity) > buffer.bytes_) {
+      throw std::runtime_error("Shared memory segment does not hold this type");
+    }
+    return buffer;
+  }
+
+  /// @brief Removes the name; attached processes keep their mapping.
+  static void unlink(const std::string& name) { shm_unlink(name.c_str()); }
+
+  SharedPrioritizedReplayBuffer(SharedPrioritizedReplayBuffer&& other) noexcept
+      : fd_(std::exchange(other.fd_, -1)),
+        bytes_(std::exchange(other.bytes_, 0)),
+        mapping_(std::exchange(other.mapping_, nullptr)),
+        header_(std::exchange(other.header_, nullptr)),
+        tree_(std::exchange(other.tree_, nullptr)),
+        slots_(std::exchange(other.slots_, nullptr)),
+        gen_(std::move(other.gen_)) {}
+
+  SharedPrioritizedReplayBuffer(const SharedPrioritizedReplayBuffer&) = delete;
+  SharedPrioritizedReplayBuffer& operator=(
+      const SharedPrioritizedReplayBuffer&) = delete;
+  SharedPrioritizedReplayBuffer& operator=(SharedPrioritizedReplayBuffer&&) =
+      delete;
+
+  ~SharedPrioritizedReplayBuffer() {
+    if (mapping_ != nullptr) {
+      munmap(mapping_, bytes_);
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  size_t capacity() const { return header_->capacity; }
+
+  size_t size() const {
+    Lock lock(*this);
+    return header_->size;
+  }
+
+  /// @brief Number of times a process found the lock held by a dead owner
+  /// and repaired the segment.
+  uint64_t recoveries() const {
+    Lock lock(*this);
+    return header_->recoveries;
+  }
+
+  size_t add(const T& item) {
+    Lock lock(*this);
+    Header& header = *header_;
+    const size_t stored_index = header.tail;
+    if (header.size == header.capacity) {
+      // Drop the oldest slot from the live range before overwriting it
+      detail::sum_tree_set(tree_, header.capacity, stored_index, 0.0f);
+      header.head = (header.head + 1) % header.capacity;
+      header.size--;
+    }
+    std::memcpy(static_cast<void*>(slots_ + stored_index), &item, sizeof(T));
+    detail::sum_tree_set(tree_, header.capacity, stored_index,
+                         header.max_priority);
+    header.tail = (header.tail + 1) % header.capacity;
+    header.size++;
+    return stored_index;
+  }
+
+  std::vector<PrioritizedSample<T>> sample(size_t batch_size) const {
+    Lock lock(*this);
+    const Header& header = *header_;
+    if (batch_size <= 0) {
+      throw std::invalid_argument("Batch size must be > 0");
+    }
+    if (header.size == 0) {
+      throw std::invalid_argument("Cannot sample from an empty buffer");
+    }
+    const float total = tree_[0];
+    if (!(total > 0.0f)) {
+      throw std::invalid_argument("Cannot sample with zero total priority");
+    }
+    std::vector<PrioritizedSample<T>> samples;
+    samples.reserve(batch_size);
+    std::uniform_real_distribution<float> dist(0.0f, total);
+    // The float distribution can return total itself, which would walk off
+    // the right edge onto an unwritten zero-priority leaf
+    const float max_value = std::nextafter(total, 0.0f);
+    for (size_t i = 0; i < batch_size; i++) {
+      const size_t index = detail::sum_tree_sample(
+          tree_, header.capacity, std::min(dist(gen_), max_value));
+      const float priority = tree_[header.capacity - 1 + index];
+      const float importance_sampling_weight =
+          std::pow(header.size * (priority / total), -header.beta);
+      PrioritizedSample<T> sample;
+      std::memcpy(static_cast<void*>(&sample.transition), slots_ + index,
+                  sizeof(T));
+      sample.weight = importance_sampling_weight;
+      sample.index = index;
+      samples.push_back(sample);
+    }
+    return samples;
+  }
+
+  void update_priorities(const std::vector<size_t>& indices,
+                         const std::vector<float>& td_errors) {
+    Lock lock(*this);
+    Header& header = *header_;
+    for (size_t i = 0; i < indices.size(); i++) {
+      if (indices[i] >= header.capacity) {
+        throw std::out_of_range("Index out of range");
+      }
+      // Slots outside the live range keep zero priority
+      if (!is_live(header, indices[i])) {
+        continue;
+      }
+      const float priority =
+          std::pow(std::abs(td_errors[i]) + header.epsilon, header.alpha);
+      detail::sum_tree_set(tree_, header.capacity, indices[i], priority);
+      if (header.max_priority < priority) {
+        header.max_priority = priority;
+      }
+    }
+  }
+
+  /// @brief Verifies the tree against the live slots: dead slots have zero
+  /// priority and the root matches the sum of the leaves.
+  bool is_consistent() const {
+    Lock lock(*this);
+    const Header& header = *header_;
+    double leaf_total = 0.0;
+    for (size_t slot = 0; slot < header.capacity; slot++) {
+      const float priority = tree_[header.capacity - 1 + slot];
+      if (!is_live(header, slot) && priority != 0.0f) {
+        return false;
+      }
+      leaf_total += priority;
+    }
+    return std::abs(leaf_total - tree_[0]) <= 1e-3 * (1.0 + leaf_total);
+  }
+
+ private:
+  static constexpr uint64_t kMagic = 0x5250524255464652ull;
+
+  struct Header {
+    uint64_t magic;
+    size_t element_size;
+    size_t capacity;
+    size_t size;
+    size_t head;
+    size_t tail;
+    float alpha;
+    float beta;
+    float epsilon;
+    float max_priority;
+    uint64_t recoveries;
+    pthread_mutex_t mutex;
+  };
+
+  static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  static size_t tree_offset() { return align_up(sizeof(Header), 64); }
+
+  static size_t slots_offset(size_t capacity) {
+    return align_up(tree_offset() + 2 * capacity * sizeof(float),
+                    std::max<size_t>(64, alignof(T)));
+  }
+
+  static size_t segment_size(size_t capacity) {
+    return slots_offset(capacity) + capacity * sizeof(T);
+  }
+
+  static bool is_live(const Header& header, size_t slot) {
+    const size_t offset =
+        (slot + header.capacity - header.head) % header.capacity;
+    return offset < header.size;
+  }
+
+  /// @brief Scoped owner of the segment mutex that repairs the segment when
+  /// the previous owner died holding it.
+  class Lock {
+   public:
+    explicit Lock(const SharedPrioritizedReplayBuffer& buffer)
+        : mutex_(&buffer.header_->mutex) {
+      const int result = pthread_mutex_lock(mutex_);
+#if defined(__linux__)
+      if (result == EOWNERDEAD) {
+        buffer.recover();
+        pthread_mutex_consistent(mutex_);
+        return;
+      }
+#endif
+      if (result != 0) {
+        throw std::system_error(result, std::generic_category(),
+                                "pthread_mutex_lock");
+      }
+    }
+    ~Lock() { pthread_mutex_unlock(mutex_); }
+    Lock(const Lock&) = delete;
+    Lock& operator=(const Lock&) = delete;
+
+   private:
+    pthread_mutex_t* mutex_;
+  };
+
+  SharedPrioritizedReplayBuffer(int fd, size_t bytes)
+      : fd_(fd), bytes_(bytes), gen_(std::random_device{}()) {
+    mapping_ =
+        mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+      mapping_ = nullptr;
+      throw std::system_error(errno, std::generic_category(), "mmap");
+    }
+    auto* base = static_cast<std::byte*>(mapping_);
+    header_ = reinterpret_cast<Header*>(base);
+    tree_ = reinterpret_cast<float*>(base + tree_offset());
+    if (bytes_ >= sizeof(Header)) {
+      slots_ = reinterpret_cast<T*>(base + slots_offset(header_->capacity));
+    }
+  }
+
+  void initialize(const PrioritizedReplayBufferConfig& config) {
+    // ftruncate zero-fills the segment, so the tree starts empty
+    header_ = new (mapping_) Header{};
+    header_->element_size = sizeof(T);
+    header_->capacity = config.capacity;
+    header_->alpha = config.alpha;
+    header_->beta = config.beta;
+    header_->epsilon = config.epsilon;
+    header_->max_priority = 1.0f;
+    slots_ = reinterpret_cast<T*>(static_cast<std::byte*>(mapping_) +
+                                  slots_offset(config.capacity));
+
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+#if defined(__linux__)
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+#endif
+    pthread_mutex_init(&header_->mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    // Publish the magic last so open() never sees a half-built header
+    __atomic_store_n(&header_->magic, kMagic, __ATOMIC_RELEASE);
+  }
+
+  /// @brief Called with the mutex held after its owner died. Slots outside
+  /// the live range lose their priority and internal sums are recomputed, so
+  /// any partially applied set() is discarded.
+  void recover() const {
+    Header& header = *header_;
+    // add() writes tail and size last, so they define the live range even if
+    // the owner died between updating head and size
+    header.head =
+        (header.tail + header.capacity - header.size) % header.capacity;
+    for (size_t slot = 0; slot < header.capacity; slot++) {
+      if (!is_live(header, slot)) {
+        tree_[header.capacity - 1 + slot] = 0.0f;
+      }
+    }
+    detail::sum_tree_rebuild(tree_, header.capacity);
+    header.recoveries++;
+  }
+
+  int fd_ = -1;
+  size_t bytes_ = 0;
+  void* mapping_ = nullptr;
+  Header* header_ = nullptr;
+  float* tree_ = nullptr;
+  T* slots_ = nullptr;
+  mutable std::mt19937 gen_;
+};
+}  // namespace replay_buffer
@@ -0,0 +1,309 @@
+#pragma once
+
+/// @file staging_buffer.h
+/// @brief Per-actor staging of transitions in front of a shared buffer.
+/// Each actor adds to its own Writer, which publishes to the buffer with one
+/// add_batch() per max_batch transitions instead of taking the buffer lock
+/// per transition. A background flusher bounds how long a staged transition
+/// can stay invisible to samplers.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace replay_buffer {
+struct StagingConfig {
+  /// A writer flushes as soon as it holds this many transitions
+  size_t max_batch = 256;
+  /// Longest a staged transition may wait before the background flusher
+  /// publishes it. 0 runs no flusher, leaving only full-batch and explicit
+  /// flushes.
+  std::chrono::microseconds max_delay{10000};
+};
+
+/// @brief Flushes by trigger and transitions published, since construction.
+/// Each flush is one acquisition of the buffer lock. size_flushes also
+/// counts flushes forced by switching between adds with and without TD
+/// errors.
+struct StagingStats {
+  uint64_t items = 0;
+  uint64_t size_flushes = 0;
+  uint64_t timed_flushes = 0;
+  uint64_t explicit_flushes = 0;
+};
+
+/// @brief A CircularBuffer or PrioritizedReplayBuffer fed through per-actor
+/// Writers. Sample from buffer() as usual; a transition becomes visible
+/// there when its writer flushes, i.e. once max_batch are staged, on
+/// Writer::flush() or flush(), when the writer is destroyed, or at most
+/// about max_delay after it was staged. Transitions of one writer reach the
+/// buffer in the order they were added.
+/// @tparam Buffer CircularBuffer<T> or PrioritizedReplayBuffer<T>
+template <typename Buffer>
+class StagedReplayBuffer {
+ public:
+  using value_type = typename Buffer::value_type;
+
+ private:
+  struct Stage;
+
+  /// Whether Buffer takes TD errors with a batch
+  static constexpr bool kPrioritized =
+      requires(Buffer& buffer, std::span<const value_type> items,
+               std::span<const float> td_errors) {
+        buffer.add_batch(items, td_errors);
+      };
+
+  enum class Trigger { kSize, kTimed, kExplicit };
+
+ public:
+  /// @brief One actor's staging area. Not thread-safe itself: use one per
+  /// actor thread. Must not outlive the StagedReplayBuffer that made it.
+  class Writer {
+   public:
+    Writer(Writer&& other) noexcept
+        : owner_(other.owner_), stage_(std::move(other.stage_)) {}
+    Writer& operator=(Writer&&) = delete;
+
+    /// @brief Flushes what is still staged and unregisters. If the buffer
+    /// throws, the items stay staged with the owner instead: the background
+    /// flusher retries them, and StagedReplayBuffer::flush() surfaces the
+    /// error.
+    ~Writer() {
+      if (stage_ == nullptr) {
+        return;
+      }
+      try {
+        flush();
+      } catch (const std::exception&) {
+        return;
+      }
+      owner_->unregister_stage(stage_);
+    }
+
+    void add(const value_type& item) { stage(item); }
+    void add(value_type&& item) { stage(std::move(item)); }
+
+    /// @brief Stages item with a caller-computed TD error, published through
+    /// add_batch(items, td_errors). Adding items with and without TD errors
+    /// alternately flushes at every switch.
+    void add(const value_type& item, float td_error)
+      requires kPrioritized
+    {
+      std::lock_guard<std::mutex> lock(stage_->mutex);
+      if (!stage_->items.empty() && stage_->td_errors.empty()) {
+        owner_->flush_stage(*stage_, Trigger::kSize);
+      }
+      begin_staging();
+      stage_->items.push_back(item);
+      stage_->td_errors.push_back(td_error);
+      flush_if_full();
+    }
+
+    /// @brief Publishes everything staged so far.
+    void flush() {
+      std::lock_guard<std::mutex> lock(stage_->mutex);
+      owner_->flush_stage(*stage_, Trigger::kExplicit);
+    }
+
+    /// @brief Transitions staged and not yet published.
+    size_t staged() const {
+      std::lock_guard<std::mutex> lock(stage_->mutex);
+      return stage_->items.size();
+    }
+
+   private:
+    friend class StagedReplayBuffer;
+
+    Writer(StagedReplayBuffer* owner, std::shared_ptr<Stage> stage)
+        : owner_(owner), stage_(std::move(stage)) {}
+
+    template <typename U>
+    void stage(U&& item) {
+      std::lock_guard<std::mutex> lock(stage_->mutex);
+      if (!stage_->td_errors.empty()) {
+        owner_->flush_stage(*stage_, Trigger::kSize);
+      }
+      begin_staging();
+      stage_->items.push_back(std::forward<U>(item));
+      flush_if_full();
+    }
+
+    // Both called with the stage locked
+    void begin_staging() {
+      if (stage_->items.empty()) {
+        stage_->oldest = std::chrono::steady_clock::now();
+      }
+    }
+
+    void flush_if_full() {
+      if (stage_->items.size() >= owner_->config_.max_batch) {
+        owner_->flush_stage(*stage_, Trigger::kSize);
+      }
+    }
+
+    StagedReplayBuffer* owner_;
+    std::shared_ptr<Stage> stage_;
+  };
+
+  /// @param args Forwarded to the Buffer constructor
+  /// @throws std::invalid_argument if max_batch is 0 or max_delay negative
+  template <typename... Args>
+  explicit StagedReplayBuffer(const StagingConfig& config, Args&&... args)
+      : config_(config), buffer_(std::forward<Args>(args)...) {
+    if (config.max_batch == 0) {
+      throw std::invalid_argument("Max batch must be > 0");
+    }
+    if (config.max_delay.count() < 0) {
+      throw std::invalid_argument("Max delay must be >= 0");
+    }
+    if (config.max_delay.count() > 0) {
+      flusher_ = std::jthread(
+          [this](std::stop_token stop) { flush_loop(std::move(stop)); });
+    }
+  }
+
+  StagedReplayBuffer(const StagedReplayBuffer&) = delete;
+  StagedReplayBuffer& operator=(const StagedReplayBuffer&) = delete;
+
+  /// @brief The shared buffer. Adds made on it directly skip staging.
+  Buffer& buffer() { return buffer_; }
+  const Buffer& buffer() const { return buffer_; }
+
+  const StagingConfig& config() const { return config_; }
+
+  /// @brief A new staging area for one actor.
+  Writer writer() {
+    auto stage = std::make_shared<Stage>();
+    stage->items.reserve(config_.max_batch);
+    std::lock_guard<std::mutex> lock(stages_mutex_);
+    stages_.push_back(stage);
+    return Writer(this, std::move(stage));
+  }
+
+  /// @brief Publishes what every writer has staged so far, including items
+  /// left behind by writers destroyed while the buffer was failing.
+  void flush() {
+    for (const std::shared_ptr<Stage>& stage : snapshot_stages()) {
+      std::lock_guard<std::mutex> lock(stage->mutex);
+      flush_stage(*stage, Trigger::kExplicit);
+    }
+  }
+
+  StagingStats stats() const {
+    StagingStats stats;
+    stats.items = items_.load(std::memory_order_relaxed);
+    stats.size_flushes = size_flushes_.load(std::memory_order_relaxed);
+    stats.timed_flushes = timed_flushes_.load(std::memory_order_relaxed);
+    stats.explicit_flushes =
+        explicit_flushes_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  struct Stage {
+    std::mutex mutex;
+    std::vector<value_type> items;
+    // Empty, or one per item when the items were added with TD errors
+    std::vector<float> td_errors;
+    // When the first of the staged items was added
+    std::chrono::steady_clock::time_point oldest;
+  };
+
+  /// @brief Publishes stage with one add_batch(). Caller holds its mutex.
+  /// Items stay staged if the buffer throws.
+  void flush_stage(Stage& stage, Trigger trigger) {
+    if (stage.items.empty()) {
+      return;
+    }
+    const std::span<const value_type> items(stage.items);
+    if constexpr (kPrioritized) {
+      if (!stage.td_errors.empty()) {
+        buffer_.add_batch(items, std::span<const float>(stage.td_errors));
+      } else {
+        buffer_.add_batch(items);
+      }
+    } else {
+      buffer_.add_batch(items);
+    }
+    items_.fetch_add(stage.items.size(), std::memory_order_relaxed);
+    switch (trigger) {
+      case Trigger::kSize:
+        size_flushes_.fetch_add(1, std::memory_order_relaxed);
+        break;
+      case Trigger::kTimed:
+        timed_flushes_.fetch_add(1, std::memory_order_relaxed);
+        break;
+      case Trigger::kExplicit:
+        explicit_flushes_.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+    stage.items.clear();
+    stage.td_errors.clear();
+  }
+
+  std::vector<std::shared_ptr<Stage>> snapshot_stages() const {
+    std::lock_guard<std::mutex> lock(stages_mutex_);
+    return stages_;
+  }
+
+  void unregister_stage(const std::shared_ptr<Stage>& stage) {
+    std::lock_guard<std::mutex> lock(stages_mutex_);
+    std::erase(stages_, stage);
+  }
+
+  /// @brief Every max_delay / 2, flushes the stages holding a transition
+  /// at least that old. A transition staged just after one pass is at most
+  /// max_delay / 2 old at the next and is flushed by the one after, so it
+  /// waits at most about max_delay.
+  void flush_loop(std::stop_token stop) {
+    const auto interval =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            config_.max_delay) /
+        2;
+    std::mutex mutex;
+    std::condition_variable_any wake;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      wake.wait_for(lock, stop, interval, [] { return false; });
+      if (stop.stop_requested()) {
+        return;
+      }
+      const auto now = std::chrono::steady_clock::now();
+      for (const std::shared_ptr<Stage>& stage : snapshot_stages()) {
+        std::lock_guard<std::mutex> stage_lock(stage->mutex);
+        if (!stage->items.empty() && now - stage->oldest >= interval) {
+          try {
+            flush_stage(*stage, Trigger::kTimed);
+          } catch (const std::exception&) {
+            // Keep the items staged; the writer's next flush surfaces the
+            // failure to the actor
+          }
+        }
+      }
+    }
+  }
+
+  StagingConfig config_;
+  Buffer buffer_;
+  mutable std::mutex stages_mutex_;
+  std::vector<std::shared_ptr<Stage>> stages_;
+  std::atomic<uint64_t> items_{0};
+  std::atomic<uint64_t> size_flushes_{0};
+  std::atomic<uint64_t> timed_flushes_{0};
+  std::atomic<uint64_t> explicit_flushes_{0};
+  // Declared last so it stops before the members it uses are destroyed
+  std::jthread flusher_;
+};
+}  // namespace replay_buffer
@@ -0,0 +1,166 @@
+#pragma once
+
+/// @file static_circular_buffer.h
+/// @brief Circular buffer whose capacity is a template parameter. Slot
+/// arithmetic folds to a bit mask when the capacity is a power of two (and
+/// to a multiply by a constant otherwise), and the elements live inline in
+/// a std::array instead of behind a pointer.
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "replay_buffer/circular_buffer.h"
+
+namespace replay_buffer {
+/// @brief FIFO CircularBuffer with a compile-time capacity, for callers that
+/// know their capacity when they build. Same locking and overwrite
+/// semantics as CircularBuffer with RetentionPolicy::kFifo; there is no
+/// reservoir retention, lock-free load() or metrics.
+/// The elements are stored inline, so large instances belong on the heap
+/// (e.g. std::make_unique) rather than on the stack.
+/// @tparam T Type of elements stored in the buffer
+/// @tparam N Capacity; powers of two replace every modulo with a mask
+template <typename T, size_t N>
+class StaticCircularBuffer {
+  static_assert(N > 0, "Capacity must be greater than 0");
+
+ public:
+  static constexpr bool kPowerOfTwo = std::has_single_bit(N);
+
+  static constexpr size_t capacity() { return N; }
+
+  size_t size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return size_;
+  }
+
+  bool is_full() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return size_ == N;
+  }
+
+  bool is_empty() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return size_ == 0;
+  }
+
+  /// @return Physical slot the item was stored in
+  size_t add(const T& item) { return store(item); }
+
+  size_t add(T&& item) { return store(std::move(item)); }
+
+  /// @brief Adds items in order under a single lock, as CircularBuffer::
+  /// add_batch() does: at most two contiguous copies, and only the last N
+  /// items are stored if there are more.
+  IndexRange add_batch(std::span<const T> items) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    const size_t stored = std::min(items.size(), N);
+    writes_ += items.size() - stored;
+    const size_t first_slot = slot(writes_);
+    const size_t before_seam = std::min(stored, N - first_slot);
+    const auto first = items.end() - static_cast<std::ptrdiff_t>(stored);
+    std::copy_n(first, before_seam, buffer_.begin() + first_slot);
+    std::copy_n(first + static_cast<std::ptrdiff_t>(before_seam),
+                stored - before_seam, buffer_.begin());
+    writes_ += stored;
+    size_ = std::min(size_ + items.size(), N);
+    return {first_slot, stored};
+  }
+
+  /// @brief Removes all elements. The next add() continues at the current
+  /// tail slot.
+  void clear() {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    size_ = 0;
+  }
+
+  T& operator[](size_t index) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    return buffer_[logical_slot(index)];
+  }
+
+  const T& operator[](size_t index) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return buffer_[logical_slot(index)];
+  }
+
+  T& at(size_t index) { return (*this)[index]; }
+
+  const T& at(size_t index) const { return (*this)[index]; }
+
+  /// @brief Samples batch_size elements uniformly with replacement. A full
+  /// power-of-two buffer masks raw generator output instead of going
+  /// through uniform_int_distribution's range reduction.
+  std::vector<T> sample(size_t batch_size) const {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    if (batch_size == 0) {
+      throw std::invalid_argument("Batch size must be > 0");
+    }
+    if (batch_size > size_) {
+      throw std::invalid_argument("Batch size exceeds buffer size");
+    }
+
+    std::vector<T> result;
+    result.reserve(batch_size);
+    if constexpr (kPowerOfTwo && N - 1 <= std::mt19937::max()) {
+      if (size_ == N) {
+        // Every slot is live, so the logical offset does not matter
+        for (size_t i = 0; i < batch_size; i++) {
+          result.push_back(buffer_[gen_() & (N - 1)]);
+        }
+        return result;
+      }
+    }
+    const uint64_t head = writes_ - size_;
+    std::uniform_int_distribution<size_t> dist(0, size_ - 1);
+    for (size_t i = 0; i < batch_size; i++) {
+      result.push_back(buffer_[slot(head + dist(gen_))]);
+    }
+    return result;
+  }
+
+ private:
+  static constexpr size_t slot(uint64_t write) {
+    if constexpr (kPowerOfTwo) {
+      return static_cast<size_t>(write & (N - 1));
+    } else {
+      return static_cast<size_t>(write % N);
+    }
+  }
+
+  template <typename U>
+  size_t store(U&& item) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    const size_t stored_index = slot(writes_);
+    buffer_[stored_index] = std::forward<U>(item);
+    writes_++;
+    size_ = std::min(size_ + 1, N);
+    return stored_index;
+  }
+
+  size_t logical_slot(size_t index) const {
+    if (index >= size_) {
+      throw std::out_of_range("Index out of range");
+    }
+    return slot(writes_ - size_ + index);
+  }
+
+  std::array<T, N> buffer_{};
+  size_t size_ = 0;
+  // Total number of items ever added: the tail is slot(writes_) and the
+  // head slot(writes_ - size_), so neither needs wrapping on its own
+  uint64_t writes_ = 0;
+  mutable std::shared_mutex mutex_;
+  mutable std::mt19937 gen_{std::random_device{}()};
+};
+}  // namespace replay_buffer
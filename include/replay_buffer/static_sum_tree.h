@@ -0,0 +1,126 @@
+#pragma once
+
+/// @file static_sum_tree.h
+/// @brief Sum tree whose capacity is a template parameter. The leaf count is
+/// rounded up to a power of two, so every leaf sits at the same depth and
+/// set() and sample() walk a fixed number of levels, which the compiler
+/// unrolls completely.
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#include "replay_buffer/sum_tree.h"
+
+namespace replay_buffer {
+/// @brief SumTree with a compile-time capacity, stored inline. Same
+/// interface and error handling as SumTree.
+/// Uses a 1-indexed heap rather than SumTree's 0-indexed one: the root is
+/// node 1, the children of node i are 2i and 2i + 1, and leaf i is node
+/// kLeaves + i. Leaves from N to kLeaves - 1 are padding and stay 0.
+/// Not thread-safe, like SumTree.
+/// @tparam N Capacity (number of usable leaves)
+template <size_t N>
+class StaticSumTree {
+  static_assert(N > 0, "Capacity must be greater than 0");
+
+ public:
+  static constexpr size_t kLeaves = std::bit_ceil(N);
+  static constexpr size_t kDepth = std::countr_zero(kLeaves);
+
+  static constexpr size_t capacity() { return N; }
+
+  void set(size_t index, float priority) {
+    if (index >= N) {
+      throw std::out_of_range("Index out of range");
+    }
+    size_t node = kLeaves + index;
+    tree_[node] = priority;
+    // Recompute each ancestor from its children rather than propagating a
+    // delta, as SumTree does, so rounding does not accumulate in the root
+    for_each_level([&]() {
+      node >>= 1;
+      tree_[node] = tree_[2 * node] + tree_[2 * node + 1];
+    });
+  }
+
+  /// @brief Sets a contiguous run of leaves starting at first, updating the
+  /// internal nodes one level at a time.
+  void set_range(size_t first, std::span<const float> priorities) {
+    if (first > N || priorities.size() > N - first) {
+      throw std::out_of_range("Index out of range");
+    }
+    if (priorities.empty()) {
+      return;
+    }
+    size_t low = kLeaves + first;
+    size_t high = low + priorities.size() - 1;
+    std::copy(priorities.begin(), priorities.end(), tree_.begin() + low);
+    // All leaves share a depth, so each level's range is [low/2, high/2]
+    for_each_level([&]() {
+      low >>= 1;
+      high >>= 1;
+      detail::sum_tree_reduce_pairs(tree_.data() + 2 * low,
+                                    tree_.data() + low, high - low + 1);
+    });
+  }
+
+  /// @brief Replaces every leaf and rebuilds the internal nodes in O(n).
+  /// Leaves past priorities.size() are set to 0.
+  void build(std::span<const float> priorities) {
+    if (priorities.size() > N) {
+      throw std::invalid_argument("More priorities than capacity");
+    }
+    float* leaves = tree_.data() + kLeaves;
+    std::copy(priorities.begin(), priorities.end(), leaves);
+    std::fill(leaves + priorities.size(), leaves + N, 0.0f);
+    // Level d is nodes [2^d, 2^(d+1)), whose children are contiguous
+    for (size_t first = kLeaves / 2; first > 0; first /= 2) {
+      detail::sum_tree_reduce_pairs(tree_.data() + 2 * first,
+                                    tree_.data() + first, first);
+    }
+  }
+
+  float get(size_t index) const {
+    if (index >= N) {
+      throw std::out_of_range("Index out of range");
+    }
+    return tree_[kLeaves + index];
+  }
+
+  float total() const { return tree_[1]; }
+
+  size_t sample(float value) const {
+    if (value < 0 || value > tree_[1]) {
+      throw std::out_of_range("Sample value out of range [0, total]");
+    }
+    size_t node = 1;
+    for_each_level([&]() {
+      node *= 2;
+      if (value >= tree_[node]) {
+        // subtract the left child from the value and go right
+        value -= tree_[node];
+        node++;
+      }
+    });
+    // value == total (or rounding close to it) can walk into the padding
+    return std::min(node - kLeaves, N - 1);
+  }
+
+ private:
+  /// @brief Calls step kDepth times, unrolled at compile time.
+  template <typename F>
+  static void for_each_level(F&& step) {
+    [&]<size_t... Level>(std::index_sequence<Level...>) {
+      ((static_cast<void>(Level), step()), ...);
+    }(std::make_index_sequence<kDepth>{});
+  }
+
+  // Node 0 is unused so that the root is node 1
+  std::array<float, 2 * kLeaves> tree_{};
+};
+}  // namespace replay_buffer
@@ -2,12 +2,161 @@
 
 /// @file sum_tree.h
 /// @brief Sum-tree data structure for efficient proportional sampling.
-///
+/// Bulk rebuilds reduce each level with AVX2, SSE2 or NEON when the compiler
+/// targets them, and split large levels across threads.
 
+#include <algorithm>
+#include <cstddef>
+#include <span>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
+#include "replay_buffer/trace.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace replay_buffer {
+namespace detail {
+/// @brief Sum-tree walks over a caller-owned node array, shared by SumTree and
+/// buffers that keep their tree elsewhere (e.g. in shared memory). The array
+/// uses the layout documented on SumTree and holds at least 2 * capacity - 1
+/// nodes. No bounds checking.
+inline void sum_tree_set(float* tree, size_t capacity, size_t index,
+                         float priority) {
+  size_t tree_index = capacity - 1 + index;
+  tree[tree_index] = priority;
+  // start at the leaf and walk back up the parents, recomputing each sum from
+  // its children. Propagating a delta instead lets float rounding accumulate
+  // in the root over millions of updates.
+  while (tree_index > 0) {
+    tree_index = (tree_index - 1) / 2;
+    tree[tree_index] = tree[2 * tree_index + 1] + tree[2 * tree_index + 2];
+  }
+}
+
+/// @brief Sets leaves first .. first + priorities.size() - 1 and updates
+/// their ancestors in one bottom-up pass: each step recomputes the
+/// contiguous range of parents of the previous step, so shared ancestors are
+/// summed once per level instead of once per leaf.
+inline void sum_tree_set_range(float* tree, size_t capacity, size_t first,
+                               std::span<const float> priorities) {
+  if (priorities.empty()) {
+    return;
+  }
+  size_t low = capacity - 1 + first;
+  size_t high = low + priorities.size() - 1;
+  std::copy(priorities.begin(), priorities.end(), tree + low);
+  // With a capacity that is not a power of two a range can span two depths,
+  // so walk each range downwards: children always come before parents.
+  while (high > 0) {
+    low = low == 0 ? 0 : (low - 1) / 2;
+    high = (high - 1) / 2;
+    for (size_t i = high + 1; i-- > low;) {
+      tree[i] = tree[2 * i + 1] + tree[2 * i + 2];
+    }
+  }
+}
+
+inline size_t sum_tree_sample(const float* tree, size_t capacity,
+                              float value) {
+  size_t index = 0;
+  while (index < capacity - 1) {
+    if (value < tree[2 * index + 1]) {
+      // go left
+      index = 2 * index + 1;
+    } else {
+      // subtract the left child from the value and go right
+      value -= tree[2 * index + 1];
+      index = 2 * index + 2;
+    }
+  }
+  return index - capacity + 1;
+}
+
+/// @brief parents[j] = children[2 * j] + children[2 * j + 1] for
+/// j < count, using the widest available SIMD path. The children of a
+/// contiguous run of nodes on one level are themselves contiguous.
+inline void sum_tree_reduce_pairs(const float* children, float* parents,
+                                  size_t count) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 8 <= count; i += 8) {
+    const __m256 low = _mm256_loadu_ps(children + 2 * i);
+    const __m256 high = _mm256_loadu_ps(children + 2 * i + 8);
+    // hadd works within 128-bit lanes: reorder lanes back to 0, 1, 2, 3
+    const __m256 sums = _mm256_hadd_ps(low, high);
+    _mm256_storeu_ps(parents + i,
+                     _mm256_castpd_ps(_mm256_permute4x64_pd(
+                         _mm256_castps_pd(sums), _MM_SHUFFLE(3, 1, 2, 0))));
+  }
+#elif defined(__SSE2__)
+  for (; i + 4 <= count; i += 4) {
+    const __m128 low = _mm_loadu_ps(children + 2 * i);
+    const __m128 high = _mm_loadu_ps(children + 2 * i + 4);
+    const __m128 even = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+    const __m128 odd = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+    _mm_storeu_ps(parents + i, _mm_add_ps(even, odd));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (; i + 4 <= count; i += 4) {
+    vst1q_f32(parents + i, vpaddq_f32(vld1q_f32(children + 2 * i),
+                                      vld1q_f32(children + 2 * i + 4)));
+  }
+#endif
+  for (; i < count; i++) {
+    parents[i] = children[2 * i] + children[2 * i + 1];
+  }
+}
+
+// Each rebuild thread reduces at least this many nodes of a level; for
+// fewer, starting a thread costs more than the adds it takes over.
+inline constexpr size_t kSumTreeMinNodesPerThread = size_t{1} << 16;
+
+/// @brief Recomputes every internal node from the leaves in O(n), level by
+/// level from the bottom, discarding any partially propagated deltas.
+inline void sum_tree_rebuild(float* tree, size_t capacity) {
+  if (capacity < 2) {
+    return;
+  }
+  // Internal nodes are 0 .. capacity - 2; level d starts at node 2^d - 1
+  size_t level_first = 0;
+  while (2 * level_first + 1 <= capacity - 2) {
+    level_first = 2 * level_first + 1;
+  }
+  const size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t level_last = capacity - 2;
+  while (true) {
+    const size_t count = level_last - level_first + 1;
+    float* parents = tree + level_first;
+    const float* children = tree + 2 * level_first + 1;
+    const size_t threads =
+        std::min(max_threads, count / kSumTreeMinNodesPerThread);
+    if (threads > 1) {
+      const size_t chunk = (count + threads - 1) / threads;
+      std::vector<std::jthread> workers;
+      for (size_t first = 0; first < count; first += chunk) {
+        workers.emplace_back([=]() {
+          sum_tree_reduce_pairs(children + 2 * first, parents + first,
+                                std::min(chunk, count - first));
+        });
+      }
+    } else {
+      sum_tree_reduce_pairs(children, parents, count);
+    }
+    if (level_first == 0) {
+      break;
+    }
+    level_last = level_first - 1;
+    level_first = (level_first - 1) / 2;
+  }
+}
+}  // namespace detail
+
 class SumTree {
   /// @brief Sum tree implementation using 0-indexed convention for array-heap
   /// arithmetic. There are ~2N nodes in total. N leaf nodes and N-1 internal
@@ -27,20 +176,37 @@ class SumTree {
 
   size_t capacity() const { return capacity_; }
 
+  /// @brief Sets a leaf and recomputes its ancestors from their children, so
+  /// the total depends only on the current leaves, never on the order or
+  /// number of earlier updates.
   void set(size_t index, float priority) {
+    TraceSpan span("SumTree::set");
     if (index >= capacity_) {
       throw std::out_of_range("Index out of range");
     }
-    const float existing_priority = tree_[capacity_ - 1 + index];
-    const float priority_delta = priority - existing_priority;
-    tree_[capacity_ - 1 + index] = priority;
-    // start at the leaf and walk back up the parents and update the priority
-    // sum by the delta
-    size_t tree_index = capacity_ - 1 + index;
-    while (tree_index > 0) {
-      tree_index = (tree_index - 1) / 2;
-      tree_[tree_index] += priority_delta;
+    detail::sum_tree_set(tree_.data(), capacity_, index, priority);
+  }
+
+  /// @brief Sets a contiguous run of leaves starting at first, updating the
+  /// internal nodes in a single coalesced pass.
+  void set_range(size_t first, std::span<const float> priorities) {
+    if (first > capacity_ || priorities.size() > capacity_ - first) {
+      throw std::out_of_range("Index out of range");
+    }
+    detail::sum_tree_set_range(tree_.data(), capacity_, first, priorities);
+  }
+
+  /// @brief Replaces every leaf, e.g. when restoring from a checkpoint, and
+  /// rebuilds the internal nodes in O(n) instead of a root walk per leaf.
+  /// Leaves past priorities.size() are set to 0.
+  void build(std::span<const float> priorities) {
+    if (priorities.size() > capacity_) {
+      throw std::invalid_argument("More priorities than capacity");
     }
+    float* leaves = tree_.data() + capacity_ - 1;
+    std::copy(priorities.begin(), priorities.end(), leaves);
+    std::fill(leaves + priorities.size(), leaves + capacity_, 0.0f);
+    detail::sum_tree_rebuild(tree_.data(), capacity_);
   }
 
   float get(size_t index) const {
@@ -53,21 +219,11 @@ class SumTree {
   float total() const { return tree_[0]; }
 
   size_t sample(float value) const {
+    TraceSpan span("SumTree::sample");
     if (value < 0 || value > tree_[0]) {
       throw std::out_of_range("Sample value out of range [0, total]");
     }
-    size_t index = 0;
-    while (index < capacity_ - 1) {
-      if (value < tree_[2 * index + 1]) {
-        // go left
-        index = 2 * index + 1;
-      } else {
-        // subtract the left child from the value and go right
-        value -= tree_[2 * index + 1];
-        index = 2 * index + 2;
-      }
-    }
-    return index - capacity_ + 1;
+    return detail::sum_tree_sample(tree_.data(), capacity_, value);
   }
 
  private:
@@ -0,0 +1,263 @@
+#pragma once
+
+/// @file task.h
+/// @brief Minimal C++20 coroutine support for the async buffer API: a lazy
+/// Task<R>, an Executor that resumes coroutines on a few threads, and
+/// sync_wait() for calling async code from ordinary threads.
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace replay_buffer {
+template <typename R>
+class Task;
+
+namespace detail {
+/// @brief Resumes whoever awaited the task once it finishes. Symmetric
+/// transfer keeps long chains of awaits from growing the stack.
+struct TaskFinalAwaiter {
+  bool await_ready() const noexcept { return false; }
+
+  template <typename Promise>
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<Promise> handle) const noexcept {
+    const std::coroutine_handle<> continuation =
+        handle.promise().continuation;
+    return continuation ? continuation : std::noop_coroutine();
+  }
+
+  void await_resume() const noexcept {}
+};
+
+struct TaskPromiseBase {
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  TaskFinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() { error = std::current_exception(); }
+
+  std::coroutine_handle<> continuation;
+  std::exception_ptr error;
+};
+
+template <typename R>
+struct TaskPromise : TaskPromiseBase {
+  Task<R> get_return_object();
+
+  template <typename V>
+  void return_value(V&& value) {
+    result.emplace(std::forward<V>(value));
+  }
+
+  R take() {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return std::move(*result);
+  }
+
+  std::optional<R> result;
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+  Task<void> get_return_object();
+  void return_void() const noexcept {}
+
+  void take() const {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+};
+}  // namespace detail
+
+/// @brief Lazily started coroutine producing an R. Nothing runs until the
+/// task is awaited (or handed to Executor::spawn() or sync_wait()), and it
+/// then runs on the awaiting thread until it first suspends. Exceptions
+/// propagate to the awaiter. Move-only; owns its coroutine frame.
+template <typename R = void>
+class [[nodiscard]] Task {
+ public:
+  using promise_type = detail::TaskPromise<R>;
+
+  explicit Task(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<> awaiter) noexcept {
+    handle_.promise().continuation = awaiter;
+    return handle_;
+  }
+
+  R await_resume() { return handle_.promise().take(); }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+template <typename R>
+Task<R> TaskPromise<R>::get_return_object() {
+  return Task<R>(std::coroutine_handle<TaskPromise<R>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+  return Task<void>(
+      std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/// @brief Fire-and-forget coroutine that frees its own frame on completion.
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() {
+      return {std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    // Like an exception escaping a std::thread
+    void unhandled_exception() const noexcept { std::terminate(); }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+}  // namespace detail
+
+/// @brief Resumes coroutines on a fixed set of threads, in FIFO order. One
+/// thread can multiplex any number of coroutines that spend their time
+/// suspended, e.g. actors waiting on a buffer.
+/// Coroutines still suspended when the executor is destroyed are never
+/// resumed; callers must let their tasks finish (or close the buffers they
+/// wait on) first.
+class Executor {
+ public:
+  explicit Executor(size_t threads = 1) {
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+      threads_.emplace_back([this]() { work(); });
+    }
+  }
+
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+  ~Executor() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  size_t size() const { return threads_.size(); }
+
+  /// @brief Queues a suspended coroutine to be resumed on an executor
+  /// thread.
+  void post(std::coroutine_handle<> handle) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ready_.push_back(handle);
+    }
+    wake_.notify_one();
+  }
+
+  /// @brief Awaitable that moves the awaiting coroutine onto this
+  /// executor.
+  auto schedule() {
+    struct Awaiter {
+      Executor& executor;
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> handle) const {
+        executor.post(handle);
+      }
+      void await_resume() const noexcept {}
+    };
+    return Awaiter{*this};
+  }
+
+  /// @brief Starts task on this executor and lets it run to completion on
+  /// its own. An exception escaping the task terminates the program.
+  void spawn(Task<void> task) { post(run_detached(std::move(task)).handle); }
+
+ private:
+  static detail::DetachedTask run_detached(Task<void> task) { co_await task; }
+
+  void work() {
+    while (true) {
+      std::coroutine_handle<> handle;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this]() { return stopping_ || !ready_.empty(); });
+        if (ready_.empty()) {
+          return;
+        }
+        handle = ready_.front();
+        ready_.pop_front();
+      }
+      handle.resume();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::coroutine_handle<>> ready_;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+/// @brief Runs task on executor and blocks the calling thread until it
+/// finishes, returning its result or rethrowing its exception. Must not be
+/// called from one of executor's own threads.
+template <typename R>
+R sync_wait(Executor& executor, Task<R> task) {
+  std::promise<R> result;
+  std::future<R> future = result.get_future();
+  // Both are moved into the coroutine frame, which outlives this call's
+  // interest in them
+  executor.spawn([](Task<R> task, std::promise<R> result) -> Task<void> {
+    try {
+      if constexpr (std::is_void_v<R>) {
+        co_await task;
+        result.set_value();
+      } else {
+        result.set_value(co_await task);
+      }
+    } catch (...) {
+      result.set_exception(std::current_exception());
+    }
+  }(std::move(task), std::move(result)));
+  return future.get();
+}
+}  // namespace replay_buffer
@@ -0,0 +1,136 @@
+#pragma once
+
+/// @file thread_pool.h
+/// @brief Fixed-size worker pool for splitting one large operation, such as
+/// a big sampled batch, across threads.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace replay_buffer {
+/// @brief Pool of worker threads that run the tasks of parallel_for(). The
+/// calling thread takes part too, so a pool of n workers runs up to n + 1
+/// tasks at once, and a pool of 0 workers runs everything inline.
+/// Several threads may call parallel_for() on the same pool concurrently.
+class ThreadPool {
+ public:
+  explicit ThreadPool(
+      size_t threads = std::max(1u, std::thread::hardware_concurrency()) - 1) {
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+      workers_.emplace_back([this]() { work(); });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  /// @brief Number of worker threads, not counting callers.
+  size_t size() const { return workers_.size(); }
+
+  /// @brief How many tasks to split items into so each gets at least
+  /// min_items_per_task, without exceeding the threads available.
+  size_t task_count(size_t items, size_t min_items_per_task) const {
+    return std::clamp<size_t>(items / min_items_per_task, 1, size() + 1);
+  }
+
+  /// @brief Calls fn(task) for every task in [0, tasks) and returns once all
+  /// have finished. Tasks are claimed dynamically, so uneven tasks balance.
+  /// If any call throws, the first exception is rethrown here after the
+  /// rest have finished.
+  template <typename F>
+  void parallel_for(size_t tasks, F&& fn) {
+    if (tasks == 0) {
+      return;
+    }
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex done_mutex;
+    std::condition_variable done;
+    size_t running = 0;
+    auto run = [&]() {
+      for (size_t task = next.fetch_add(1); task < tasks;
+           task = next.fetch_add(1)) {
+        try {
+          fn(task);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(done_mutex);
+          if (!error) {
+            error = std::current_exception();
+          }
+        }
+      }
+    };
+
+    // Helpers reference this frame, so wait for every one to leave run(),
+    // not just for the tasks to be claimed
+    const size_t helpers = std::min(size(), tasks - 1);
+    running = helpers;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t i = 0; i < helpers; i++) {
+        queue_.push([&]() {
+          run();
+          std::lock_guard<std::mutex> done_lock(done_mutex);
+          if (--running == 0) {
+            done.notify_one();
+          }
+        });
+      }
+    }
+    if (helpers == 1) {
+      wake_.notify_one();
+    } else if (helpers > 1) {
+      wake_.notify_all();
+    }
+    run();
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done.wait(lock, [&]() { return running == 0; });
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+ private:
+  void work() {
+    while (true) {
+      std::function<void()> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        job = std::move(queue_.front());
+        queue_.pop();
+      }
+      job();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::queue<std::function<void()>> queue_;
+  bool stopping_ = false;
+};
+}  // namespace replay_buffer
@@ -0,0 +1,274 @@
+#pragma once
+
+/// @file trace.h
+/// @brief Optional span tracing of the buffers' hot paths, dumped as Chrome
+/// trace JSON (chrome://tracing, Perfetto). Spans split an operation into
+/// lock waits, tree walks and copies, which latency histograms cannot.
+/// Tracing is compiled in only when REPLAY_BUFFER_ENABLE_TRACING is defined
+/// (CMake option of the same name), and records only while switched on with
+/// set_tracing_enabled(true). Compiled in but switched off, a span costs one
+/// relaxed load; compiled out, TraceSpan is an empty type.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+namespace replay_buffer {
+
+#if defined(REPLAY_BUFFER_ENABLE_TRACING)
+inline constexpr bool kTracingEnabled = true;
+#else
+inline constexpr bool kTracingEnabled = false;
+#endif
+
+/// @brief One completed span.
+struct TraceEvent {
+  /// Static string naming the operation, e.g. "SumTree::sample"
+  const char* name = nullptr;
+  /// Small sequential id of the recording thread, in order of first span
+  uint32_t thread = 0;
+  uint64_t start_ns = 0;
+  uint64_t duration_ns = 0;
+};
+
+namespace detail {
+/// @brief Fixed-size ring of the latest spans of one thread. Only the owning
+/// thread writes, without locks or read-modify-writes; readers copy it
+/// concurrently and drop slots the writer may have overwritten meanwhile,
+/// like a seqlock.
+class TraceRing {
+ public:
+  static constexpr size_t kCapacity = size_t{1} << 12;
+
+  explicit TraceRing(uint32_t thread) : thread_(thread) {}
+
+  uint32_t thread() const { return thread_; }
+
+  void push(const char* name, uint64_t start_ns, uint64_t duration_ns) {
+    const uint64_t n = written_.load(std::memory_order_relaxed);
+    // Announce the overwrite of event n - kCapacity before touching its slot
+    started_.store(n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Slot& slot = slots_[n & (kCapacity - 1)];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.duration_ns.store(duration_ns, std::memory_order_relaxed);
+    written_.store(n + 1, std::memory_order_release);
+  }
+
+  /// @brief Appends the retained events, oldest first.
+  void collect(std::vector<TraceEvent>& out) const {
+    const uint64_t written = written_.load(std::memory_order_acquire);
+    const uint64_t first =
+        std::max(cleared_.load(std::memory_order_relaxed),
+                 written > kCapacity ? written - kCapacity : 0);
+    const size_t old_size = out.size();
+    for (uint64_t i = first; i < written; i++) {
+      const Slot& slot = slots_[i & (kCapacity - 1)];
+      out.push_back({slot.name.load(std::memory_order_relaxed), thread_,
+                     slot.start_ns.load(std::memory_order_relaxed),
+                     slot.duration_ns.load(std::memory_order_relaxed)});
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Event started - 1 overwrote event started - 1 - kCapacity, so only
+    // events from started - kCapacity on were read intact
+    const uint64_t started = started_.load(std::memory_order_relaxed);
+    const uint64_t intact = started > kCapacity ? started - kCapacity : 0;
+    if (intact > first) {
+      const size_t torn = static_cast<size_t>(
+          std::min<uint64_t>(intact - first, written - first));
+      out.erase(out.begin() + old_size, out.begin() + old_size + torn);
+    }
+  }
+
+  /// @brief Hides the events recorded so far from later collect() calls.
+  void clear() {
+    cleared_.store(written_.load(std::memory_order_acquire),
+                   std::memory_order_relaxed);
+  }
+
+ private:
+  struct Slot {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t> start_ns{0};
+    std::atomic<uint64_t> duration_ns{0};
+  };
+
+  const uint32_t thread_;
+  alignas(64) std::atomic<uint64_t> written_{0};
+  std::atomic<uint64_t> started_{0};
+  alignas(64) std::atomic<uint64_t> cleared_{0};
+  Slot slots_[kCapacity];
+};
+
+/// Process-wide switch, kept out of TraceRegistry so that checking it does
+/// not go through a function-local static's guard
+inline std::atomic<bool> trace_enabled{false};
+
+/// @brief The rings of every thread that has recorded a span. Rings are
+/// shared with their threads so that spans of exited threads can still be
+/// dumped.
+class TraceRegistry {
+ public:
+  static TraceRegistry& instance() {
+    static TraceRegistry registry;
+    return registry;
+  }
+
+  /// @brief The calling thread's ring, registered on its first span.
+  TraceRing& local_ring() {
+    thread_local const std::shared_ptr<TraceRing> ring = register_thread();
+    return *ring;
+  }
+
+  std::vector<TraceEvent> collect() const {
+    std::vector<TraceEvent> events;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::shared_ptr<TraceRing>& ring : rings_) {
+      ring->collect(events);
+    }
+    return events;
+  }
+
+  /// @brief Discards recorded spans, and the rings of exited threads.
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::erase_if(rings_, [](const std::shared_ptr<TraceRing>& ring) {
+      return ring.use_count() == 1;
+    });
+    for (const std::shared_ptr<TraceRing>& ring : rings_) {
+      ring->clear();
+    }
+  }
+
+ private:
+  std::shared_ptr<TraceRing> register_thread() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rings_.push_back(std::make_shared<TraceRing>(next_thread_++));
+    return rings_.back();
+  }
+
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<TraceRing>> rings_;
+  uint32_t next_thread_ = 0;
+};
+
+inline uint64_t trace_now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/// @brief Records the span from construction to end() or destruction into
+/// the thread's ring, if tracing was switched on at construction.
+class RecordingTraceSpan {
+ public:
+  explicit RecordingTraceSpan(const char* name)
+      : name_(trace_enabled.load(std::memory_order_relaxed) ? name : nullptr),
+        start_ns_(name_ != nullptr ? trace_now() : 0) {}
+
+  RecordingTraceSpan(const RecordingTraceSpan&) = delete;
+  RecordingTraceSpan& operator=(const RecordingTraceSpan&) = delete;
+
+  ~RecordingTraceSpan() { end(); }
+
+  /// @brief Ends the span early, e.g. once a lock has been acquired.
+  void end() {
+    if (name_ != nullptr) {
+      TraceRegistry::instance().local_ring().push(name_, start_ns_,
+                                                  trace_now() - start_ns_);
+      name_ = nullptr;
+    }
+  }
+
+ private:
+  const char* name_;
+  uint64_t start_ns_;
+};
+
+/// @brief Stand-in used when tracing is compiled out.
+class NullTraceSpan {
+ public:
+  explicit NullTraceSpan(const char*) {}
+  void end() {}
+};
+}  // namespace detail
+
+using TraceSpan =
+    std::conditional_t<kTracingEnabled, detail::RecordingTraceSpan,
+                       detail::NullTraceSpan>;
+
+/// @brief Starts or stops recording spans in every thread. No effect unless
+/// tracing is compiled in.
+inline void set_tracing_enabled(bool enabled) {
+  if constexpr (kTracingEnabled) {
+    detail::trace_enabled.store(enabled, std::memory_order_relaxed);
+  }
+}
+
+inline bool tracing_enabled() {
+  if constexpr (kTracingEnabled) {
+    return detail::trace_enabled.load(std::memory_order_relaxed);
+  }
+  return false;
+}
+
+/// @brief The latest spans of every thread (up to TraceRing::kCapacity
+/// each), grouped by thread and oldest first within a thread. Safe to call
+/// while other threads record.
+inline std::vector<TraceEvent> collect_trace() {
+  if constexpr (kTracingEnabled) {
+    return detail::TraceRegistry::instance().collect();
+  }
+  return {};
+}
+
+/// @brief Discards every span recorded so far.
+inline void clear_trace() {
+  if constexpr (kTracingEnabled) {
+    detail::TraceRegistry::instance().clear();
+  }
+}
+
+/// @brief Writes events in the Chrome trace event format, as complete ("X")
+/// events with microsecond timestamps.
+inline void write_chrome_trace(std::ostream& out,
+                               const std::vector<TraceEvent>& events) {
+  const long pid = static_cast<long>(::getpid());
+  out << "{\"traceEvents\":[";
+  char buffer[64];
+  for (size_t i = 0; i < events.size(); i++) {
+    const TraceEvent& event = events[i];
+    out << (i == 0 ? "" : ",") << "\n{\"name\":\"";
+    // Span names are identifiers, but keep the output valid JSON regardless
+    for (const char* c = event.name; *c != '\0'; c++) {
+      if (*c == '"' || *c == '\\') {
+        out << '\\';
+      }
+      out << *c;
+    }
+    out << "\",\"cat\":\"replay_buffer\",\"ph\":\"X\",\"pid\":" << pid
+        << ",\"tid\":" << event.thread;
+    std::snprintf(buffer, sizeof(buffer), ",\"ts\":%.3f,\"dur\":%.3f}",
+                  static_cast<double>(event.start_ns) / 1000.0,
+                  static_cast<double>(event.duration_ns) / 1000.0);
+    out << buffer;
+  }
+  out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+/// @brief Writes every recorded span; see collect_trace().
+inline void write_chrome_trace(std::ostream& out) {
+  write_chrome_trace(out, collect_trace());
+}
+}  // namespace replay_buffer
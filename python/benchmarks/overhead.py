@@ -0,0 +1,83 @@
+"""Measures Python binding overhead against the same calls made natively.
+
+Each operation is timed twice on one buffer: from Python through the
+bindings, and from C++ through replay_buffer._native_seconds_per_call, which
+runs the identical add_batch/sample code without the interpreter, argument
+conversion or NumPy wrapping. The target is under 10% overhead for
+training-sized batches.
+
+Usage (after building with -DREPLAY_BUFFER_BUILD_PYTHON=ON):
+    PYTHONPATH=build/python python python/benchmarks/overhead.py
+"""
+
+import argparse
+import time
+
+import numpy as np
+
+import replay_buffer
+
+
+def python_seconds_per_call(call, iterations):
+    call()  # warm up allocations and caches
+    start = time.perf_counter()
+    for _ in range(iterations):
+        call()
+    return (time.perf_counter() - start) / iterations
+
+
+def report(name, python_seconds, native_seconds):
+    overhead = 100.0 * (python_seconds / native_seconds - 1.0)
+    print(f"{name:<40} python {python_seconds * 1e6:9.2f} us"
+          f"   native {native_seconds * 1e6:9.2f} us"
+          f"   overhead {overhead:6.1f}%")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--capacity", type=int, default=100_000)
+    parser.add_argument("--obs-dim", type=int, default=128)
+    parser.add_argument("--action-dim", type=int, default=0)
+    parser.add_argument("--iterations", type=int, default=2000)
+    parser.add_argument("--batch-sizes", type=int, nargs="+",
+                        default=[32, 256, 4096])
+    args = parser.parse_args()
+
+    for prioritized in (False, True):
+        kind = "prioritized" if prioritized else "uniform"
+        buffer = replay_buffer.ReplayBuffer(
+            args.capacity, args.obs_dim, args.action_dim,
+            prioritized=prioritized)
+        action_shape = ((args.capacity,) if args.action_dim == 0
+                        else (args.capacity, args.action_dim))
+        buffer.add_batch(
+            np.ones((args.capacity, args.obs_dim), dtype=np.float32),
+            np.ones(action_shape, dtype=np.float32),
+            np.ones(args.capacity, dtype=np.float32),
+            np.ones((args.capacity, args.obs_dim), dtype=np.float32),
+            np.zeros(args.capacity, dtype=bool))
+
+        for batch_size in args.batch_sizes:
+            action_shape = ((batch_size,) if args.action_dim == 0
+                            else (batch_size, args.action_dim))
+            obs = np.ones((batch_size, args.obs_dim), dtype=np.float32)
+            action = np.ones(action_shape, dtype=np.float32)
+            reward = np.ones(batch_size, dtype=np.float32)
+            done = np.zeros(batch_size, dtype=bool)
+
+            report(f"{kind} add_batch({batch_size})",
+                   python_seconds_per_call(
+                       lambda: buffer.add_batch(obs, action, reward, obs,
+                                                done),
+                       args.iterations),
+                   replay_buffer._native_seconds_per_call(
+                       buffer, "add_batch", batch_size, args.iterations))
+            report(f"{kind} sample({batch_size})",
+                   python_seconds_per_call(lambda: buffer.sample(batch_size),
+                                           args.iterations),
+                   replay_buffer._native_seconds_per_call(
+                       buffer, "sample", batch_size, args.iterations))
+
+
+if __name__ == "__main__":
+    main()
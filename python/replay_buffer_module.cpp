@@ -0,0 +1,484 @@
+/// @file replay_buffer_module.cpp
+/// @brief Python extension module exposing the replay buffers to NumPy.
+/// Transitions are fixed-size float rows (observation, action, reward,
+/// next observation, done) kept in C++-owned columns indexed by buffer slot.
+/// The core buffers store only slot ids, so sampling gathers rows with one
+/// memcpy each into reusable batch memory that NumPy views without copying.
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "replay_buffer/circular_buffer.h"
+#include "replay_buffer/prioritized_replay_buffer.h"
+#include "replay_buffer/thread_pool.h"
+
+namespace py = pybind11;
+
+namespace replay_buffer::python {
+/// @brief Memory for one sampled batch. NumPy views hold a reference, so the
+/// storage is reused for the next batch only once every view of it is gone.
+struct BatchStorage {
+  size_t batch_size = 0;
+  std::vector<float> observations;
+  std::vector<float> actions;
+  std::vector<float> rewards;
+  std::vector<float> next_observations;
+  std::vector<uint8_t> dones;
+  std::vector<float> weights;
+  std::vector<int64_t> indices;
+  std::vector<uint64_t> generations;
+
+  void resize(size_t size, size_t observation_dim, size_t action_dim) {
+    batch_size = size;
+    observations.resize(size * observation_dim);
+    actions.resize(size * action_dim);
+    rewards.resize(size);
+    next_observations.resize(size * observation_dim);
+    dones.resize(size);
+    weights.resize(size);
+    indices.resize(size);
+    generations.resize(size);
+  }
+};
+
+/// @brief Rows of one batch add, as raw pointers into C-contiguous arrays
+/// so the GIL can be released while they are copied.
+struct RowsView {
+  const float* observations;
+  const float* actions;
+  const float* rewards;
+  const float* next_observations;
+  const bool* dones;
+  // Null to give new transitions the maximum priority seen so far
+  const float* td_errors;
+  size_t count;
+};
+
+/// @brief Uniform or prioritized buffer of fixed-size float transitions.
+/// Writes keep slot order (FIFO retention and eviction), so the slot of
+/// every add is known without asking the core buffer. Sampling gathers by
+/// the slot id stored in the core buffer, not by the core's own slot.
+class ReplayBuffer {
+ public:
+  ReplayBuffer(size_t capacity, size_t observation_dim, size_t action_dim,
+               bool prioritized, float alpha, float beta, float epsilon,
+               size_t num_threads)
+      : capacity_(capacity),
+        observation_dim_(observation_dim),
+        action_dim_(action_dim),
+        action_width_(std::max<size_t>(action_dim, 1)),
+        observations_(capacity * observation_dim),
+        actions_(capacity * action_width_),
+        rewards_(capacity),
+        next_observations_(capacity * observation_dim),
+        dones_(capacity) {
+    if (observation_dim == 0) {
+      throw std::invalid_argument("Observation dimension must be > 0");
+    }
+    if (prioritized) {
+      PrioritizedReplayBufferConfig config;
+      config.capacity = capacity;
+      config.alpha = alpha;
+      config.beta = beta;
+      config.epsilon = epsilon;
+      prioritized_.emplace(config);
+    } else {
+      uniform_.emplace(capacity);
+    }
+    if (num_threads > 0) {
+      pool_ = std::make_unique<ThreadPool>(num_threads);
+    }
+  }
+
+  size_t capacity() const { return capacity_; }
+  size_t observation_dim() const { return observation_dim_; }
+  size_t action_dim() const { return action_dim_; }
+  bool prioritized() const { return prioritized_.has_value(); }
+
+  size_t size() const {
+    return prioritized_ ? prioritized_->size() : uniform_->size();
+  }
+
+  float beta() const { return prioritized_ ? prioritized_->beta() : 0.0f; }
+
+  void set_beta(float beta) { require_prioritized().set_beta(beta); }
+
+  float alpha() const { return prioritized_ ? prioritized_->alpha() : 0.0f; }
+
+  void set_alpha(float alpha) { require_prioritized().set_alpha(alpha); }
+
+  /// @brief Copies rows into the columns and adds their slot ids to the
+  /// core buffer under one lock. Only the last capacity rows can survive a
+  /// larger batch, so earlier ones are skipped.
+  void add_batch(RowsView rows) {
+    if (rows.count > capacity_) {
+      const size_t skip = rows.count - capacity_;
+      rows.observations += skip * observation_dim_;
+      rows.actions += skip * action_width_;
+      rows.rewards += skip;
+      rows.next_observations += skip * observation_dim_;
+      rows.dones += skip;
+      if (rows.td_errors != nullptr) {
+        rows.td_errors += skip;
+      }
+      rows.count = capacity_;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot_ids_.resize(rows.count);
+    for (size_t i = 0; i < rows.count; i++) {
+      const size_t slot = next_slot_;
+      next_slot_ = (next_slot_ + 1) % capacity_;
+      slot_ids_[i] = static_cast<uint32_t>(slot);
+      copy_row(rows.observations + i * observation_dim_,
+               observations_.data() + slot * observation_dim_,
+               observation_dim_);
+      copy_row(rows.actions + i * action_width_,
+               actions_.data() + slot * action_width_, action_width_);
+      rewards_[slot] = rows.rewards[i];
+      copy_row(rows.next_observations + i * observation_dim_,
+               next_observations_.data() + slot * observation_dim_,
+               observation_dim_);
+      dones_[slot] = rows.dones[i] ? 1 : 0;
+    }
+    if (uniform_) {
+      uniform_->add_batch(std::span<const uint32_t>(slot_ids_));
+    } else if (rows.td_errors != nullptr) {
+      prioritized_->add_batch(
+          std::span<const uint32_t>(slot_ids_),
+          std::span<const float>(rows.td_errors, rows.count));
+    } else {
+      prioritized_->add_batch(std::span<const uint32_t>(slot_ids_));
+    }
+  }
+
+  /// @brief Samples into reusable storage. Large batches use the thread
+  /// pool when one was requested.
+  std::shared_ptr<BatchStorage> sample(size_t batch_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!storage_ || storage_.use_count() > 1) {
+      storage_ = std::make_shared<BatchStorage>();
+    }
+    BatchStorage& batch = *storage_;
+    batch.resize(batch_size, observation_dim_, action_width_);
+    sampled_slots_.resize(batch_size);
+    if (prioritized_) {
+      const std::vector<PrioritizedSample<uint32_t>> samples =
+          pool_ ? prioritized_->sample(batch_size, *pool_)
+                : prioritized_->sample(batch_size);
+      for (size_t i = 0; i < batch_size; i++) {
+        sampled_slots_[i] = samples[i].transition;
+        batch.weights[i] = samples[i].weight;
+        // The core's slot, which update_priorities() takes back
+        batch.indices[i] = static_cast<int64_t>(samples[i].index);
+        batch.generations[i] = samples[i].generation;
+      }
+    } else {
+      const std::vector<uint32_t> slots =
+          pool_ ? uniform_->sample(batch_size, *pool_)
+                : uniform_->sample(batch_size);
+      for (size_t i = 0; i < batch_size; i++) {
+        sampled_slots_[i] = slots[i];
+        batch.weights[i] = 1.0f;
+        batch.indices[i] = slots[i];
+        batch.generations[i] = 0;
+      }
+    }
+    for (size_t i = 0; i < batch_size; i++) {
+      const size_t slot = sampled_slots_[i];
+      copy_row(observations_.data() + slot * observation_dim_,
+               batch.observations.data() + i * observation_dim_,
+               observation_dim_);
+      copy_row(actions_.data() + slot * action_width_,
+               batch.actions.data() + i * action_width_, action_width_);
+      batch.rewards[i] = rewards_[slot];
+      copy_row(next_observations_.data() + slot * observation_dim_,
+               batch.next_observations.data() + i * observation_dim_,
+               observation_dim_);
+      batch.dones[i] = dones_[slot];
+    }
+    return storage_;
+  }
+
+  /// @brief Applies TD errors to sampled slots. With generations, updates
+  /// for slots overwritten since sampling are dropped.
+  /// @return Number of updates applied
+  size_t update_priorities(std::span<const int64_t> indices,
+                           std::span<const float> td_errors,
+                           std::span<const uint64_t> generations) {
+    PrioritizedReplayBuffer<uint32_t>& buffer = require_prioritized();
+    const std::vector<float> errors(td_errors.begin(), td_errors.end());
+    if (generations.empty()) {
+      const std::vector<size_t> slots(indices.begin(), indices.end());
+      buffer.update_priorities(slots, errors);
+      return slots.size();
+    }
+    std::vector<SampleHandle> handles(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+      handles[i] = {static_cast<size_t>(indices[i]), generations[i]};
+    }
+    return buffer.update_priorities(handles, errors);
+  }
+
+ private:
+  static void copy_row(const float* source, float* destination,
+                       size_t length) {
+    std::memcpy(destination, source, length * sizeof(float));
+  }
+
+  PrioritizedReplayBuffer<uint32_t>& require_prioritized() {
+    if (!prioritized_) {
+      throw std::logic_error("Buffer was not created with prioritized=True");
+    }
+    return *prioritized_;
+  }
+
+  size_t capacity_;
+  size_t observation_dim_;
+  size_t action_dim_;
+  // Floats stored per action: action_dim, or 1 for scalar actions
+  size_t action_width_;
+  // Columns indexed by slot
+  std::vector<float> observations_;
+  std::vector<float> actions_;
+  std::vector<float> rewards_;
+  std::vector<float> next_observations_;
+  std::vector<uint8_t> dones_;
+  // Exactly one of these is set; both store slot ids
+  std::optional<CircularBuffer<uint32_t>> uniform_;
+  std::optional<PrioritizedReplayBuffer<uint32_t>> prioritized_;
+  std::unique_ptr<ThreadPool> pool_;
+  // Serializes column writes against gathers
+  std::mutex mutex_;
+  size_t next_slot_ = 0;
+  std::vector<uint32_t> slot_ids_;
+  // Column slots of the batch being gathered
+  std::vector<uint32_t> sampled_slots_;
+  std::shared_ptr<BatchStorage> storage_;
+};
+
+using FloatArray = py::array_t<float, py::array::c_style | py::array::forcecast>;
+using BoolArray = py::array_t<bool, py::array::c_style | py::array::forcecast>;
+using IndexArray =
+    py::array_t<int64_t, py::array::c_style | py::array::forcecast>;
+using GenerationArray =
+    py::array_t<uint64_t, py::array::c_style | py::array::forcecast>;
+
+/// @brief Checks that an input has count rows of width elements (width 0
+/// meaning a 1-D array) and returns its data.
+template <typename Array>
+auto checked_rows(const Array& array, const char* name, size_t count,
+                  size_t width) {
+  const bool shape_ok =
+      width == 0 ? array.ndim() == 1 && static_cast<size_t>(array.shape(0)) ==
+                                            count
+                 : array.ndim() == 2 &&
+                       static_cast<size_t>(array.shape(0)) == count &&
+                       static_cast<size_t>(array.shape(1)) == width;
+  if (!shape_ok) {
+    throw std::invalid_argument(std::string(name) + " has the wrong shape");
+  }
+  return array.data();
+}
+
+/// @brief Wraps batch memory in NumPy arrays that keep it alive.
+py::dict to_numpy(std::shared_ptr<BatchStorage> storage,
+                  const ReplayBuffer& buffer) {
+  const py::ssize_t rows = static_cast<py::ssize_t>(storage->batch_size);
+  const py::ssize_t observation_dim =
+      static_cast<py::ssize_t>(buffer.observation_dim());
+  const py::ssize_t action_dim = static_cast<py::ssize_t>(buffer.action_dim());
+  BatchStorage* batch = storage.get();
+  const py::capsule owner(
+      new std::shared_ptr<BatchStorage>(std::move(storage)), [](void* owned) {
+        delete static_cast<std::shared_ptr<BatchStorage>*>(owned);
+      });
+  py::dict result;
+  result["obs"] = py::array_t<float>({rows, observation_dim},
+                                     batch->observations.data(), owner);
+  result["action"] =
+      action_dim == 0
+          ? py::array_t<float>({rows}, batch->actions.data(), owner)
+          : py::array_t<float>({rows, action_dim}, batch->actions.data(),
+                               owner);
+  result["reward"] = py::array_t<float>({rows}, batch->rewards.data(), owner);
+  result["next_obs"] = py::array_t<float>(
+      {rows, observation_dim}, batch->next_observations.data(), owner);
+  result["done"] = py::array(py::dtype::of<bool>(), {rows},
+                             batch->dones.data(), owner);
+  result["weights"] = py::array_t<float>({rows}, batch->weights.data(), owner);
+  result["indices"] =
+      py::array_t<int64_t>({rows}, batch->indices.data(), owner);
+  result["generations"] =
+      py::array_t<uint64_t>({rows}, batch->generations.data(), owner);
+  return result;
+}
+
+/// @brief Times the same add and sample calls without the Python layer, as
+/// the baseline for binding overhead. Returns seconds per call.
+double native_seconds_per_call(ReplayBuffer& buffer, size_t batch_size,
+                               size_t iterations, bool sample) {
+  const size_t observation_dim = buffer.observation_dim();
+  const size_t action_width = std::max<size_t>(buffer.action_dim(), 1);
+  const std::vector<float> observations(batch_size * observation_dim, 1.0f);
+  const std::vector<float> actions(batch_size * action_width, 1.0f);
+  const std::vector<float> rewards(batch_size, 1.0f);
+  const std::unique_ptr<bool[]> dones(new bool[batch_size]());
+  const RowsView rows{observations.data(), actions.data(), rewards.data(),
+                      observations.data(), dones.get(),    nullptr,
+                      batch_size};
+  py::gil_scoped_release release;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    if (sample) {
+      buffer.sample(batch_size);
+    } else {
+      buffer.add_batch(rows);
+    }
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / static_cast<double>(iterations);
+}
+}  // namespace replay_buffer::python
+
+PYBIND11_MODULE(replay_buffer, module) {
+  using replay_buffer::python::BoolArray;
+  using replay_buffer::python::checked_rows;
+  using replay_buffer::python::FloatArray;
+  using replay_buffer::python::GenerationArray;
+  using replay_buffer::python::IndexArray;
+  using replay_buffer::python::ReplayBuffer;
+  using replay_buffer::python::RowsView;
+
+  module.doc() =
+      "Replay buffers for reinforcement learning. Sampled batches are NumPy "
+      "views of C++-owned memory. A batch's memory is reused only after "
+      "every view of it is gone, so the arrays can be kept without copying.";
+
+  py::class_<ReplayBuffer>(module, "ReplayBuffer")
+      .def(py::init<size_t, size_t, size_t, bool, float, float, float,
+                    size_t>(),
+           py::arg("capacity"), py::arg("obs_dim"), py::arg("action_dim") = 0,
+           py::arg("prioritized") = false, py::arg("alpha") = 0.6f,
+           py::arg("beta") = 0.4f, py::arg("epsilon") = 1e-6f,
+           py::arg("num_threads") = 0,
+           "action_dim 0 stores one scalar action per transition. "
+           "num_threads > 0 samples large batches on a thread pool.")
+      .def_property_readonly("capacity", &ReplayBuffer::capacity)
+      .def_property_readonly("obs_dim", &ReplayBuffer::observation_dim)
+      .def_property_readonly("prioritized", &ReplayBuffer::prioritized)
+      .def_property("alpha", &ReplayBuffer::alpha, &ReplayBuffer::set_alpha,
+                    "Setting alpha rebuilds the priorities in the background")
+      .def_property("beta", &ReplayBuffer::beta, &ReplayBuffer::set_beta)
+      .def("__len__", &ReplayBuffer::size)
+      .def(
+          "add_batch",
+          [](ReplayBuffer& buffer, const FloatArray& obs,
+             const FloatArray& action, const FloatArray& reward,
+             const FloatArray& next_obs, const BoolArray& done,
+             std::optional<FloatArray> td_errors) {
+            const size_t count = static_cast<size_t>(reward.size());
+            const size_t action_dim = buffer.action_dim();
+            RowsView rows{
+                checked_rows(obs, "obs", count, buffer.observation_dim()),
+                checked_rows(action, "action", count, action_dim),
+                checked_rows(reward, "reward", count, 0),
+                checked_rows(next_obs, "next_obs", count,
+                             buffer.observation_dim()),
+                checked_rows(done, "done", count, 0),
+                td_errors ? checked_rows(*td_errors, "td_errors", count, 0)
+                          : nullptr,
+                count};
+            py::gil_scoped_release release;
+            buffer.add_batch(rows);
+          },
+          py::arg("obs"), py::arg("action"), py::arg("reward"),
+          py::arg("next_obs"), py::arg("done"),
+          py::arg("td_errors") = py::none(),
+          "Adds N transitions from arrays of shape (N, obs_dim), "
+          "(N, action_dim) or (N,), (N,), (N, obs_dim) and (N,).")
+      .def(
+          "add",
+          [](ReplayBuffer& buffer, const FloatArray& obs,
+             const FloatArray& action, float reward,
+             const FloatArray& next_obs, bool done) {
+            const size_t action_size =
+                std::max<size_t>(buffer.action_dim(), 1);
+            if (static_cast<size_t>(obs.size()) != buffer.observation_dim() ||
+                static_cast<size_t>(next_obs.size()) !=
+                    buffer.observation_dim() ||
+                static_cast<size_t>(action.size()) != action_size) {
+              throw std::invalid_argument("Transition has the wrong shape");
+            }
+            const RowsView rows{obs.data(), action.data(),    &reward,
+                                next_obs.data(), &done, nullptr, 1};
+            py::gil_scoped_release release;
+            buffer.add_batch(rows);
+          },
+          py::arg("obs"), py::arg("action"), py::arg("reward"),
+          py::arg("next_obs"), py::arg("done"))
+      .def(
+          "sample",
+          [](ReplayBuffer& buffer, size_t batch_size) {
+            std::shared_ptr<replay_buffer::python::BatchStorage> storage;
+            {
+              py::gil_scoped_release release;
+              storage = buffer.sample(batch_size);
+            }
+            return replay_buffer::python::to_numpy(std::move(storage),
+                                                   buffer);
+          },
+          py::arg("batch_size"),
+          "Returns a dict of arrays: obs, action, reward, next_obs, done, "
+          "weights, indices and generations.")
+      .def(
+          "update_priorities",
+          [](ReplayBuffer& buffer, const IndexArray& indices,
+             const FloatArray& td_errors,
+             std::optional<GenerationArray> generations) {
+            const size_t count = static_cast<size_t>(indices.size());
+            checked_rows(td_errors, "td_errors", count, 0);
+            const std::span<const uint64_t> generation_span =
+                generations ? std::span<const uint64_t>(
+                                  checked_rows(*generations, "generations",
+                                               count, 0),
+                                  count)
+                            : std::span<const uint64_t>();
+            py::gil_scoped_release release;
+            return buffer.update_priorities(
+                std::span<const int64_t>(indices.data(), count),
+                std::span<const float>(td_errors.data(), count),
+                generation_span);
+          },
+          py::arg("indices"), py::arg("td_errors"),
+          py::arg("generations") = py::none(),
+          "Pass the sampled generations to drop updates for transitions "
+          "overwritten since sampling. Returns the number applied.");
+
+  module.def(
+      "_native_seconds_per_call",
+      [](ReplayBuffer& buffer, const std::string& operation,
+         size_t batch_size, size_t iterations) {
+        if (operation != "add_batch" && operation != "sample") {
+          throw std::invalid_argument("operation must be add_batch or sample");
+        }
+        return replay_buffer::python::native_seconds_per_call(
+            buffer, batch_size, iterations, operation == "sample");
+      },
+      py::arg("buffer"), py::arg("operation"), py::arg("batch_size"),
+      py::arg("iterations"),
+      "Baseline for benchmarks/overhead.py: the same call without Python.");
+}
@@ -0,0 +1,129 @@
+"""Smoke tests for the replay_buffer extension module.
+
+Run by ctest when configured with -DREPLAY_BUFFER_BUILD_PYTHON=ON, or by
+hand with PYTHONPATH=build/python python -m pytest python/tests.
+"""
+
+import numpy as np
+import pytest
+
+import replay_buffer
+
+OBS_DIM = 3
+
+
+def make_rows(first, count, action_dim=0):
+    """Rows whose every field is derived from the reward, so a sampled row
+    can be checked for having been gathered from a single transition."""
+    reward = np.arange(first, first + count, dtype=np.float32)
+    obs = np.repeat(reward[:, None], OBS_DIM, axis=1)
+    action = 2.0 * reward if action_dim == 0 else np.repeat(
+        2.0 * reward[:, None], action_dim, axis=1)
+    return {
+        "obs": obs,
+        "action": action,
+        "reward": reward,
+        "next_obs": obs + 1.0,
+        "done": (reward.astype(np.int64) % 2).astype(bool),
+    }
+
+
+def check_rows(batch, action_dim=0):
+    reward = batch["reward"]
+    np.testing.assert_array_equal(batch["obs"][:, 0], reward)
+    np.testing.assert_array_equal(batch["next_obs"][:, OBS_DIM - 1],
+                                  reward + 1.0)
+    action = batch["action"] if action_dim == 0 else batch["action"][:, 0]
+    np.testing.assert_array_equal(action, 2.0 * reward)
+    np.testing.assert_array_equal(batch["done"],
+                                  reward.astype(np.int64) % 2 == 1)
+
+
+def test_uniform_add_and_sample():
+    buffer = replay_buffer.ReplayBuffer(capacity=8, obs_dim=OBS_DIM)
+    assert not buffer.prioritized
+    buffer.add_batch(**make_rows(0, 5))
+    buffer.add(np.zeros(OBS_DIM), np.array([10.0]), 5.0, np.ones(OBS_DIM),
+               True)
+    assert len(buffer) == 6
+
+    batch = buffer.sample(64)
+    assert batch["obs"].shape == (64, OBS_DIM)
+    assert batch["action"].shape == (64,)
+    assert batch["done"].dtype == np.bool_
+    np.testing.assert_array_equal(batch["weights"], np.ones(64))
+    rows = batch["reward"] < 5.0
+    check_rows({key: value[rows] for key, value in batch.items()})
+
+
+def test_oversized_batch_keeps_the_newest_rows():
+    buffer = replay_buffer.ReplayBuffer(capacity=4, obs_dim=OBS_DIM,
+                                        action_dim=2)
+    buffer.add_batch(**make_rows(0, 10, action_dim=2))
+    assert len(buffer) == 4
+    batch = buffer.sample(200)
+    check_rows(batch, action_dim=2)
+    assert set(batch["reward"].tolist()) == {6.0, 7.0, 8.0, 9.0}
+
+
+def test_prioritized_sample_and_update():
+    buffer = replay_buffer.ReplayBuffer(capacity=6, obs_dim=OBS_DIM,
+                                        prioritized=True, alpha=1.0,
+                                        beta=1.0, epsilon=0.0)
+    assert buffer.prioritized
+    buffer.add_batch(**make_rows(0, 4))
+    buffer.add_batch(**make_rows(4, 2), td_errors=np.array([0.0, 10.0]))
+
+    batch = buffer.sample(500)
+    check_rows(batch)
+    # A zero TD error is never drawn, and 10 dominates the unit priorities
+    assert 4.0 not in batch["reward"]
+    assert np.count_nonzero(batch["reward"] == 5.0) > 250
+
+    applied = buffer.update_priorities(batch["indices"][:3],
+                                       np.ones(3, dtype=np.float32),
+                                       batch["generations"][:3])
+    assert applied == 3
+    # Overwriting every slot makes the old handles stale
+    buffer.add_batch(**make_rows(10, 6))
+    assert buffer.update_priorities(batch["indices"][:3],
+                                    np.ones(3, dtype=np.float32),
+                                    batch["generations"][:3]) == 0
+    check_rows(buffer.sample(100))
+
+
+def test_thread_pool_sampling_gathers_whole_rows():
+    buffer = replay_buffer.ReplayBuffer(capacity=1000, obs_dim=OBS_DIM,
+                                        prioritized=True, num_threads=2)
+    buffer.add_batch(**make_rows(0, 1000))
+    batch = buffer.sample(8192)
+    assert batch["reward"].shape == (8192,)
+    check_rows(batch)
+
+
+def test_batches_stay_valid_while_referenced():
+    buffer = replay_buffer.ReplayBuffer(capacity=16, obs_dim=OBS_DIM)
+    buffer.add_batch(**make_rows(0, 16))
+    first = buffer.sample(32)
+    kept = {key: value.copy() for key, value in first.items()}
+    for _ in range(3):
+        buffer.sample(32)
+    buffer.add_batch(**make_rows(100, 16))
+    for key, value in kept.items():
+        np.testing.assert_array_equal(first[key], value)
+
+    # Storage whose views are gone is reused without changing the results
+    del first
+    check_rows(buffer.sample(32))
+
+
+def test_invalid_arguments_raise():
+    buffer = replay_buffer.ReplayBuffer(capacity=4, obs_dim=OBS_DIM)
+    rows = make_rows(0, 2)
+    rows["obs"] = np.zeros((2, OBS_DIM + 1), dtype=np.float32)
+    with pytest.raises(ValueError):
+        buffer.add_batch(**rows)
+    with pytest.raises(RuntimeError):
+        buffer.beta = 0.5
+    with pytest.raises(ValueError):
+        replay_buffer.ReplayBuffer(capacity=4, obs_dim=0)
@@ -0,0 +1,139 @@
+#include "replay_buffer/arena_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+TEST(ArenaBufferConstructionTest, ValidCapacity) {
+  replay_buffer::ArenaBuffer<float> buffer(64);
+  EXPECT_EQ(buffer.capacity_bytes(), 64);
+  EXPECT_EQ(buffer.size(), 0);
+  EXPECT_EQ(buffer.used_bytes(), 0);
+  EXPECT_TRUE(buffer.is_empty());
+}
+
+TEST(ArenaBufferConstructionTest, TooSmallCapacityThrows) {
+  EXPECT_THROW(
+      { replay_buffer::ArenaBuffer<float> buffer(2); }, std::invalid_argument);
+}
+
+TEST(ArenaBufferAddTest, StoresVariableLengthRecords) {
+  replay_buffer::ArenaBuffer<float> buffer(64 * sizeof(float));
+
+  const std::vector<float> small = {1.0f, 2.0f};
+  const std::vector<float> large = {3.0f, 4.0f, 5.0f, 6.0f, 7.0f};
+  EXPECT_EQ(buffer.add(small), 0);
+  EXPECT_EQ(buffer.add(large), 0);
+
+  EXPECT_EQ(buffer.size(), 2);
+  EXPECT_EQ(buffer.used_bytes(), 7 * sizeof(float));
+  ASSERT_EQ(buffer[0].size(), 2);
+  ASSERT_EQ(buffer.at(1).size(), 5);
+  EXPECT_FLOAT_EQ(buffer[0][1], 2.0f);
+  EXPECT_FLOAT_EQ(buffer.at(1)[4], 7.0f);
+}
+
+TEST(ArenaBufferAddTest, RecordsAreContiguousInArena) {
+  replay_buffer::ArenaBuffer<uint8_t> buffer(32);
+  const std::vector<uint8_t> first = {1, 2, 3};
+  const std::vector<uint8_t> second = {4, 5};
+  buffer.add(first);
+  buffer.add(second);
+  EXPECT_EQ(buffer[0].data() + buffer[0].size(), buffer[1].data());
+}
+
+TEST(ArenaBufferAddTest, PayloadLargerThanArenaThrows) {
+  replay_buffer::ArenaBuffer<uint8_t> buffer(4);
+  const std::vector<uint8_t> payload(5, 1);
+  EXPECT_THROW(buffer.add(payload), std::invalid_argument);
+}
+
+TEST(ArenaBufferEvictionTest, EvictsOldestOnWrap) {
+  replay_buffer::ArenaBuffer<uint8_t> buffer(10);
+
+  buffer.add(std::vector<uint8_t>{1, 1, 1, 1});
+  buffer.add(std::vector<uint8_t>{2, 2, 2, 2});
+  // Does not fit in the remaining 2 bytes, wraps and evicts record 1
+  EXPECT_EQ(buffer.add(std::vector<uint8_t>{3, 3, 3}), 1);
+
+  EXPECT_EQ(buffer.size(), 2);
+  EXPECT_EQ(buffer[0][0], 2);
+  EXPECT_EQ(buffer[1][0], 3);
+  EXPECT_EQ(buffer.used_bytes(), 7);
+
+  // Overlaps record 2 at offset 4
+  EXPECT_EQ(buffer.add(std::vector<uint8_t>{4, 4, 4}), 1);
+  EXPECT_EQ(buffer.size(), 2);
+  EXPECT_EQ(buffer[0][0], 3);
+  EXPECT_EQ(buffer[1][0], 4);
+}
+
+TEST(ArenaBufferEvictionTest, EvictsMultipleRecordsForLargePayload) {
+  replay_buffer::ArenaBuffer<uint8_t> buffer(8);
+  for (uint8_t i = 0; i < 8; i++) {
+    buffer.add(std::vector<uint8_t>{i});
+  }
+  EXPECT_EQ(buffer.size(), 8);
+
+  EXPECT_EQ(buffer.add(std::vector<uint8_t>(8, 9)), 8);
+  EXPECT_EQ(buffer.size(), 1);
+  EXPECT_EQ(buffer.used_bytes(), 8);
+}
+
+TEST(ArenaBufferEvictionTest, ManyWrapsKeepNewestRecords) {
+  replay_buffer::ArenaBuffer<uint32_t> buffer(100 * sizeof(uint32_t));
+  for (uint32_t i = 0; i < 1000; i++) {
+    buffer.add(std::vector<uint32_t>(i % 7 + 1, i));
+  }
+  ASSERT_GT(buffer.size(), 0);
+  EXPECT_LE(buffer.used_bytes(), buffer.capacity_bytes());
+  // Records stay in insertion order and end with the newest
+  const size_t size = buffer.size();
+  EXPECT_EQ(buffer[size - 1][0], 999u);
+  for (size_t i = 1; i < size; i++) {
+    EXPECT_EQ(buffer[i][0], buffer[i - 1][0] + 1);
+    EXPECT_EQ(buffer[i].size(), buffer[i][0] % 7 + 1);
+  }
+}
+
+TEST(ArenaBufferAccessTest, OutOfBoundsThrows) {
+  replay_buffer::ArenaBuffer<float> buffer(16);
+  buffer.add(std::vector<float>{1.0f});
+  EXPECT_THROW(buffer[1], std::out_of_range);
+  EXPECT_THROW(buffer.at(1), std::out_of_range);
+}
+
+TEST(ArenaBufferClearTest, RemovesAllRecords) {
+  replay_buffer::ArenaBuffer<float> buffer(16);
+  buffer.add(std::vector<float>{1.0f, 2.0f});
+  buffer.clear();
+  EXPECT_TRUE(buffer.is_empty());
+  EXPECT_EQ(buffer.used_bytes(), 0);
+  EXPECT_THROW(buffer[0], std::out_of_range);
+}
+
+TEST(ArenaBufferSampleTest, ReturnsViewsIntoArena) {
+  replay_buffer::ArenaBuffer<float> buffer(64 * sizeof(float));
+  buffer.add(std::vector<float>{1.0f});
+  buffer.add(std::vector<float>{2.0f, 2.0f});
+  buffer.add(std::vector<float>{3.0f, 3.0f, 3.0f});
+
+  for (int i = 0; i < 10; i++) {
+    const auto samples = buffer.sample(3);
+    EXPECT_EQ(samples.size(), 3);
+    for (const auto& sample : samples) {
+      ASSERT_FALSE(sample.empty());
+      EXPECT_EQ(sample.size(), static_cast<size_t>(sample[0]));
+      const size_t record = sample.size() - 1;
+      EXPECT_EQ(sample.data(), buffer[record].data());
+    }
+  }
+}
+
+TEST(ArenaBufferSampleTest, InvalidBatchSizeThrows) {
+  replay_buffer::ArenaBuffer<float> buffer(16);
+  EXPECT_THROW(buffer.sample(0), std::invalid_argument);
+  EXPECT_THROW(buffer.sample(1), std::invalid_argument);
+}
@@ -0,0 +1,173 @@
+#include "replay_buffer/async_replay_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "replay_buffer/circular_buffer.h"
+#include "replay_buffer/prioritized_replay_buffer.h"
+#include "replay_buffer/task.h"
+
+namespace {
+using AsyncCircularBuffer =
+    replay_buffer::AsyncReplayBuffer<replay_buffer::CircularBuffer<int>>;
+using AsyncPrioritizedBuffer = replay_buffer::AsyncReplayBuffer<
+    replay_buffer::PrioritizedReplayBuffer<int>>;
+
+// Spins on the test thread, which is not an executor thread, until
+// condition holds
+template <typename F>
+bool eventually(F condition) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+}  // namespace
+
+TEST(TaskTest, ReturnsValuesAndPropagatesExceptions) {
+  replay_buffer::Executor executor;
+  auto add = [](int a, int b) -> replay_buffer::Task<int> { co_return a + b; };
+  auto twice = [](auto add) -> replay_buffer::Task<int> {
+    const int first = co_await add(1, 2);
+    co_return first + co_await add(3, 4);
+  };
+  EXPECT_EQ(replay_buffer::sync_wait(executor, twice(add)), 10);
+
+  auto fail = []() -> replay_buffer::Task<void> {
+    throw std::logic_error("failed");
+    co_return;
+  };
+  EXPECT_THROW(replay_buffer::sync_wait(executor, fail()), std::logic_error);
+}
+
+TEST(TaskTest, ScheduleMovesToExecutorThread) {
+  replay_buffer::Executor executor;
+  auto thread_id = [](replay_buffer::Executor& executor)
+      -> replay_buffer::Task<std::thread::id> {
+    co_await executor.schedule();
+    co_return std::this_thread::get_id();
+  };
+  EXPECT_NE(replay_buffer::sync_wait(executor, thread_id(executor)),
+            std::this_thread::get_id());
+}
+
+TEST(AsyncReplayBufferTest, SampleDoesNotWaitWhenDataIsAvailable) {
+  replay_buffer::Executor executor;
+  AsyncCircularBuffer buffer(executor, 8);
+  for (int i = 0; i < 4; i++) {
+    replay_buffer::sync_wait(executor, buffer.add_async(i));
+  }
+  const std::vector<int> batch =
+      replay_buffer::sync_wait(executor, buffer.sample_async(4));
+  EXPECT_EQ(batch.size(), 4);
+  EXPECT_EQ(buffer.waiting(), 0);
+}
+
+TEST(AsyncReplayBufferTest, SampleWaitsForEnoughItems) {
+  replay_buffer::Executor executor;
+  AsyncCircularBuffer buffer(executor, 16);
+  std::atomic<size_t> sampled{0};
+  executor.spawn([](AsyncCircularBuffer& buffer,
+                    std::atomic<size_t>& sampled) -> replay_buffer::Task<void> {
+    sampled = (co_await buffer.sample_async(5)).size();
+  }(buffer, sampled));
+  ASSERT_TRUE(eventually([&]() { return buffer.waiting() == 1; }));
+
+  for (int i = 0; i < 4; i++) {
+    replay_buffer::sync_wait(executor, buffer.add_async(i));
+  }
+  EXPECT_EQ(buffer.waiting(), 1);  // 4 items do not wake a waiter for 5
+  EXPECT_EQ(sampled, 0);
+
+  replay_buffer::sync_wait(executor, buffer.add_batch_async({4, 5}));
+  EXPECT_TRUE(eventually([&]() { return sampled == 5; }));
+  EXPECT_EQ(buffer.waiting(), 0);
+}
+
+TEST(AsyncReplayBufferTest, OneThreadServesThousandsOfActors) {
+  replay_buffer::Executor executor(1);
+  AsyncCircularBuffer buffer(executor, 100000);
+  const int actors = 2000;
+  const int steps = 10;
+  std::atomic<int> learner_batches{0};
+  std::atomic<int> finished_actors{0};
+
+  // Learners wait on the buffer without holding the executor's thread
+  for (int learner = 0; learner < 4; learner++) {
+    executor.spawn([](AsyncCircularBuffer& buffer, size_t size,
+                      std::atomic<int>& batches) -> replay_buffer::Task<void> {
+      co_await buffer.sample_async(size);
+      batches++;
+    }(buffer, static_cast<size_t>((learner + 1) * actors * steps / 4),
+      learner_batches));
+  }
+  for (int actor = 0; actor < actors; actor++) {
+    executor.spawn([](replay_buffer::Executor& executor,
+                      AsyncCircularBuffer& buffer, int actor, int steps,
+                      std::atomic<int>& finished) -> replay_buffer::Task<void> {
+      for (int step = 0; step < steps; step++) {
+        co_await buffer.add_async(actor * steps + step);
+        // Yield so actors interleave on the single thread
+        co_await executor.schedule();
+      }
+      finished++;
+    }(executor, buffer, actor, steps, finished_actors));
+  }
+
+  EXPECT_TRUE(eventually([&]() {
+    return finished_actors == actors && learner_batches == 4;
+  }));
+  EXPECT_EQ(buffer.buffer().size(), actors * steps);
+}
+
+TEST(AsyncReplayBufferTest, PrioritizedSampleAndUpdate) {
+  replay_buffer::Executor executor;
+  const replay_buffer::PrioritizedReplayBufferConfig config{.capacity = 8};
+  AsyncPrioritizedBuffer buffer(executor, config);
+  replay_buffer::sync_wait(
+      executor, buffer.add_batch_async({1, 2, 3}, {1.0f, 1.0f, 1.0f}));
+  const auto samples =
+      replay_buffer::sync_wait(executor, buffer.sample_async(3));
+  ASSERT_EQ(samples.size(), 3);
+
+  std::vector<replay_buffer::SampleHandle> handles;
+  for (const auto& sample : samples) {
+    handles.push_back({sample.index, sample.generation});
+  }
+  EXPECT_EQ(replay_buffer::sync_wait(
+                executor, buffer.update_priorities_async(
+                              handles, std::vector<float>(3, 2.0f))),
+            3);
+}
+
+TEST(AsyncReplayBufferTest, CloseFailsWaiters) {
+  replay_buffer::Executor executor;
+  AsyncCircularBuffer buffer(executor, 8);
+  std::atomic<bool> failed{false};
+  executor.spawn([](AsyncCircularBuffer& buffer,
+                    std::atomic<bool>& failed) -> replay_buffer::Task<void> {
+    try {
+      co_await buffer.sample_async(4);
+    } catch (const std::runtime_error&) {
+      failed = true;
+    }
+  }(buffer, failed));
+  ASSERT_TRUE(eventually([&]() { return buffer.waiting() == 1; }));
+
+  buffer.close();
+  EXPECT_TRUE(eventually([&]() { return failed.load(); }));
+  EXPECT_THROW(replay_buffer::sync_wait(executor, buffer.sample_async(1)),
+               std::runtime_error);
+  EXPECT_THROW(replay_buffer::sync_wait(executor, buffer.sample_async(9)),
+               std::invalid_argument);
+}
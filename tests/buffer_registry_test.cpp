@@ -0,0 +1,219 @@
+#include "replay_buffer/buffer_registry.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+using Registry = replay_buffer::ReplayBufferRegistry<int>;
+
+replay_buffer::ReplayBufferRegistryConfig make_config(size_t slabs,
+                                                      size_t slab_size = 4) {
+  replay_buffer::ReplayBufferRegistryConfig config;
+  config.slab_size = slab_size;
+  config.budget_bytes = slabs * Registry::slab_bytes(slab_size);
+  return config;
+}
+}  // namespace
+
+TEST(ReplayBufferRegistryTest, ValidatesConfigAndNames) {
+  replay_buffer::ReplayBufferRegistryConfig config = make_config(2);
+  config.budget_bytes = Registry::slab_bytes(4) - 1;
+  EXPECT_THROW(Registry{config}, std::invalid_argument);
+  config = make_config(2);
+  config.slab_size = 0;
+  EXPECT_THROW(Registry{config}, std::invalid_argument);
+
+  Registry registry(make_config(2));
+  EXPECT_EQ(registry.slab_count(), 2);
+  EXPECT_EQ(registry.capacity(), 8);
+  const size_t id = registry.create_buffer("task");
+  EXPECT_EQ(registry.buffer_id("task"), id);
+  EXPECT_THROW(registry.create_buffer("task"), std::invalid_argument);
+  EXPECT_THROW(registry.create_buffer("other", {-1.0}),
+               std::invalid_argument);
+  EXPECT_THROW(registry.buffer_id("missing"), std::out_of_range);
+  EXPECT_THROW(registry.add(id + 1, 0), std::out_of_range);
+}
+
+TEST(ReplayBufferRegistryTest, BuffersGrowBySlab) {
+  Registry registry(make_config(4));
+  const size_t a = registry.create_buffer("a");
+  const size_t b = registry.create_buffer("b");
+  EXPECT_EQ(registry.slabs(a), 0);
+
+  for (int i = 0; i < 5; i++) {
+    registry.add(a, i);
+  }
+  registry.add(b, 100);
+  EXPECT_EQ(registry.size(a), 5);
+  EXPECT_EQ(registry.slabs(a), 2);
+  EXPECT_EQ(registry.size(b), 1);
+  EXPECT_EQ(registry.slabs(b), 1);
+  EXPECT_EQ(registry.free_slabs(), 1);
+}
+
+TEST(ReplayBufferRegistryTest, MaxSizeRecyclesOwnOldestSlab) {
+  Registry registry(make_config(4));
+  const size_t id = registry.create_buffer("capped", {1.0, 6});
+  for (int i = 0; i < 20; i++) {
+    registry.add(id, i);
+  }
+  // Capped at two slabs; the newest slab holds 16..19
+  EXPECT_EQ(registry.slabs(id), 2);
+  EXPECT_EQ(registry.size(id), 8);
+  EXPECT_EQ(registry.free_slabs(), 2);
+  for (const auto& sample : registry.sample(50)) {
+    EXPECT_GE(sample.transition, 12);
+  }
+}
+
+TEST(ReplayBufferRegistryTest, FullPoolTakesSlabsFromLargestBuffer) {
+  Registry registry(make_config(3));
+  const size_t big = registry.create_buffer("big");
+  const size_t small = registry.create_buffer("small");
+  for (int i = 0; i < 12; i++) {
+    registry.add(big, i);
+  }
+  EXPECT_EQ(registry.free_slabs(), 0);
+
+  registry.add(small, 100);
+  EXPECT_EQ(registry.slabs(big), 2);
+  EXPECT_EQ(registry.size(big), 8);
+  EXPECT_EQ(registry.slabs(small), 1);
+
+  // big still holds more, so it gives up another slab
+  for (int i = 0; i < 4; i++) {
+    registry.add(small, 101 + i);
+  }
+  EXPECT_EQ(registry.slabs(big), 1);
+  EXPECT_EQ(registry.slabs(small), 2);
+  EXPECT_EQ(registry.size(small), 5);
+
+  // Now small holds the most and recycles its own oldest slab
+  for (int i = 0; i < 4; i++) {
+    registry.add(small, 105 + i);
+  }
+  EXPECT_EQ(registry.slabs(big), 1);
+  EXPECT_EQ(registry.size(big), 4);
+  EXPECT_EQ(registry.slabs(small), 2);
+  EXPECT_EQ(registry.size(small), 5);
+}
+
+TEST(ReplayBufferRegistryTest, MixedSampleFollowsWeights) {
+  Registry registry(make_config(8));
+  const size_t a = registry.create_buffer("a", {3.0});
+  const size_t b = registry.create_buffer("b", {1.0});
+  const size_t idle = registry.create_buffer("idle", {0.0});
+  registry.create_buffer("empty");
+  for (int i = 0; i < 8; i++) {
+    registry.add(a, i);
+  }
+  registry.add(b, 100);
+  registry.add(idle, 200);
+
+  std::map<size_t, size_t> counts;
+  const auto samples = registry.sample(20000);
+  ASSERT_EQ(samples.size(), 20000);
+  for (const auto& sample : samples) {
+    counts[sample.buffer]++;
+    EXPECT_EQ(sample.transition >= 100, sample.buffer == b);
+  }
+  EXPECT_EQ(counts.count(idle), 0);
+  EXPECT_NEAR(static_cast<double>(counts[a]) / samples.size(), 0.75, 0.02);
+
+  // P = 0.25 for b's one transition among N = 9
+  for (const auto& sample : samples) {
+    if (sample.buffer == b) {
+      EXPECT_NEAR(sample.weight, std::pow(9 * 0.25, -0.4), 1e-5);
+      break;
+    }
+  }
+}
+
+TEST(ReplayBufferRegistryTest, SampleNeedsACandidate) {
+  Registry registry(make_config(2));
+  EXPECT_THROW(registry.sample(1), std::invalid_argument);
+  const size_t id = registry.create_buffer("a");
+  EXPECT_THROW(registry.sample(1), std::invalid_argument);
+  registry.add(id, 1);
+  EXPECT_THROW(registry.sample(0), std::invalid_argument);
+  registry.set_weight(id, 0.0);
+  EXPECT_THROW(registry.sample(1), std::invalid_argument);
+}
+
+TEST(ReplayBufferRegistryTest, PrioritiesSkewSamplingWithinBuffer) {
+  replay_buffer::ReplayBufferRegistryConfig config = make_config(4, 8);
+  config.alpha = 1.0f;
+  config.epsilon = 0.0f;
+  Registry registry(config);
+  const size_t id = registry.create_buffer("a");
+  const std::vector<int> items = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  std::vector<float> td_errors(items.size(), 1.0f);
+  td_errors[9] = 9.0f;
+  registry.add_batch(id, items, td_errors);
+  EXPECT_EQ(registry.size(id), 10);
+
+  size_t hot = 0;
+  const auto samples = registry.sample(20000);
+  for (const auto& sample : samples) {
+    hot += sample.transition == 9;
+  }
+  EXPECT_NEAR(static_cast<double>(hot) / samples.size(), 0.5, 0.02);
+
+  std::vector<replay_buffer::SampleHandle> handles;
+  for (const auto& sample : samples) {
+    if (sample.transition == 9) {
+      handles.push_back(sample.handle);
+      break;
+    }
+  }
+  EXPECT_EQ(registry.update_priorities(handles, {1.0f}), 1);
+  hot = 0;
+  for (const auto& sample : registry.sample(20000)) {
+    hot += sample.transition == 9;
+  }
+  EXPECT_NEAR(hot / 20000.0, 0.1, 0.02);
+}
+
+TEST(ReplayBufferRegistryTest, UpdatesForEvictedSlotsAreStale) {
+  Registry registry(make_config(1));
+  const size_t a = registry.create_buffer("a");
+  const size_t b = registry.create_buffer("b");
+  for (int i = 0; i < 3; i++) {
+    registry.add(a, i);
+  }
+  std::vector<replay_buffer::SampleHandle> handles;
+  for (const auto& sample : registry.sample(100)) {
+    if (sample.transition == 2) {
+      handles.push_back(sample.handle);
+      break;
+    }
+  }
+  ASSERT_EQ(handles.size(), 1);
+
+  // b takes a's only slab and writes its first slot; the sampled slot is
+  // not rewritten but now belongs to b
+  registry.add(b, 100);
+  EXPECT_EQ(registry.size(a), 0);
+  EXPECT_EQ(registry.update_priorities(handles, {5.0f}), 0);
+  EXPECT_THROW(registry.update_priorities({{99, 0}}, {1.0f}),
+               std::out_of_range);
+}
+
+TEST(ReplayBufferRegistryTest, RemovedBufferReturnsSlabs) {
+  Registry registry(make_config(4));
+  const size_t id = registry.create_buffer("a");
+  for (int i = 0; i < 10; i++) {
+    registry.add(id, i);
+  }
+  EXPECT_EQ(registry.free_slabs(), 1);
+  registry.remove_buffer(id);
+  EXPECT_EQ(registry.free_slabs(), 4);
+  EXPECT_THROW(registry.size(id), std::out_of_range);
+  // The name can be reused, under a new id
+  EXPECT_NE(registry.create_buffer("a"), id);
+}
@@ -1,9 +1,17 @@
 #include <gtest/gtest.h>
 #include <replay_buffer/circular_buffer.h>
+#include <replay_buffer/thread_pool.h>
 #include <replay_buffer/transition.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <set>
+#include <span>
 #include <string>
 #include <thread>
+#include <vector>
 
 TEST(ConstructionTest, ValidCapacity) {
   replay_buffer::CircularBuffer<int> buffer(10);
@@ -99,6 +107,82 @@ TEST(AddTest, WrapsAroundWhenFull) {
   EXPECT_EQ(index_4, 0);
 }
 
+TEST(AddTest, MovesRvalues) {
+  replay_buffer::CircularBuffer<std::vector<int>> buffer(2);
+  std::vector<int> item(100, 1);
+  const int* data = item.data();
+
+  EXPECT_EQ(buffer.add(std::move(item)), 0);
+  // The storage was moved into the slot, not copied
+  EXPECT_EQ(buffer[0].data(), data);
+}
+
+TEST(AddTest, EmplaceConstructsFromArguments) {
+  replay_buffer::CircularBuffer<replay_buffer::Transition<int, int>> buffer(2);
+
+  EXPECT_EQ(buffer.emplace(1, 2, 0.5f, 3, true), 0);
+  EXPECT_EQ(buffer.emplace(4, 5, 1.5f, 6, false), 1);
+  EXPECT_EQ(buffer.emplace(7, 8, 2.5f, 9, false), 0);
+  EXPECT_EQ(buffer[0].observation, 4);
+  EXPECT_EQ(buffer[1].observation, 7);
+  EXPECT_EQ(buffer[1].next_observation, 9);
+}
+
+TEST(AddBatchTest, MatchesRepeatedAdd) {
+  replay_buffer::CircularBuffer<int> batched(5);
+  replay_buffer::CircularBuffer<int> single(5);
+  const std::vector<std::vector<int>> batches = {
+      {1, 2}, {3, 4, 5}, {6, 7, 8, 9}, {}, {10}, {11, 12, 13, 14, 15, 16, 17}};
+
+  for (const auto& batch : batches) {
+    std::vector<size_t> slots;
+    for (int item : batch) {
+      slots.push_back(single.add(item));
+    }
+    const replay_buffer::IndexRange range = batched.add_batch(batch);
+    const size_t stored = std::min<size_t>(batch.size(), 5);
+    ASSERT_EQ(range.count, stored);
+    for (size_t i = 0; i < stored; i++) {
+      EXPECT_EQ((range.first + i) % 5, slots[batch.size() - stored + i]);
+    }
+    ASSERT_EQ(batched.size(), single.size());
+    for (size_t i = 0; i < single.size(); i++) {
+      EXPECT_EQ(batched[i], single[i]);
+    }
+  }
+}
+
+TEST(AddBatchTest, SplitsAcrossWrapSeam) {
+  replay_buffer::CircularBuffer<int> buffer(4);
+  buffer.add(1);
+  buffer.add(2);
+  buffer.add(3);
+
+  const std::vector<int> items = {4, 5, 6};
+  const replay_buffer::IndexRange range = buffer.add_batch(items);
+
+  EXPECT_EQ(range.first, 3);
+  EXPECT_EQ(range.count, 3);
+  EXPECT_TRUE(buffer.is_full());
+  EXPECT_EQ(buffer[0], 3);
+  EXPECT_EQ(buffer[1], 4);
+  EXPECT_EQ(buffer[2], 5);
+  EXPECT_EQ(buffer[3], 6);
+}
+
+TEST(AddBatchTest, MovesWithMoveIterators) {
+  replay_buffer::CircularBuffer<std::vector<int>> buffer(3);
+  std::vector<std::vector<int>> items = {std::vector<int>(100, 1),
+                                         std::vector<int>(100, 2)};
+  const int* data = items[1].data();
+
+  buffer.add_batch(std::make_move_iterator(items.begin()),
+                   std::make_move_iterator(items.end()));
+
+  EXPECT_EQ(buffer.size(), 2);
+  EXPECT_EQ(buffer[1].data(), data);
+}
+
 TEST(AccessTest, OperatorBracket) {
   replay_buffer::CircularBuffer<int> buffer(3);
   buffer.add(1);
@@ -151,6 +235,40 @@ TEST(ClearTest, RemovesAllElements) {
   EXPECT_THROW(buffer.at(0), std::out_of_range);
 }
 
+TEST(ClearTest, AddAfterClear) {
+  replay_buffer::CircularBuffer<int> buffer(3);
+  buffer.add(1);
+  buffer.add(2);
+  buffer.clear();
+
+  buffer.add(3);
+  buffer.add(4);
+  buffer.add(5);
+  buffer.add(6);
+  EXPECT_EQ(buffer.size(), 3);
+  EXPECT_EQ(buffer[0], 4);
+  EXPECT_EQ(buffer[2], 6);
+  EXPECT_EQ(buffer.load(0), 4);
+  EXPECT_EQ(buffer.load(2), 6);
+}
+
+TEST(AccessTest, LoadCopiesByLogicalIndex) {
+  replay_buffer::CircularBuffer<int> buffer(3);
+  EXPECT_THROW(buffer.load(0), std::out_of_range);
+  for (int i = 1; i <= 5; i++) {
+    buffer.add(i);
+  }
+  EXPECT_EQ(buffer.load(0), 3);
+  EXPECT_EQ(buffer.load(1), 4);
+  EXPECT_EQ(buffer.load(2), 5);
+  EXPECT_THROW(buffer.load(3), std::out_of_range);
+
+  const std::vector<int> batch = {6, 7};
+  buffer.add_batch(batch);
+  EXPECT_EQ(buffer.load(0), 5);
+  EXPECT_EQ(buffer.load(2), 7);
+}
+
 TEST(WrapAroundTest, MultipleWraps) {
   replay_buffer::CircularBuffer<int> buffer(3);
   for (size_t i = 0; i < 10; i++) {
@@ -287,6 +405,64 @@ TEST(ThreadSafetyTest, ConcurrentReadsAndWrites) {
             << std::endl;
 }
 
+TEST(ThreadSafetyTest, LoadNeverReturnsTornElements) {
+  struct Payload {
+    std::array<int, 32> values;
+  };
+  replay_buffer::CircularBuffer<Payload> buffer(64);
+  Payload initial;
+  initial.values.fill(0);
+  for (int i = 0; i < 64; ++i) {
+    buffer.add(initial);
+  }
+
+  std::atomic<bool> stop(false);
+  std::atomic<int> torn(0);
+  std::atomic<int> read_count(0);
+
+  std::thread writer([&]() {
+    Payload payload;
+    int value = 1;
+    while (!stop.load()) {
+      payload.values.fill(value++);
+      buffer.add(payload);
+    }
+  });
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&, i]() {
+      int previous_newest = 0;
+      while (!stop.load()) {
+        const Payload newest = buffer.load(63);
+        const Payload middle = buffer.load(static_cast<size_t>(i) * 16);
+        for (const Payload* payload : {&newest, &middle}) {
+          for (int value : payload->values) {
+            if (value != payload->values[0]) {
+              torn++;
+            }
+          }
+        }
+        // The newest element only moves forward
+        EXPECT_GE(newest.values[0], previous_newest);
+        previous_newest = newest.values[0];
+        read_count++;
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  stop.store(true);
+
+  writer.join();
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(torn.load(), 0);
+  EXPECT_GT(read_count.load(), 0);
+}
+
 TEST(ThreadSafetyTest, ConcurrentQueries) {
   replay_buffer::CircularBuffer<int> buffer(50);
 
@@ -432,6 +608,167 @@ TEST(SamplingTest, ConcurrentSampling) {
   EXPECT_EQ(successful_samples, 1000);
 }
 
+TEST(SamplingTest, WithoutReplacementReturnsDistinctElements) {
+  replay_buffer::CircularBuffer<int> buffer(10);
+  for (int i = 0; i < 25; i++) {
+    buffer.add(i);
+  }
+
+  for (size_t batch_size : {1, 5, 10}) {
+    const std::vector<int> batch =
+        buffer.sample_without_replacement(batch_size);
+    ASSERT_EQ(batch.size(), batch_size);
+    const std::set<int> distinct(batch.begin(), batch.end());
+    EXPECT_EQ(distinct.size(), batch_size);
+    for (int value : batch) {
+      EXPECT_GE(value, 15);
+      EXPECT_LT(value, 25);
+    }
+  }
+  EXPECT_THROW(buffer.sample_without_replacement(11), std::invalid_argument);
+  EXPECT_THROW(buffer.sample_without_replacement(0), std::invalid_argument);
+}
+
+TEST(SamplingTest, WithoutReplacementIsUniform) {
+  replay_buffer::CircularBuffer<int> buffer(10);
+  for (int i = 0; i < 10; i++) {
+    buffer.add(i);
+  }
+
+  // Each element is in a batch of 3 with probability 3/10, and the first
+  // position is uniform too
+  std::vector<int> counts(10, 0);
+  std::vector<int> first_counts(10, 0);
+  for (int i = 0; i < 10000; i++) {
+    const std::vector<int> batch = buffer.sample_without_replacement(3);
+    first_counts[batch[0]]++;
+    for (int value : batch) {
+      counts[value]++;
+    }
+  }
+  for (int i = 0; i < 10; i++) {
+    EXPECT_NEAR(counts[i], 3000, 300);
+    EXPECT_NEAR(first_counts[i], 1000, 200);
+  }
+}
+
+TEST(ReservoirTest, RetainsUniformSampleOfStream) {
+  // Every one of 100 items ends up in a reservoir of 10 with probability
+  // 1/10, whether it arrived early or late
+  std::vector<int> counts(100, 0);
+  for (int trial = 0; trial < 4000; trial++) {
+    replay_buffer::CircularBuffer<int> buffer(
+        10, replay_buffer::RetentionPolicy::kReservoir);
+    for (int i = 0; i < 100; i++) {
+      buffer.add(i);
+    }
+    ASSERT_EQ(buffer.size(), 10);
+    for (size_t i = 0; i < buffer.size(); i++) {
+      counts[buffer[i]]++;
+    }
+  }
+  for (int i = 0; i < 100; i += 9) {
+    EXPECT_NEAR(counts[i], 400, 80) << "item " << i;
+  }
+}
+
+TEST(ReservoirTest, RejectedItemsReturnNpos) {
+  replay_buffer::CircularBuffer<int> buffer(
+      4, replay_buffer::RetentionPolicy::kReservoir);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(buffer.add(i), static_cast<size_t>(i));
+  }
+  size_t accepted = 0;
+  for (int i = 4; i < 10000; i++) {
+    const size_t slot = buffer.add(i);
+    if (slot != replay_buffer::CircularBuffer<int>::npos) {
+      ASSERT_LT(slot, 4u);
+      EXPECT_EQ(buffer.at_slot(slot), i);
+      accepted++;
+    }
+  }
+  // Expected accepts are sum over n of 4 / n, about 4 ln(10000 / 4) = 31
+  EXPECT_GT(accepted, 10u);
+  EXPECT_LT(accepted, 70u);
+  EXPECT_EQ(buffer.size(), 4);
+}
+
+TEST(ReservoirTest, AddBatchFillsThenOffers) {
+  replay_buffer::CircularBuffer<int> buffer(
+      8, replay_buffer::RetentionPolicy::kReservoir);
+  std::vector<int> items(1000);
+  for (int i = 0; i < 1000; i++) {
+    items[i] = i;
+  }
+  const replay_buffer::IndexRange range =
+      buffer.add_batch(std::span<const int>(items));
+  EXPECT_EQ(range.first, 0u);
+  EXPECT_EQ(range.count, 8u);
+  EXPECT_EQ(buffer.size(), 8);
+
+  // clear() starts a new stream
+  buffer.clear();
+  buffer.add(-1);
+  EXPECT_EQ(buffer.size(), 1);
+  EXPECT_EQ(buffer[0], -1);
+}
+
+TEST(SamplingTest, ParallelSampleFillsWholeBatchUniformly) {
+  // Sampling is with replacement but still capped at the buffer size, so
+  // the buffer must be large. Wrap it so head is not slot 0.
+  replay_buffer::CircularBuffer<int> buffer(16384);
+  for (int i = 0; i < 20000; i++) {
+    buffer.add(i);
+  }
+  replay_buffer::ThreadPool pool(3);
+
+  std::vector<int> counts(8, 0);
+  for (int round = 0; round < 10; round++) {
+    const std::vector<int> batch = buffer.sample(16000, pool);
+    ASSERT_EQ(batch.size(), 16000);
+    for (int value : batch) {
+      ASSERT_GE(value, 20000 - 16384);
+      ASSERT_LT(value, 20000);
+      counts[value % 8]++;
+    }
+  }
+  for (int count : counts) {
+    EXPECT_NEAR(count, 20000, 800);
+  }
+
+  // Small batches take the serial path; both validate the same way
+  EXPECT_EQ(buffer.sample(5, pool).size(), 5);
+  EXPECT_THROW(buffer.sample(20000, pool), std::invalid_argument);
+}
+
+TEST(SamplingTest, KeyedSampleIsReproducible) {
+  replay_buffer::CircularBuffer<int> buffer(16384);
+  for (int i = 0; i < 20000; i++) {
+    buffer.add(i);
+  }
+  const replay_buffer::SampleKey key{1234, 7, 0};
+  const std::vector<int> batch = buffer.sample(16000, key);
+  ASSERT_EQ(batch.size(), 16000);
+  EXPECT_EQ(buffer.sample(16000, key), batch);
+  // The same batch whatever the thread count
+  for (size_t threads : {0, 1, 3}) {
+    replay_buffer::ThreadPool pool(threads);
+    EXPECT_EQ(buffer.sample(16000, key, pool), batch);
+  }
+  // A prefix of the batch does not depend on the batch size
+  const std::vector<int> prefix = buffer.sample(10, key);
+  EXPECT_TRUE(std::equal(prefix.begin(), prefix.end(), batch.begin()));
+
+  EXPECT_NE(buffer.sample(16000, {1234, 8, 0}), batch);
+  EXPECT_NE(buffer.sample(16000, {1234, 7, 1}), batch);
+  for (int value : batch) {
+    ASSERT_GE(value, 20000 - 16384);
+    ASSERT_LT(value, 20000);
+  }
+  EXPECT_THROW(buffer.sample(0, key), std::invalid_argument);
+  EXPECT_THROW(buffer.sample(20000, key), std::invalid_argument);
+}
+
 TEST(SamplingTest, WorksWithTransitions) {
   using Transition = replay_buffer::Transition<int, int>;
   replay_buffer::CircularBuffer<Transition> buffer(10);
@@ -0,0 +1,112 @@
+#include "replay_buffer/concurrent_sum_tree.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "replay_buffer/sum_tree.h"
+
+TEST(ConcurrentSumTreeTest, InvalidArgumentsThrow) {
+  EXPECT_THROW(replay_buffer::ConcurrentSumTree(0), std::invalid_argument);
+  replay_buffer::ConcurrentSumTree tree(4);
+  EXPECT_THROW(tree.set(4, 1.0f), std::out_of_range);
+  EXPECT_THROW(tree.get(4), std::out_of_range);
+  EXPECT_THROW(tree.set(0, -1.0f), std::invalid_argument);
+  EXPECT_THROW(tree.set(0, 2e9f), std::invalid_argument);
+  tree.set(0, 1.0f);
+  EXPECT_THROW(tree.sample(1.5f), std::out_of_range);
+  EXPECT_THROW(tree.sample(-0.5f), std::out_of_range);
+}
+
+TEST(ConcurrentSumTreeTest, MatchesSumTree) {
+  replay_buffer::ConcurrentSumTree tree(10);
+  replay_buffer::SumTree reference(10);
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<float> priority(0.0f, 4.0f);
+  for (int step = 0; step < 200; step++) {
+    const size_t index = gen() % 10;
+    // Multiples of 2^-8 are exact in both representations
+    const float value = std::round(priority(gen) * 256.0f) / 256.0f;
+    tree.set(index, value);
+    reference.set(index, value);
+    EXPECT_FLOAT_EQ(tree.get(index), value);
+    EXPECT_FLOAT_EQ(tree.total(), reference.total());
+  }
+  for (float value = 0.0f; value < reference.total(); value += 0.37f) {
+    EXPECT_EQ(tree.sample(value), reference.sample(value));
+  }
+}
+
+TEST(ConcurrentSumTreeTest, NeverSamplesZeroPriorityLeaves) {
+  replay_buffer::ConcurrentSumTree tree(7);
+  tree.set(1, 1.0f);
+  tree.set(4, 2.0f);
+  // Every fixed-point prefix sum, including the total itself
+  const uint64_t total = tree.total_fixed();
+  for (uint64_t value = 0; value <= total; value += total / 1000) {
+    const size_t leaf = tree.sample_fixed(value);
+    EXPECT_TRUE(leaf == 1 || leaf == 4) << leaf;
+  }
+  EXPECT_EQ(tree.sample_fixed(total), 4);
+}
+
+TEST(ConcurrentSumTreeTest, ConcurrentSetsKeepSumsExact) {
+  const size_t capacity = 1000;
+  replay_buffer::ConcurrentSumTree tree(capacity);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < 4; t++) {
+    threads.emplace_back([&tree, t]() {
+      std::mt19937 gen(t);
+      std::uniform_real_distribution<float> priority(0.0f, 10.0f);
+      for (int i = 0; i < 20000; i++) {
+        tree.set(gen() % capacity, priority(gen));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  uint64_t expected = 0;
+  for (size_t i = 0; i < capacity; i++) {
+    expected += replay_buffer::ConcurrentSumTree::to_fixed(tree.get(i));
+  }
+  EXPECT_EQ(tree.total_fixed(), expected);
+}
+
+TEST(ConcurrentSumTreeTest, SamplesWhileUpdating) {
+  const size_t capacity = 1000;
+  replay_buffer::ConcurrentSumTree tree(capacity);
+  for (size_t i = 0; i < capacity; i++) {
+    tree.set(i, 1.0f);
+  }
+  std::atomic<bool> done{false};
+  std::thread updater([&]() {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> priority(0.5f, 2.0f);
+    for (int i = 0; i < 100000; i++) {
+      tree.set(gen() % capacity, priority(gen));
+    }
+    done = true;
+  });
+
+  std::mt19937 gen(2);
+  size_t draws = 0;
+  while (!done) {
+    const uint64_t total = tree.total_fixed();
+    const size_t leaf =
+        tree.sample_fixed(std::uniform_int_distribution<uint64_t>(
+            0, total - 1)(gen));
+    ASSERT_LT(leaf, capacity);
+    EXPECT_GT(tree.get(leaf), 0.0f);
+    draws++;
+  }
+  updater.join();
+  EXPECT_GT(draws, 0);
+}
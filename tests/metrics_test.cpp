@@ -0,0 +1,122 @@
+#include "replay_buffer/metrics.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "replay_buffer/circular_buffer.h"
+#include "replay_buffer/prioritized_replay_buffer.h"
+
+static_assert(replay_buffer::kMetricsEnabled,
+              "metrics_test must be built with REPLAY_BUFFER_ENABLE_METRICS");
+
+TEST(LatencyHistogramTest, BucketsArePowersOfTwo) {
+  EXPECT_EQ(replay_buffer::LatencyHistogram::bucket_for(0), 0);
+  EXPECT_EQ(replay_buffer::LatencyHistogram::bucket_for(1), 1);
+  EXPECT_EQ(replay_buffer::LatencyHistogram::bucket_for(2), 2);
+  EXPECT_EQ(replay_buffer::LatencyHistogram::bucket_for(3), 2);
+  EXPECT_EQ(replay_buffer::LatencyHistogram::bucket_for(1024), 11);
+}
+
+TEST(LatencyHistogramTest, PercentilesFallInsideBuckets) {
+  replay_buffer::LatencyHistogram histogram;
+  // 90 fast operations around 100ns, 10 slow ones around 10us
+  histogram.buckets[replay_buffer::LatencyHistogram::bucket_for(100)] = 90;
+  histogram.buckets[replay_buffer::LatencyHistogram::bucket_for(10000)] = 10;
+  histogram.count = 100;
+  histogram.max_ns = 12000;
+
+  EXPECT_GE(histogram.percentile(50), 64.0);
+  EXPECT_LE(histogram.percentile(50), 128.0);
+  EXPECT_GE(histogram.percentile(99), 8192.0);
+  EXPECT_LE(histogram.percentile(99), 12000.0);
+  EXPECT_DOUBLE_EQ(histogram.percentile(100), 12000.0);
+}
+
+TEST(LatencyHistogramTest, EmptyHistogramIsZero) {
+  replay_buffer::LatencyHistogram histogram;
+  EXPECT_EQ(histogram.percentile(99), 0.0);
+  EXPECT_EQ(histogram.mean_ns(), 0.0);
+}
+
+TEST(CircularBufferMetricsTest, CountsOperations) {
+  replay_buffer::CircularBuffer<int> buffer(4);
+  for (int i = 0; i < 6; i++) {
+    buffer.add(i);
+  }
+  buffer.sample(3);
+  buffer.sample(2);
+
+  const replay_buffer::MetricsSnapshot snapshot = buffer.metrics_snapshot();
+  EXPECT_EQ(snapshot.add.count, 6);
+  EXPECT_EQ(snapshot.sample.count, 2);
+  EXPECT_EQ(snapshot.samples, 5);
+  EXPECT_EQ(snapshot.evictions, 2);
+  EXPECT_EQ(snapshot.lock_wait.count, 8);
+  EXPECT_EQ(snapshot.update_priorities.count, 0);
+  EXPECT_GE(snapshot.add.max_ns, snapshot.add.percentile(50));
+}
+
+TEST(CircularBufferMetricsTest, AggregatesAcrossThreads) {
+  replay_buffer::CircularBuffer<int> buffer(100);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 20; t++) {
+    threads.emplace_back([&buffer]() {
+      for (int i = 0; i < 50; i++) {
+        buffer.add(i);
+      }
+    });
+  }
+  // Snapshots are taken while writers run
+  for (int i = 0; i < 10; i++) {
+    EXPECT_LE(buffer.metrics_snapshot().add.count, 1000);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  const replay_buffer::MetricsSnapshot snapshot = buffer.metrics_snapshot();
+  EXPECT_EQ(snapshot.add.count, 1000);
+  EXPECT_EQ(snapshot.evictions, 900);
+}
+
+TEST(PrioritizedReplayBufferMetricsTest, CountsOperations) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 4;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  for (int i = 0; i < 5; i++) {
+    buffer.add(i);
+  }
+  buffer.sample(4);
+  buffer.update_priorities({0, 1, 2}, {0.5f, 1.0f, 2.0f});
+
+  const replay_buffer::MetricsSnapshot snapshot = buffer.metrics_snapshot();
+  EXPECT_EQ(snapshot.add.count, 5);
+  EXPECT_EQ(snapshot.sample.count, 1);
+  EXPECT_EQ(snapshot.samples, 4);
+  EXPECT_EQ(snapshot.update_priorities.count, 1);
+  EXPECT_EQ(snapshot.priority_updates, 3);
+  EXPECT_EQ(snapshot.evictions, 1);
+}
+
+TEST(MetricsTest, CountsStalePriorityUpdates) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 2;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  buffer.add(0);
+  buffer.add(1);
+  const auto samples = buffer.sample(2);
+  // Overwrites slot 0
+  buffer.add(2);
+
+  std::vector<replay_buffer::SampleHandle> handles;
+  for (const auto& sample : samples) {
+    handles.push_back(sample.handle());
+  }
+  const size_t applied = buffer.update_priorities(handles, {1.0f, 1.0f});
+
+  const replay_buffer::MetricsSnapshot snapshot = buffer.metrics_snapshot();
+  EXPECT_EQ(snapshot.priority_updates, applied);
+  EXPECT_EQ(snapshot.stale_priority_updates, 2 - applied);
+}
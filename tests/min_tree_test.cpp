@@ -0,0 +1,77 @@
+#include "replay_buffer/min_tree.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+TEST(MinTreeConstructionTest, StartsAtInfinity) {
+  replay_buffer::MinTree tree(5);
+  EXPECT_EQ(tree.capacity(), 5);
+  EXPECT_EQ(tree.min(), std::numeric_limits<float>::infinity());
+  EXPECT_THROW({ replay_buffer::MinTree invalid(0); }, std::invalid_argument);
+}
+
+TEST(MinTreeSetAndGetTest, InvalidIndexThrows) {
+  replay_buffer::MinTree tree(4);
+  EXPECT_THROW(tree.set(4, 1.0f), std::out_of_range);
+  EXPECT_THROW(tree.get(4), std::out_of_range);
+}
+
+TEST(MinTreeTest, TracksMinimumAndArgmin) {
+  replay_buffer::MinTree tree(4);
+  tree.set(0, 3.0f);
+  tree.set(1, 2.0f);
+  tree.set(2, 5.0f);
+  tree.set(3, 4.0f);
+  EXPECT_FLOAT_EQ(tree.min(), 2.0f);
+  EXPECT_EQ(tree.argmin(), 1);
+
+  tree.set(1, 6.0f);
+  EXPECT_FLOAT_EQ(tree.min(), 3.0f);
+  EXPECT_EQ(tree.argmin(), 0);
+
+  // Ties go to the lowest index
+  tree.set(3, 3.0f);
+  EXPECT_EQ(tree.argmin(), 0);
+}
+
+TEST(MinTreeTest, TiesGoToSmallestSequence) {
+  replay_buffer::MinTree tree(5);
+  for (size_t i = 0; i < 5; i++) {
+    tree.set(i, 1.0f, 10 - i);
+  }
+  EXPECT_EQ(tree.argmin(), 4);
+
+  tree.set(4, 1.0f, 20);
+  EXPECT_EQ(tree.argmin(), 3);
+
+  // A lower value wins whatever its sequence
+  tree.set(0, 0.5f, 30);
+  EXPECT_EQ(tree.argmin(), 0);
+}
+
+TEST(MinTreeTest, MatchesLinearScan) {
+  // Non power-of-two capacities have leaves on two depths
+  for (size_t capacity : {1, 3, 7, 10, 100}) {
+    replay_buffer::MinTree tree(capacity);
+    std::vector<float> values(capacity, 100.0f);
+    std::mt19937 gen(static_cast<unsigned>(capacity));
+    std::uniform_real_distribution<float> dist(0.0f, 50.0f);
+    std::uniform_int_distribution<size_t> index_dist(0, capacity - 1);
+    for (size_t i = 0; i < capacity; i++) {
+      tree.set(i, values[i]);
+    }
+    for (int step = 0; step < 200; step++) {
+      const size_t index = index_dist(gen);
+      values[index] = dist(gen);
+      tree.set(index, values[index]);
+      const auto lowest = std::min_element(values.begin(), values.end());
+      ASSERT_FLOAT_EQ(tree.min(), *lowest);
+      ASSERT_EQ(tree.argmin(), static_cast<size_t>(lowest - values.begin()));
+    }
+  }
+}
@@ -0,0 +1,95 @@
+#include "replay_buffer/philox.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+#include <vector>
+
+// Known-answer vectors from the Random123 distribution (kat_vectors)
+TEST(Philox4x32Test, MatchesReferenceVectors) {
+  using replay_buffer::Philox4x32;
+  EXPECT_EQ(Philox4x32::block({0, 0, 0, 0}, {0, 0}),
+            (Philox4x32::Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c,
+                                 0x9b00dbd8}));
+  EXPECT_EQ(Philox4x32::block({0xffffffff, 0xffffffff, 0xffffffff,
+                               0xffffffff},
+                              {0xffffffff, 0xffffffff}),
+            (Philox4x32::Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6,
+                                 0x6d5451fd}));
+  EXPECT_EQ(Philox4x32::block({0x243f6a88, 0x85a308d3, 0x13198a2e,
+                               0x03707344},
+                              {0xa4093822, 0x299f31d0}),
+            (Philox4x32::Counter{0xd16cfe09, 0x94fdcceb, 0x5001e420,
+                                 0x24126ea1}));
+}
+
+TEST(Philox4x32Test, IsConstexpr) {
+  constexpr replay_buffer::Philox4x32::Counter words =
+      replay_buffer::Philox4x32::block({1, 2, 3, 4}, {5, 6});
+  static_assert(words[0] != 0 || words[1] != 0);
+  constexpr uint64_t bits = replay_buffer::detail::sample_bits({7, 8, 9}, 10);
+  EXPECT_EQ(bits, replay_buffer::detail::sample_bits({7, 8, 9}, 10));
+}
+
+TEST(Philox4x32Test, EngineWalksTheCounter) {
+  replay_buffer::Philox4x32 engine(42, 7);
+  const replay_buffer::Philox4x32::Counter first =
+      replay_buffer::Philox4x32::block({0, 0, 7, 0}, {42, 0});
+  const replay_buffer::Philox4x32::Counter second =
+      replay_buffer::Philox4x32::block({1, 0, 7, 0}, {42, 0});
+  for (uint32_t word : first) {
+    EXPECT_EQ(engine(), word);
+  }
+  for (uint32_t word : second) {
+    EXPECT_EQ(engine(), word);
+  }
+
+  // Usable with the standard distributions
+  std::uniform_int_distribution<int> dist(0, 9);
+  std::vector<int> counts(10, 0);
+  for (int i = 0; i < 10000; i++) {
+    counts[dist(engine)]++;
+  }
+  for (int count : counts) {
+    EXPECT_NEAR(count, 1000, 150);
+  }
+}
+
+TEST(Philox4x32Test, SampleIndexIsUniformAndKeyed) {
+  const replay_buffer::SampleKey key{1, 2, 3};
+  std::vector<int> counts(7, 0);
+  for (uint64_t i = 0; i < 70000; i++) {
+    const size_t index = replay_buffer::detail::scale_to_index(
+        replay_buffer::detail::sample_bits(key, i), 7);
+    ASSERT_LT(index, 7u);
+    counts[index]++;
+  }
+  for (int count : counts) {
+    EXPECT_NEAR(count, 10000, 400);
+  }
+
+  // Each key field changes the stream
+  std::set<uint64_t> bits;
+  for (const replay_buffer::SampleKey& other :
+       {replay_buffer::SampleKey{1, 2, 3}, replay_buffer::SampleKey{0, 2, 3},
+        replay_buffer::SampleKey{1, 0, 3}, replay_buffer::SampleKey{1, 2, 0}}) {
+    bits.insert(replay_buffer::detail::sample_bits(other, 0));
+  }
+  EXPECT_EQ(bits.size(), 4);
+}
+
+TEST(Philox4x32Test, ForEachSampleBitsMatchesSampleBits) {
+  const replay_buffer::SampleKey key{7, 8, 9};
+  std::vector<uint64_t> seen;
+  // Odd first and last split an element pair at both ends
+  replay_buffer::detail::for_each_sample_bits(
+      key, 3, 10, [&](uint64_t element, uint64_t bits) {
+        EXPECT_EQ(element, 3 + seen.size());
+        seen.push_back(bits);
+      });
+  ASSERT_EQ(seen.size(), 7);
+  for (uint64_t i = 0; i < seen.size(); i++) {
+    EXPECT_EQ(seen[i], replay_buffer::detail::sample_bits(key, 3 + i));
+  }
+}
@@ -1,6 +1,9 @@
 #include "replay_buffer/prioritized_replay_buffer.h"
 
+#include <cmath>
+
 #include "gtest/gtest.h"
+#include "replay_buffer/thread_pool.h"
 #include "replay_buffer/transition.h"
 
 TEST(PrioritizedReplayBufferTest, ConstructionTest) {
@@ -137,3 +140,511 @@ TEST(PrioritizedReplayBufferTest, ProportionalDistributionSampleTest) {
   EXPECT_NEAR(counts[2], 3000, 500);
   EXPECT_NEAR(counts[3], 4000, 500);
 }
+
+TEST(PrioritizedReplayBufferTest, SampleAfterWraparoundMatchesIndex) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 4;
+  config.alpha = 1.0f;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+
+  // Slot i ends up holding 4 + i, 8 + i, ...
+  for (int i = 0; i < 10; ++i) {
+    buffer.add(i);
+  }
+  buffer.update_priorities({0, 1, 2, 3}, {0.0f, 0.0f, 5.0f, 0.0f});
+
+  for (const auto& sample : buffer.sample(100)) {
+    EXPECT_EQ(sample.index, 2);
+    EXPECT_EQ(sample.transition, 6);
+  }
+}
+
+TEST(PrioritizedReplayBufferTest, AddBatchUsesGivenPriorities) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 6;
+  config.alpha = 1.0f;
+  config.beta = 0.0f;
+  config.epsilon = 0.0f;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+
+  const std::vector<int> first = {0, 1, 2, 3};
+  const std::vector<float> first_errors = {0.0f, 0.0f, 0.0f, 0.0f};
+  buffer.add_batch(first, first_errors);
+
+  // Wraps: slots 4, 5, 0, 1
+  const std::vector<int> second = {4, 5, 6, 7};
+  const std::vector<float> second_errors = {1.0f, 0.0f, -3.0f, 0.0f};
+  const replay_buffer::IndexRange range = buffer.add_batch(second,
+                                                           second_errors);
+  EXPECT_EQ(range.first, 4);
+  EXPECT_EQ(range.count, 4);
+  EXPECT_EQ(buffer.size(), 6);
+
+  std::vector<int> counts(6, 0);
+  for (const auto& sample : buffer.sample(4000)) {
+    counts[sample.index]++;
+    EXPECT_EQ(sample.transition, sample.index == 4 ? 4 : 6);
+  }
+  EXPECT_EQ(counts[4] + counts[0], 4000);
+  EXPECT_NEAR(counts[4], 1000, 200);
+  EXPECT_NEAR(counts[0], 3000, 200);
+}
+
+TEST(PrioritizedReplayBufferTest, AddBatchSizeMismatchThrows) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 4;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  const std::vector<int> items = {1, 2};
+  const std::vector<float> td_errors = {1.0f};
+  EXPECT_THROW(buffer.add_batch(items, td_errors), std::invalid_argument);
+}
+
+TEST(PrioritizedReplayBufferTest, AddBatchWithoutTdErrorsUsesMaxPriority) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 4;
+  config.alpha = 1.0f;
+  config.epsilon = 0.0f;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  const std::vector<int> first = {0};
+  const std::vector<float> first_errors = {2.0f};
+  buffer.add_batch(first, first_errors);
+
+  const std::vector<int> rest = {1, 2, 3, 4};
+  buffer.add_batch(rest);
+  // Wrapped over item 0, so all four hold the max priority seen, 2
+  EXPECT_EQ(buffer.size(), 4);
+  EXPECT_FLOAT_EQ(buffer.total_priority(), 8.0f);
+  for (const auto& sample : buffer.sample(100)) {
+    EXPECT_GE(sample.transition, 1);
+  }
+}
+
+TEST(PrioritizedReplayBufferTest, SampleWithoutReplacementIsUnique) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 8;
+  config.alpha = 1.0f;
+  config.beta = 1.0f;
+  config.epsilon = 0.0f;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  for (int i = 0; i < 8; ++i) {
+    buffer.add(i);
+  }
+  buffer.update_priorities({0, 1, 2, 3, 4, 5, 6, 7},
+                           {8.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f});
+
+  for (int round = 0; round < 100; ++round) {
+    const auto samples = buffer.sample_without_replacement(7);
+    std::vector<bool> seen(8, false);
+    for (const auto& sample : samples) {
+      EXPECT_FALSE(seen[sample.index]);
+      seen[sample.index] = true;
+      EXPECT_EQ(sample.transition, static_cast<int>(sample.index));
+      // Weights use the unmasked distribution: N * p / total = 8 * p / 14
+      const float priority = sample.index == 0 ? 8.0f : 1.0f;
+      EXPECT_FLOAT_EQ(sample.weight, 14.0f / (8.0f * priority));
+    }
+    // The zero-priority slot is never drawn
+    EXPECT_FALSE(seen[7]);
+  }
+
+  // Masked leaves were restored
+  std::vector<int> counts(8, 0);
+  for (const auto& sample : buffer.sample(14000)) {
+    counts[sample.index]++;
+  }
+  EXPECT_NEAR(counts[0], 8000, 400);
+  EXPECT_EQ(counts[7], 0);
+
+  EXPECT_THROW(buffer.sample_without_replacement(8), std::invalid_argument);
+}
+
+TEST(PrioritizedReplayBufferTest, HandlesDropStaleUpdates) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 2;
+  config.alpha = 1.0f;
+  config.beta = 0.0f;
+  config.epsilon = 0.0f;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  buffer.add(0);
+  buffer.add(1);
+
+  replay_buffer::SampleHandle slot_0{};
+  replay_buffer::SampleHandle slot_1{};
+  for (const auto& sample : buffer.sample(50)) {
+    (sample.index == 0 ? slot_0 : slot_1) = sample.handle();
+  }
+  ASSERT_NE(slot_0.generation, 0);
+  ASSERT_NE(slot_1.generation, 0);
+
+  // An actor overwrites slot 0 before the learner's update arrives
+  buffer.add(2);
+  EXPECT_EQ(buffer.update_priorities({slot_0, slot_1}, {0.0f, 0.0f}), 1);
+
+  // Slot 1 now has zero priority and slot 0 keeps the new transition's
+  // initial priority
+  for (const auto& sample : buffer.sample(50)) {
+    EXPECT_EQ(sample.index, 0);
+    EXPECT_EQ(sample.transition, 2);
+    EXPECT_EQ(sample.generation, slot_0.generation + 1);
+  }
+
+  const std::vector<replay_buffer::SampleHandle> out_of_range = {{2, 1}};
+  EXPECT_THROW(buffer.update_priorities(out_of_range, {1.0f}),
+               std::out_of_range);
+}
+
+TEST(PrioritizedReplayBufferTest, LowestPriorityEvictionKeepsHighPriorities) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 4;
+  config.alpha = 1.0f;
+  config.epsilon = 0.0f;
+  config.eviction_policy = replay_buffer::EvictionPolicy::kLowestPriority;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  for (int i = 0; i < 4; ++i) {
+    buffer.add(i);
+  }
+  // The oldest transition is the most useful one
+  buffer.update_priorities({0, 1, 2, 3}, {10.0f, 0.5f, 0.1f, 2.0f});
+
+  buffer.add(4);
+  EXPECT_EQ(buffer.size(), 4);
+  std::vector<bool> seen(5, false);
+  for (const auto& sample : buffer.sample(500)) {
+    seen[sample.transition] = true;
+  }
+  EXPECT_TRUE(seen[0]);
+  EXPECT_FALSE(seen[2]);
+  EXPECT_TRUE(seen[4]);
+
+  // A batch reuses the lowest slots too: 1 (0.5) and then 3 (2.0)
+  const std::vector<int> items = {5, 6};
+  const std::vector<float> td_errors = {20.0f, 20.0f};
+  const replay_buffer::IndexRange range = buffer.add_batch(items, td_errors);
+  EXPECT_EQ(range.count, 0);
+  std::fill(seen.begin(), seen.end(), false);
+  seen.resize(7, false);
+  for (const auto& sample : buffer.sample(500)) {
+    seen[sample.transition] = true;
+  }
+  EXPECT_TRUE(seen[0]);
+  EXPECT_FALSE(seen[1]);
+  EXPECT_FALSE(seen[3]);
+  EXPECT_TRUE(seen[5]);
+  EXPECT_TRUE(seen[6]);
+}
+
+TEST(PrioritizedReplayBufferTest, LowestPriorityEvictionTiesEvictOldest) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 4;
+  config.eviction_policy = replay_buffer::EvictionPolicy::kLowestPriority;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  // Every add shares the maximum priority, so each evicts the oldest
+  for (int i = 0; i < 10; ++i) {
+    buffer.add(i);
+  }
+  std::vector<bool> seen(12, false);
+  for (const auto& sample : buffer.sample(500)) {
+    seen[sample.transition] = true;
+  }
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(seen[i], i >= 6) << i;
+  }
+
+  // Equal priorities after an update and an alpha rebuild still keep age
+  buffer.update_priorities({0, 1, 2, 3}, {1.0f, 1.0f, 1.0f, 1.0f});
+  buffer.set_alpha(0.5f);
+  buffer.wait_for_alpha_update();
+  buffer.add(10);
+  buffer.add(11);
+  std::fill(seen.begin(), seen.end(), false);
+  for (const auto& sample : buffer.sample(500)) {
+    seen[sample.transition] = true;
+  }
+  for (int i = 0; i < 12; ++i) {
+    EXPECT_EQ(seen[i], i >= 8) << i;
+  }
+}
+
+TEST(PrioritizedReplayBufferTest, OversizedBatchFillsFreeSlotsBeforeEvicting) {
+  for (const auto policy : {replay_buffer::EvictionPolicy::kLowestPriority,
+                            replay_buffer::EvictionPolicy::kInversePriority}) {
+    replay_buffer::PrioritizedReplayBufferConfig config;
+    config.capacity = 4;
+    config.alpha = 1.0f;
+    config.epsilon = 0.0f;
+    config.eviction_policy = policy;
+    replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+
+    // Empty buffer, batch larger than capacity
+    const std::vector<int> items = {0, 1, 2, 3, 4, 5};
+    const std::vector<float> td_errors = {1.0f, 1.0f, 1.0f, 1.0f, 2.0f, 2.0f};
+    const replay_buffer::IndexRange range = buffer.add_batch(items, td_errors);
+    EXPECT_EQ(range.first, 0);
+    EXPECT_EQ(range.count, 4);
+    EXPECT_EQ(buffer.size(), 4);
+
+    // The free slots took 0..3 in order; 4 and 5 then replaced live ones
+    std::vector<bool> seen(6, false);
+    for (const auto& sample : buffer.sample(2000)) {
+      seen[sample.transition] = true;
+      EXPECT_TRUE(std::isfinite(sample.weight));
+    }
+    EXPECT_TRUE(seen[5]);
+    if (policy == replay_buffer::EvictionPolicy::kLowestPriority) {
+      // Each replaced a priority-1 slot
+      EXPECT_TRUE(seen[4]);
+      EXPECT_FLOAT_EQ(buffer.total_priority(), 6.0f);
+    }
+  }
+}
+
+TEST(PrioritizedReplayBufferTest, InversePriorityEvictionFavorsLowPriorities) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 2;
+  config.alpha = 1.0f;
+  config.epsilon = 0.0f;
+  config.eviction_policy = replay_buffer::EvictionPolicy::kInversePriority;
+
+  // Slot 0 has priority 9 and slot 1 priority 1, so slot 1 is the victim
+  // with probability (1/1) / (1/9 + 1/1) = 0.9
+  int evicted_low = 0;
+  for (int trial = 0; trial < 2000; ++trial) {
+    replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+    buffer.add(0);
+    buffer.add(1);
+    buffer.update_priorities({0, 1}, {9.0f, 1.0f});
+    buffer.add(2);
+    bool has_low = false;
+    for (const auto& sample : buffer.sample_without_replacement(2)) {
+      has_low = has_low || sample.transition == 1;
+    }
+    evicted_low += has_low ? 0 : 1;
+  }
+  EXPECT_NEAR(evicted_low, 1800, 100);
+}
+
+TEST(PrioritizedReplayBufferTest, ReservoirRetentionKeepsTreeInSync) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 16;
+  config.retention_policy = replay_buffer::RetentionPolicy::kReservoir;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+
+  std::vector<int> items(500);
+  std::vector<float> td_errors(500, 1.0f);
+  for (int i = 0; i < 500; i++) {
+    items[i] = i;
+  }
+  buffer.add_batch(items, td_errors);
+  for (int i = 500; i < 1000; i++) {
+    buffer.add(i);
+  }
+  EXPECT_EQ(buffer.size(), 16);
+
+  // Every slot holds a live item with a positive priority, and late items
+  // got in even though the buffer filled after the first 16
+  bool has_late = false;
+  for (const auto& sample : buffer.sample(256)) {
+    EXPECT_GT(sample.weight, 0.0f);
+    has_late = has_late || sample.transition >= 16;
+  }
+  EXPECT_TRUE(has_late);
+}
+
+TEST(PrioritizedReplayBufferTest, ReservoirRequiresFifoEviction) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 4;
+  config.retention_policy = replay_buffer::RetentionPolicy::kReservoir;
+  config.eviction_policy = replay_buffer::EvictionPolicy::kLowestPriority;
+  EXPECT_THROW(replay_buffer::PrioritizedReplayBuffer<int> buffer(config),
+               std::invalid_argument);
+}
+
+TEST(PrioritizedReplayBufferTest, SetBetaChangesWeights) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 2;
+  config.alpha = 1.0f;
+  config.beta = 0.0f;
+  config.epsilon = 0.0f;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  buffer.add(0);
+  buffer.add(1);
+  buffer.update_priorities({0, 1}, {1.0f, 3.0f});
+
+  for (const auto& sample : buffer.sample(8)) {
+    EXPECT_FLOAT_EQ(sample.weight, 1.0f);
+  }
+  buffer.set_beta(1.0f);
+  EXPECT_FLOAT_EQ(buffer.beta(), 1.0f);
+  // weight = (N * p / total)^-1 = (2 * 3 / 4)^-1 for slot 1
+  for (const auto& sample : buffer.sample(8)) {
+    EXPECT_FLOAT_EQ(sample.weight, sample.index == 1 ? 2.0f / 3.0f : 2.0f);
+  }
+  EXPECT_THROW(buffer.set_beta(1.5f), std::invalid_argument);
+}
+
+TEST(PrioritizedReplayBufferTest, SetAlphaReexponentiatesRawPriorities) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 4;
+  config.alpha = 1.0f;
+  config.beta = 1.0f;
+  config.epsilon = 0.0f;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  for (int i = 0; i < 4; i++) {
+    buffer.add(i);
+  }
+  buffer.update_priorities({0, 1, 2, 3}, {1.0f, 2.0f, 3.0f, 4.0f});
+
+  // With alpha 0 every priority is 1, so every weight is 1
+  buffer.set_alpha(0.0f);
+  buffer.wait_for_alpha_update();
+  EXPECT_FALSE(buffer.alpha_update_pending());
+  EXPECT_FLOAT_EQ(buffer.alpha(), 0.0f);
+  for (const auto& sample : buffer.sample(16)) {
+    EXPECT_FLOAT_EQ(sample.weight, 1.0f);
+  }
+
+  // Back to alpha 1 the raw errors are still there: slot 3 has 4 / 10
+  buffer.set_alpha(1.0f);
+  buffer.wait_for_alpha_update();
+  for (const auto& sample : buffer.sample(16)) {
+    EXPECT_FLOAT_EQ(sample.weight,
+                    10.0f / (4.0f * static_cast<float>(sample.index + 1)));
+  }
+  EXPECT_THROW(buffer.set_alpha(-0.5f), std::invalid_argument);
+}
+
+TEST(PrioritizedReplayBufferTest, SetAlphaReplaysConcurrentUpdates) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 1 << 16;
+  config.alpha = 1.0f;
+  config.beta = 1.0f;
+  config.epsilon = 0.0f;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  std::vector<int> items(config.capacity, 0);
+  std::vector<float> td_errors(config.capacity, 2.0f);
+  buffer.add_batch(items, td_errors);
+
+  // Updates and samples race with the rebuild; whichever side of the swap
+  // they land on, the final tree must reflect alpha 0
+  buffer.set_alpha(0.0f);
+  std::vector<size_t> indices;
+  std::vector<float> errors;
+  for (size_t i = 0; i < 1000; i++) {
+    indices.push_back(i * 7);
+    errors.push_back(static_cast<float>(i));
+    buffer.sample(4);
+  }
+  buffer.update_priorities(indices, errors);
+  buffer.add(1);
+  buffer.wait_for_alpha_update();
+  for (const auto& sample : buffer.sample(256)) {
+    EXPECT_FLOAT_EQ(sample.weight, 1.0f);
+  }
+}
+
+TEST(PrioritizedReplayBufferTest, ParallelSampleMatchesPriorities) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 4;
+  config.alpha = 1.0f;
+  config.beta = 1.0f;
+  config.epsilon = 0.0f;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  for (int i = 0; i < 4; i++) {
+    buffer.add(i + 1);
+  }
+  buffer.update_priorities({0, 1, 2, 3}, {1.0f, 2.0f, 3.0f, 4.0f});
+  replay_buffer::ThreadPool pool(3);
+
+  // Slot i is drawn with probability (i + 1) / 10
+  std::vector<int> counts(4, 0);
+  const auto samples = buffer.sample(20000, pool);
+  ASSERT_EQ(samples.size(), 20000);
+  for (const auto& sample : samples) {
+    ASSERT_LT(sample.index, 4u);
+    ASSERT_EQ(sample.transition, static_cast<int>(sample.index) + 1);
+    EXPECT_EQ(sample.generation, 1u);
+    EXPECT_FLOAT_EQ(sample.weight,
+                    10.0f / (4.0f * static_cast<float>(sample.index + 1)));
+    counts[sample.index]++;
+  }
+  for (int i = 0; i < 4; i++) {
+    EXPECT_NEAR(counts[i], 2000 * (i + 1), 300);
+  }
+}
+
+TEST(PrioritizedReplayBufferTest, SampleDrawsOnlyLiveSlots) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 64;
+  config.beta = 1.0f;
+  config.epsilon = 0.0f;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  replay_buffer::ThreadPool pool(3);
+  EXPECT_THROW(buffer.sample(1), std::invalid_argument);
+  EXPECT_THROW(buffer.sample(8192, pool), std::invalid_argument);
+
+  // A draw at the very top of [0, total] must still land on the only
+  // written leaf, not on the unwritten ones to its right
+  buffer.add(7);
+  for (const auto& sample : buffer.sample(8192, pool)) {
+    ASSERT_EQ(sample.index, 0);
+    ASSERT_EQ(sample.transition, 7);
+    ASSERT_TRUE(std::isfinite(sample.weight));
+  }
+  for (const auto& sample : buffer.sample(8192)) {
+    ASSERT_EQ(sample.index, 0);
+  }
+
+  // Every live priority at zero leaves nothing to draw from
+  buffer.update_priorities(std::vector<size_t>{0}, {0.0f});
+  EXPECT_THROW(buffer.sample(1), std::invalid_argument);
+  EXPECT_THROW(buffer.sample(8192, pool), std::invalid_argument);
+}
+
+TEST(PrioritizedReplayBufferTest, KeyedSampleIsReproducible) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 1000;
+  config.alpha = 1.0f;
+  config.epsilon = 0.0f;
+  replay_buffer::PrioritizedReplayBuffer<int> buffer(config);
+  const replay_buffer::SampleKey key{99, 3, 2};
+  EXPECT_THROW(buffer.sample(1, key), std::invalid_argument);
+  std::vector<size_t> indices;
+  std::vector<float> td_errors;
+  for (int i = 0; i < 1000; i++) {
+    buffer.add(i);
+    indices.push_back(i);
+    td_errors.push_back(static_cast<float>(i % 4 + 1));
+  }
+  buffer.update_priorities(indices, td_errors);
+
+  const auto batch = buffer.sample(10000, key);
+  ASSERT_EQ(batch.size(), 10000);
+  const auto same_batch = [&](const auto& other) {
+    if (other.size() != batch.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < batch.size(); i++) {
+      if (other[i].index != batch[i].index ||
+          other[i].transition != batch[i].transition ||
+          other[i].weight != batch[i].weight) {
+        return false;
+      }
+    }
+    return true;
+  };
+  EXPECT_TRUE(same_batch(buffer.sample(10000, key)));
+  for (size_t threads : {0, 1, 3}) {
+    replay_buffer::ThreadPool pool(threads);
+    EXPECT_TRUE(same_batch(buffer.sample(10000, key, pool)));
+  }
+  EXPECT_FALSE(same_batch(buffer.sample(10000, {99, 4, 2})));
+
+  // Still proportional: slots with td error 4 are drawn 4x as often as 1
+  std::vector<int> counts(4, 0);
+  for (const auto& sample : batch) {
+    ASSERT_EQ(sample.transition, static_cast<int>(sample.index));
+    counts[sample.index % 4]++;
+  }
+  EXPECT_NEAR(counts[3] / static_cast<double>(counts[0]), 4.0, 0.5);
+  EXPECT_THROW(buffer.sample(0, key), std::invalid_argument);
+}
@@ -0,0 +1,245 @@
+#include "replay_buffer/quantized_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "replay_buffer/circular_buffer.h"
+#include "replay_buffer/quantize.h"
+
+TEST(HalfConversionTest, RoundTripsExactValues) {
+  const std::vector<float> values = {0.0f,   -0.0f,   1.0f,     -2.5f,
+                                     0.125f, 65504.f, 6.1035156e-05f,
+                                     5.9604645e-08f};
+  for (const float value : values) {
+    EXPECT_EQ(replay_buffer::half_to_float(replay_buffer::float_to_half(value)),
+              value);
+  }
+}
+
+TEST(HalfConversionTest, HandlesSpecialValues) {
+  const float inf = std::numeric_limits<float>::infinity();
+  EXPECT_EQ(replay_buffer::float_to_half(inf).bits, 0x7c00);
+  EXPECT_EQ(replay_buffer::float_to_half(-inf).bits, 0xfc00);
+  EXPECT_EQ(replay_buffer::float_to_half(1e6f).bits, 0x7c00);
+  EXPECT_TRUE(std::isnan(replay_buffer::half_to_float(
+      replay_buffer::float_to_half(std::numeric_limits<float>::quiet_NaN()))));
+  EXPECT_EQ(replay_buffer::float_to_half(1e-10f).bits, 0);
+}
+
+TEST(HalfConversionTest, RoundsToNearestEven) {
+  // 1 + 2^-11 is halfway between 1 and 1 + 2^-10 and rounds to even (1)
+  EXPECT_EQ(replay_buffer::float_to_half(1.0f + 0.00048828125f).bits, 0x3c00);
+  // 1 + 3 * 2^-11 is halfway and rounds up to the even mantissa 2
+  EXPECT_EQ(replay_buffer::float_to_half(1.0f + 3 * 0.00048828125f).bits,
+            0x3c02);
+}
+
+TEST(HalfConversionTest, RelativeErrorIsBounded) {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dist(-1000.0f, 1000.0f);
+  for (int i = 0; i < 10000; i++) {
+    const float value = dist(gen);
+    const float decoded =
+        replay_buffer::half_to_float(replay_buffer::float_to_half(value));
+    EXPECT_LE(std::abs(decoded - value), std::abs(value) * 0.0005f);
+  }
+}
+
+TEST(DequantizeTest, Uint8SimdMatchesScalar) {
+  const size_t n = 37;  // exercises the vector body and the scalar tail
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> code_dist(0, 255);
+  std::uniform_real_distribution<float> param_dist(0.01f, 2.0f);
+  std::vector<uint8_t> codes(n);
+  std::vector<float> scale(n);
+  std::vector<float> offset(n);
+  for (size_t i = 0; i < n; i++) {
+    codes[i] = static_cast<uint8_t>(code_dist(gen));
+    scale[i] = param_dist(gen);
+    offset[i] = -param_dist(gen);
+  }
+  std::vector<float> expected(n);
+  std::vector<float> actual(n);
+  replay_buffer::dequantize_scalar(std::span<const uint8_t>(codes), scale,
+                                   offset, expected);
+  replay_buffer::dequantize(std::span<const uint8_t>(codes), scale, offset,
+                            actual);
+  for (size_t i = 0; i < n; i++) {
+    EXPECT_FLOAT_EQ(actual[i], expected[i]);
+  }
+}
+
+TEST(DequantizeTest, Float16SimdMatchesScalar) {
+  const size_t n = 29;
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<float> value_dist(-50.0f, 50.0f);
+  std::vector<replay_buffer::Float16> codes(n);
+  std::vector<float> scale(n, 0.5f);
+  std::vector<float> offset(n, 3.0f);
+  for (size_t i = 0; i < n; i++) {
+    codes[i] = replay_buffer::float_to_half(value_dist(gen));
+  }
+  std::vector<float> expected(n);
+  std::vector<float> actual(n);
+  replay_buffer::dequantize_scalar(
+      std::span<const replay_buffer::Float16>(codes), scale, offset, expected);
+  replay_buffer::dequantize(std::span<const replay_buffer::Float16>(codes),
+                            scale, offset, actual);
+  for (size_t i = 0; i < n; i++) {
+    EXPECT_FLOAT_EQ(actual[i], expected[i]);
+  }
+}
+
+TEST(QuantizedBufferConstructionTest, InvalidConfigThrows) {
+  replay_buffer::QuantizedBufferConfig config{0, 4, {}, {}};
+  EXPECT_THROW(replay_buffer::QuantizedBuffer<uint8_t> buffer(config),
+               std::invalid_argument);
+  config.capacity = 4;
+  config.feature_dim = 0;
+  EXPECT_THROW(replay_buffer::QuantizedBuffer<uint8_t> buffer(config),
+               std::invalid_argument);
+  config.feature_dim = 4;
+  config.scale = {1.0f, 1.0f};
+  EXPECT_THROW(replay_buffer::QuantizedBuffer<uint8_t> buffer(config),
+               std::invalid_argument);
+  config.scale = {1.0f, 1.0f, 0.0f, 1.0f};
+  EXPECT_THROW(replay_buffer::QuantizedBuffer<uint8_t> buffer(config),
+               std::invalid_argument);
+}
+
+TEST(QuantizedBufferAccuracyTest, Uint8ErrorWithinHalfStep) {
+  const size_t dim = 17;
+  replay_buffer::QuantizedBufferConfig config{100, dim, {}, {}};
+  // Feature i spans [-(i + 1), i + 1]
+  for (size_t i = 0; i < dim; i++) {
+    const float range = static_cast<float>(i + 1);
+    config.scale.push_back(2.0f * range / 255.0f);
+    config.offset.push_back(-range);
+  }
+  replay_buffer::QuantizedBuffer<uint8_t> buffer(config);
+
+  std::mt19937 gen(3);
+  std::vector<std::vector<float>> observations;
+  for (size_t n = 0; n < 100; n++) {
+    std::vector<float> observation(dim);
+    for (size_t i = 0; i < dim; i++) {
+      const float range = static_cast<float>(i + 1);
+      observation[i] = std::uniform_real_distribution<float>(-range, range)(gen);
+    }
+    buffer.add(observation);
+    observations.push_back(observation);
+  }
+
+  std::vector<float> decoded(dim);
+  for (size_t n = 0; n < 100; n++) {
+    buffer.get(n, decoded);
+    for (size_t i = 0; i < dim; i++) {
+      EXPECT_NEAR(decoded[i], observations[n][i],
+                  config.scale[i] * 0.5f + 1e-5f);
+    }
+  }
+}
+
+TEST(QuantizedBufferAccuracyTest, Uint8ClampsOutOfRangeValues) {
+  replay_buffer::QuantizedBufferConfig config{2, 2, {1.0f, 1.0f}, {0.0f, 0.0f}};
+  replay_buffer::QuantizedBuffer<uint8_t> buffer(config);
+  buffer.add(std::vector<float>{-10.0f, 1000.0f});
+  std::vector<float> decoded(2);
+  buffer.get(0, decoded);
+  EXPECT_FLOAT_EQ(decoded[0], 0.0f);
+  EXPECT_FLOAT_EQ(decoded[1], 255.0f);
+}
+
+TEST(QuantizedBufferAccuracyTest, Float16RelativeError) {
+  const size_t dim = 9;
+  replay_buffer::QuantizedBufferConfig config{10, dim, {}, {}};
+  replay_buffer::QuantizedBuffer<replay_buffer::Float16> buffer(config);
+
+  std::vector<float> observation(dim);
+  for (size_t i = 0; i < dim; i++) {
+    observation[i] = 0.37f * static_cast<float>(i) - 1.1f;
+  }
+  buffer.add(observation);
+
+  std::vector<float> decoded(dim);
+  buffer.get(0, decoded);
+  for (size_t i = 0; i < dim; i++) {
+    EXPECT_NEAR(decoded[i], observation[i],
+                std::abs(observation[i]) * 0.0005f);
+  }
+}
+
+TEST(QuantizedBufferRingTest, WrapsAndGathersBySlot) {
+  replay_buffer::QuantizedBufferConfig config{3, 2, {}, {}};
+  replay_buffer::QuantizedBuffer<uint8_t> buffer(config);
+  std::vector<size_t> slots;
+  for (int i = 1; i <= 4; i++) {
+    const float value = static_cast<float>(i);
+    slots.push_back(buffer.add(std::vector<float>{value, value * 10.0f}));
+  }
+  EXPECT_EQ(buffer.size(), 3);
+  EXPECT_TRUE(buffer.is_full());
+  EXPECT_EQ(slots, (std::vector<size_t>{0, 1, 2, 0}));
+
+  std::vector<float> decoded(2);
+  buffer.get(0, decoded);
+  EXPECT_FLOAT_EQ(decoded[0], 2.0f);
+  buffer.get(2, decoded);
+  EXPECT_FLOAT_EQ(decoded[1], 40.0f);
+  EXPECT_THROW(buffer.get(3, decoded), std::out_of_range);
+
+  const std::vector<size_t> wanted = {0, 2};
+  std::vector<float> gathered(4);
+  buffer.gather(wanted, gathered);
+  EXPECT_EQ(gathered, (std::vector<float>{4.0f, 40.0f, 3.0f, 30.0f}));
+}
+
+TEST(QuantizedBufferRingTest, ClearKeepsSlotsInStepWithCircularBuffer) {
+  replay_buffer::QuantizedBufferConfig config{3, 1, {}, {}};
+  replay_buffer::QuantizedBuffer<uint8_t> observations(config);
+  replay_buffer::CircularBuffer<int> actions(3);
+  for (int i = 0; i < 2; i++) {
+    observations.add(std::vector<float>{static_cast<float>(i)});
+    actions.add(i);
+  }
+  observations.clear();
+  actions.clear();
+  EXPECT_EQ(observations.size(), 0);
+
+  for (int i = 10; i < 14; i++) {
+    const size_t slot =
+        observations.add(std::vector<float>{static_cast<float>(i)});
+    ASSERT_EQ(actions.add(i), slot);
+    // The pair stays gatherable by the shared slot
+    std::vector<float> gathered(1);
+    observations.gather(std::vector<size_t>{slot}, gathered);
+    EXPECT_FLOAT_EQ(gathered[0], static_cast<float>(actions.at_slot(slot)));
+  }
+}
+
+TEST(QuantizedBufferSampleTest, SamplesStoredRows) {
+  replay_buffer::QuantizedBufferConfig config{8, 12, {}, {}};
+  replay_buffer::QuantizedBuffer<uint8_t> buffer(config);
+  for (int i = 0; i < 8; i++) {
+    buffer.add(std::vector<float>(12, static_cast<float>(i)));
+  }
+
+  const std::vector<float> batch = buffer.sample(8);
+  ASSERT_EQ(batch.size(), 8 * 12);
+  for (size_t row = 0; row < 8; row++) {
+    const float first = batch[row * 12];
+    EXPECT_GE(first, 0.0f);
+    EXPECT_LE(first, 7.0f);
+    for (size_t i = 1; i < 12; i++) {
+      EXPECT_EQ(batch[row * 12 + i], first);
+    }
+  }
+  EXPECT_THROW(buffer.sample(0), std::invalid_argument);
+  EXPECT_THROW(buffer.sample(9), std::invalid_argument);
+}
@@ -0,0 +1,166 @@
+#include "replay_buffer/rate_limiter.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "replay_buffer/circular_buffer.h"
+#include "replay_buffer/prioritized_replay_buffer.h"
+
+namespace {
+using namespace std::chrono_literals;
+
+replay_buffer::RateLimiterConfig make_config(double samples_per_insert,
+                                             size_t min_size,
+                                             double tolerance) {
+  replay_buffer::RateLimiterConfig config;
+  config.samples_per_insert = samples_per_insert;
+  config.min_size_to_sample = min_size;
+  config.error_tolerance = tolerance;
+  return config;
+}
+}  // namespace
+
+TEST(RateLimiterTest, InvalidConfigThrows) {
+  EXPECT_THROW(replay_buffer::RateLimiter(make_config(0.0, 1, 1.0)),
+               std::invalid_argument);
+  EXPECT_THROW(replay_buffer::RateLimiter(make_config(1.0, 1, -1.0)),
+               std::invalid_argument);
+}
+
+TEST(RateLimiterTest, SamplingWaitsForMinSize) {
+  replay_buffer::RateLimiter limiter(make_config(1.0, 3, 10.0));
+  limiter.acquire_insert(2);
+  EXPECT_FALSE(limiter.try_acquire_sample(1, 1ms));
+  limiter.acquire_insert();
+  EXPECT_TRUE(limiter.try_acquire_sample(1, 1ms));
+}
+
+TEST(RateLimiterTest, EnforcesRatioWithinTolerance) {
+  // Two samples per insert, one insert of slack after a fill of 2
+  replay_buffer::RateLimiter limiter(make_config(2.0, 2, 2.0));
+  limiter.acquire_insert(2);  // diff 4 = target
+  EXPECT_TRUE(limiter.try_acquire_insert(1, 0ns));   // diff 6 = target + 2
+  EXPECT_TRUE(limiter.try_acquire_insert(1, 0ns));   // checked at diff 6
+  EXPECT_FALSE(limiter.try_acquire_insert(1, 0ns));  // diff 8 is too far
+
+  for (int i = 0; i < 7; i++) {
+    EXPECT_TRUE(limiter.try_acquire_sample(1, 0ns));  // checked down to 2
+  }
+  EXPECT_FALSE(limiter.try_acquire_sample(1, 0ns));  // diff 1 is too low
+  EXPECT_TRUE(limiter.try_acquire_insert(1, 0ns));
+  EXPECT_TRUE(limiter.try_acquire_sample(1, 0ns));
+
+  const replay_buffer::RateLimiterStats stats = limiter.stats();
+  EXPECT_EQ(stats.inserts, 5);
+  EXPECT_EQ(stats.samples, 8);
+  EXPECT_EQ(stats.insert_waits, 1);
+  EXPECT_EQ(stats.sample_waits, 1);
+}
+
+TEST(RateLimiterTest, BlockedInsertResumesAfterSample) {
+  replay_buffer::RateLimiter limiter(make_config(1.0, 1, 0.0));
+  limiter.acquire_insert();
+  limiter.acquire_insert();  // checked at diff 1 = target
+  std::atomic<bool> inserted{false};
+  std::thread actor([&]() {
+    limiter.acquire_insert();
+    inserted = true;
+  });
+  std::this_thread::sleep_for(20ms);
+  EXPECT_FALSE(inserted);
+  limiter.acquire_sample(1);
+  actor.join();
+  EXPECT_TRUE(inserted);
+
+  const replay_buffer::RateLimiterStats stats = limiter.stats();
+  EXPECT_EQ(stats.insert_waits, 1);
+  EXPECT_GE(stats.insert_blocked, 10ms);
+  EXPECT_EQ(stats.sample_blocked, 0ns);
+}
+
+TEST(RateLimiterTest, CloseWakesBlockedCallers) {
+  replay_buffer::RateLimiter limiter(make_config(1.0, 10, 0.0));
+  std::atomic<bool> failed{false};
+  std::thread learner([&]() {
+    try {
+      limiter.acquire_sample(1);
+    } catch (const std::runtime_error&) {
+      failed = true;
+    }
+  });
+  std::this_thread::sleep_for(10ms);
+  limiter.close();
+  learner.join();
+  EXPECT_TRUE(failed);
+  EXPECT_THROW(limiter.acquire_insert(), std::runtime_error);
+}
+
+TEST(RateLimitedReplayBufferTest, KeepsActorAndLearnerAtTargetRatio) {
+  const double samples_per_insert = 4.0;
+  const double tolerance = 64.0;
+  replay_buffer::RateLimitedReplayBuffer<replay_buffer::CircularBuffer<int>>
+      buffer(make_config(samples_per_insert, 100, tolerance), 10000);
+  const int batch_size = 32;
+
+  std::atomic<bool> stop{false};
+  std::thread actor([&]() {
+    for (int i = 0; !stop; i++) {
+      if (!buffer.try_add(i, 1ms) && stop) {
+        return;
+      }
+    }
+  });
+  for (int step = 0; step < 200; step++) {
+    EXPECT_EQ(buffer.sample(batch_size).size(), batch_size);
+  }
+  stop = true;
+  actor.join();
+
+  // A fast actor is held to the learner's pace: samples trail inserts by
+  // at most one batch beyond the window
+  const replay_buffer::RateLimiterStats stats = buffer.stats();
+  const double diff =
+      static_cast<double>(stats.inserts) * samples_per_insert -
+      static_cast<double>(stats.samples);
+  EXPECT_LE(diff, samples_per_insert * 100 + tolerance + samples_per_insert);
+  EXPECT_GE(diff, samples_per_insert * 100 - tolerance - batch_size);
+  EXPECT_GT(stats.insert_waits, 0);
+}
+
+TEST(RateLimitedReplayBufferTest, FailedSampleIsNotCounted) {
+  replay_buffer::RateLimitedReplayBuffer<replay_buffer::CircularBuffer<int>>
+      buffer(make_config(100.0, 1, 1000.0), 4);
+  buffer.add(1);
+  // Allowed by the limiter but larger than the buffer
+  EXPECT_THROW(buffer.sample(2), std::invalid_argument);
+  EXPECT_EQ(buffer.stats().samples, 0);
+  EXPECT_EQ(buffer.sample(1).size(), 1);
+  EXPECT_EQ(buffer.stats().samples, 1);
+}
+
+TEST(RateLimitedReplayBufferTest, ForwardsPrioritizedOperations) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 4;
+  replay_buffer::RateLimitedReplayBuffer<
+      replay_buffer::PrioritizedReplayBuffer<int>>
+      buffer(make_config(1.0, 1, 10.0), config);
+  const std::vector<int> items = {1, 2, 3};
+  const std::vector<float> td_errors = {1.0f, 2.0f, 3.0f};
+  buffer.add_batch(std::span<const int>(items),
+                   std::span<const float>(td_errors));
+  EXPECT_EQ(buffer.stats().inserts, 3);
+
+  const auto samples = buffer.sample(3);
+  std::vector<replay_buffer::SampleHandle> handles;
+  for (const auto& sample : samples) {
+    handles.push_back({sample.index, sample.generation});
+  }
+  EXPECT_EQ(buffer.update_priorities(handles, std::vector<float>(3, 1.0f)),
+            3);
+  EXPECT_EQ(buffer.stats().samples, 3);
+}
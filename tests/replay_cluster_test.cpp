@@ -0,0 +1,287 @@
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "replay_buffer/replay_server.h"
+#include "replay_buffer/sharded_replay_client.h"
+
+namespace {
+/// @brief Runs each shard in its own process, as a cluster would, and kills
+/// them all on destruction.
+class LocalCluster {
+ public:
+  LocalCluster(size_t shards, size_t capacity) {
+    for (size_t i = 0; i < shards; i++) {
+      int ports[2];
+      if (pipe(ports) != 0) {
+        throw std::runtime_error("pipe failed");
+      }
+      const pid_t child = fork();
+      if (child < 0) {
+        throw std::runtime_error("fork failed");
+      }
+      if (child == 0) {
+        close(ports[0]);
+        replay_buffer::ReplayServer<int> server(
+            {.capacity = capacity, .alpha = 1.0f, .epsilon = 0.0f});
+        const uint16_t port = server.port();
+        if (write(ports[1], &port, sizeof(port)) != sizeof(port)) {
+          _exit(1);
+        }
+        close(ports[1]);
+        while (true) {
+          pause();
+        }
+      }
+      close(ports[1]);
+      uint16_t port = 0;
+      const ssize_t received = read(ports[0], &port, sizeof(port));
+      close(ports[0]);
+      pids_.push_back(child);
+      if (received != sizeof(port)) {
+        throw std::runtime_error("Shard failed to start");
+      }
+      config_.shards.push_back({"127.0.0.1", port});
+    }
+    config_.beta = 1.0f;
+    config_.refresh_interval = std::chrono::milliseconds(0);
+  }
+
+  ~LocalCluster() {
+    for (pid_t pid : pids_) {
+      kill(pid, SIGKILL);
+      waitpid(pid, nullptr, 0);
+    }
+  }
+
+  const replay_buffer::ShardedReplayClientConfig& config() const {
+    return config_;
+  }
+
+ private:
+  std::vector<pid_t> pids_;
+  replay_buffer::ShardedReplayClientConfig config_;
+};
+}  // namespace
+
+TEST(ReplayClusterTest, RejectsInvalidConfig) {
+  replay_buffer::ShardedReplayClientConfig config;
+  EXPECT_THROW(replay_buffer::ShardedReplayClient<int>{config},
+               std::invalid_argument);
+  config.shards.push_back({"127.0.0.1", 1});
+  config.beta = 1.5f;
+  EXPECT_THROW(replay_buffer::ShardedReplayClient<int>{config},
+               std::invalid_argument);
+}
+
+TEST(ReplayClusterTest, AddsRoundRobinAcrossShards) {
+  LocalCluster cluster(3, 64);
+  replay_buffer::ShardedReplayClient<int> client(cluster.config());
+  EXPECT_EQ(client.shard_count(), 3);
+  EXPECT_EQ(client.size(), 0);
+
+  const std::vector<int> items = {1, 2, 3, 4};
+  for (size_t i = 0; i < 6; i++) {
+    EXPECT_EQ(client.add_batch(items), i % 3);
+  }
+  EXPECT_EQ(client.size(), 0);  // cached until refreshed
+  client.refresh_totals();
+  EXPECT_EQ(client.size(), 24);
+  for (float total : client.shard_totals()) {
+    EXPECT_GT(total, 0.0f);
+  }
+}
+
+TEST(ReplayClusterTest, SamplesInProportionToShardTotals) {
+  LocalCluster cluster(3, 64);
+  replay_buffer::ShardedReplayClient<int> client(cluster.config());
+  // Shard s holds items s * 100 + [0, 10), each with priority s + 1
+  for (int shard = 0; shard < 3; shard++) {
+    std::vector<int> items(10);
+    for (int i = 0; i < 10; i++) {
+      items[i] = shard * 100 + i;
+    }
+    client.add_batch(items,
+                     std::vector<float>(10, static_cast<float>(shard + 1)));
+  }
+  EXPECT_THROW(client.sample(1), std::invalid_argument);  // totals are stale
+  client.refresh_totals();
+  const std::vector<float> totals = client.shard_totals();
+  EXPECT_FLOAT_EQ(totals[0], 10.0f);
+  EXPECT_FLOAT_EQ(totals[1], 20.0f);
+  EXPECT_FLOAT_EQ(totals[2], 30.0f);
+
+  std::array<size_t, 3> counts{};
+  const size_t batches = 200;
+  const size_t batch_size = 64;
+  for (size_t b = 0; b < batches; b++) {
+    const auto samples = client.sample(batch_size);
+    ASSERT_EQ(samples.size(), batch_size);
+    for (const auto& sample : samples) {
+      const size_t shard = sample.handle.shard;
+      ASSERT_LT(shard, 3);
+      EXPECT_EQ(sample.transition / 100, static_cast<int>(shard));
+      counts[shard]++;
+      // P = (shard + 1) / 60 and N = 30, so with beta = 1 the weight is
+      // 2 / (shard + 1)
+      EXPECT_NEAR(sample.weight, 2.0f / static_cast<float>(shard + 1), 1e-4f);
+    }
+  }
+  const double drawn = static_cast<double>(batches * batch_size);
+  EXPECT_NEAR(counts[0] / drawn, 1.0 / 6.0, 0.02);
+  EXPECT_NEAR(counts[1] / drawn, 2.0 / 6.0, 0.02);
+  EXPECT_NEAR(counts[2] / drawn, 3.0 / 6.0, 0.02);
+}
+
+TEST(ReplayClusterTest, RoutesPriorityUpdatesToOwningShard) {
+  LocalCluster cluster(2, 64);
+  replay_buffer::ShardedReplayClient<int> client(cluster.config());
+  client.add_batch(std::vector<int>{0, 1, 2, 3}, std::vector<float>(4, 1.0f));
+  client.add_batch(std::vector<int>{100, 101, 102, 103},
+                   std::vector<float>(4, 1.0f));
+  client.refresh_totals();
+
+  const auto samples = client.sample(32);
+  std::vector<replay_buffer::ShardedSampleHandle> handles;
+  std::vector<float> td_errors;
+  for (const auto& sample : samples) {
+    if (sample.handle.shard == 1) {
+      handles.push_back(sample.handle);
+      td_errors.push_back(5.0f);
+    }
+  }
+  ASSERT_FALSE(handles.empty());
+  EXPECT_EQ(client.update_priorities(handles, td_errors), handles.size());
+
+  client.refresh_totals();
+  const std::vector<float> totals = client.shard_totals();
+  EXPECT_FLOAT_EQ(totals[0], 4.0f);
+  EXPECT_GT(totals[1], 4.0f);
+}
+
+TEST(ReplayClusterTest, DropsUpdatesForOverwrittenTransitions) {
+  LocalCluster cluster(1, 4);
+  replay_buffer::ShardedReplayClient<int> client(cluster.config());
+  client.add_batch(std::vector<int>{0, 1, 2, 3});
+  client.refresh_totals();
+  const auto samples = client.sample(4);
+
+  client.add_batch(std::vector<int>{4, 5, 6, 7});  // overwrites every slot
+  std::vector<replay_buffer::ShardedSampleHandle> handles;
+  for (const auto& sample : samples) {
+    handles.push_back(sample.handle);
+  }
+  EXPECT_EQ(client.update_priorities(handles, std::vector<float>(4, 9.0f)), 0);
+}
+
+TEST(ReplayClusterTest, ReportsShardErrors) {
+  LocalCluster cluster(2, 4);
+  replay_buffer::ShardedReplayClient<int> client(cluster.config());
+  client.add_batch(std::vector<int>{0, 1});
+  client.add_batch(std::vector<int>{2, 3});
+  client.refresh_totals();
+
+  // Index out of range on the shard itself
+  EXPECT_THROW(client.update_priorities({{1, {99, 0}}}, {1.0f}),
+               std::runtime_error);
+  EXPECT_THROW(client.update_priorities({{2, {0, 0}}}, {1.0f}),
+               std::out_of_range);
+  // The connections stay usable after an error
+  EXPECT_EQ(client.sample(8).size(), 8);
+}
+
+TEST(ReplayClusterTest, BackgroundRefreshPicksUpNewTotals) {
+  LocalCluster cluster(2, 16);
+  auto config = cluster.config();
+  config.refresh_interval = std::chrono::milliseconds(5);
+  replay_buffer::ShardedReplayClient<int> client(config);
+  client.add_batch(std::vector<int>{0, 1, 2});
+
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (client.size() != 3 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(client.size(), 3);
+}
+
+TEST(ReplayClusterTest, InProcessServerStopsCleanly) {
+  replay_buffer::ReplayServer<int> server({.capacity = 8});
+  replay_buffer::ShardedReplayClientConfig config;
+  config.shards.push_back({"localhost", server.port()});
+  config.refresh_interval = std::chrono::milliseconds(0);
+  {
+    replay_buffer::ShardedReplayClient<int> client(config);
+    client.add(42);
+    EXPECT_EQ(server.buffer().size(), 1);
+  }
+  replay_buffer::ShardedReplayClient<int> client(config);
+  server.stop();
+  EXPECT_THROW(client.add(7), std::exception);
+}
+
+TEST(ReplayClusterTest, ServerClosesDisconnectedClients) {
+  replay_buffer::ReplayServer<int> server({.capacity = 8});
+  replay_buffer::ShardedReplayClientConfig config;
+  config.shards.push_back({"127.0.0.1", server.port()});
+  config.refresh_interval = std::chrono::milliseconds(0);
+  for (int i = 0; i < 5; i++) {
+    replay_buffer::ShardedReplayClient<int> client(config);
+    client.add(i);
+  }
+  replay_buffer::ShardedReplayClient<int> client(config);
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (server.connection_count() != 1 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(server.connection_count(), 1);
+  EXPECT_EQ(client.sample(4).size(), 4);
+}
+
+TEST(ReplayClusterTest, ShardRejectsBadSampleRequests) {
+  replay_buffer::ReplayServer<int> server(
+      {.capacity = 8, .alpha = 1.0f, .epsilon = 0.0f});
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(fd, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(server.port());
+  inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+  ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address),
+                    sizeof(address)),
+            0);
+  const auto sample_status = [fd](uint64_t batch_size) {
+    replay_buffer::detail::MessageWriter request;
+    request.put(batch_size);
+    request.send(fd,
+                 static_cast<uint32_t>(replay_buffer::detail::ReplayOp::kSample));
+    replay_buffer::detail::MessageReader reply;
+    EXPECT_TRUE(reply.receive(fd));
+    return static_cast<replay_buffer::detail::ReplayStatus>(reply.code());
+  };
+  using replay_buffer::detail::ReplayStatus;
+
+  // Empty shard
+  EXPECT_EQ(sample_status(1), ReplayStatus::kError);
+  server.buffer().add(1);
+  EXPECT_EQ(sample_status(replay_buffer::detail::kMaxSampleBatch + 1),
+            ReplayStatus::kError);
+  EXPECT_EQ(sample_status(0), ReplayStatus::kError);
+  EXPECT_EQ(sample_status(2), ReplayStatus::kOk);
+  // All priorities zeroed leaves nothing to sample either
+  server.buffer().update_priorities(std::vector<size_t>{0}, {0.0f});
+  EXPECT_EQ(sample_status(1), ReplayStatus::kError);
+  close(fd);
+}
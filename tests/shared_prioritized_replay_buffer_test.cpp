@@ -0,0 +1,155 @@
+#include "replay_buffer/shared_prioritized_replay_buffer.h"
+
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+
+#include "replay_buffer/transition.h"
+
+namespace {
+std::string unique_name(const std::string& test) {
+  return "/replay_buffer_" + test + "_" + std::to_string(getpid());
+}
+}  // namespace
+
+TEST(SharedPrioritizedReplayBufferTest, CreateAndOpen) {
+  const std::string name = unique_name("create");
+  auto buffer =
+      replay_buffer::SharedPrioritizedReplayBuffer<int>::create(
+          name, {.capacity = 8});
+  EXPECT_EQ(buffer.capacity(), 8);
+  EXPECT_EQ(buffer.size(), 0);
+
+  auto attached = replay_buffer::SharedPrioritizedReplayBuffer<int>::open(name);
+  EXPECT_EQ(attached.capacity(), 8);
+
+  // The name is taken until unlinked
+  EXPECT_THROW(replay_buffer::SharedPrioritizedReplayBuffer<int>::create(
+                   name, {.capacity = 8}),
+               std::system_error);
+  replay_buffer::SharedPrioritizedReplayBuffer<int>::unlink(name);
+  EXPECT_THROW(replay_buffer::SharedPrioritizedReplayBuffer<int>::open(name),
+               std::system_error);
+}
+
+TEST(SharedPrioritizedReplayBufferTest, OpenRejectsOtherTypes) {
+  const std::string name = unique_name("types");
+  auto buffer = replay_buffer::SharedPrioritizedReplayBuffer<int>::create(
+      name, {.capacity = 8});
+  EXPECT_THROW(
+      replay_buffer::SharedPrioritizedReplayBuffer<double>::open(name),
+      std::runtime_error);
+  replay_buffer::SharedPrioritizedReplayBuffer<int>::unlink(name);
+}
+
+TEST(SharedPrioritizedReplayBufferTest, AddSampleAndUpdate) {
+  const std::string name = unique_name("ops");
+  const replay_buffer::PrioritizedReplayBufferConfig config{
+      .capacity = 4, .alpha = 1.0f, .beta = 0.0f};
+  auto buffer =
+      replay_buffer::SharedPrioritizedReplayBuffer<int>::create(name, config);
+  replay_buffer::SharedPrioritizedReplayBuffer<int>::unlink(name);
+
+  for (int i = 0; i < 6; i++) {
+    buffer.add(i);
+  }
+  EXPECT_EQ(buffer.size(), 4);
+
+  // Slots 0 and 1 hold the overwriting items 4 and 5
+  buffer.update_priorities({0, 1, 2, 3}, {0.0f, 0.0f, 0.0f, 10.0f});
+  for (const auto& sample : buffer.sample(50)) {
+    EXPECT_EQ(sample.index, 3);
+    EXPECT_EQ(sample.transition, 3);
+  }
+  EXPECT_TRUE(buffer.is_consistent());
+}
+
+TEST(SharedPrioritizedReplayBufferTest, SamplesOnlyLiveSlots) {
+  const std::string name = unique_name("live");
+  replay_buffer::PrioritizedReplayBufferConfig config{.capacity = 8,
+                                                      .beta = 1.0f};
+  auto buffer =
+      replay_buffer::SharedPrioritizedReplayBuffer<int>::create(name, config);
+  replay_buffer::SharedPrioritizedReplayBuffer<int>::unlink(name);
+  buffer.add(7);
+
+  // Every draw, including one at the very top of [0, total], lands on the
+  // only written leaf
+  for (const auto& sample : buffer.sample(20000)) {
+    ASSERT_EQ(sample.index, 0);
+    ASSERT_EQ(sample.transition, 7);
+    ASSERT_TRUE(std::isfinite(sample.weight));
+  }
+
+  config.epsilon = 0.0f;
+  auto zeroed = replay_buffer::SharedPrioritizedReplayBuffer<int>::create(
+      name, config);
+  replay_buffer::SharedPrioritizedReplayBuffer<int>::unlink(name);
+  zeroed.add(1);
+  zeroed.update_priorities({0}, {0.0f});
+  EXPECT_THROW(zeroed.sample(1), std::invalid_argument);
+}
+
+TEST(SharedPrioritizedReplayBufferTest, SharesDataAcrossProcesses) {
+  const std::string name = unique_name("fork");
+  auto buffer =
+      replay_buffer::SharedPrioritizedReplayBuffer<
+          replay_buffer::Transition<int, int>>::create(name, {.capacity = 64});
+
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    auto attached = replay_buffer::SharedPrioritizedReplayBuffer<
+        replay_buffer::Transition<int, int>>::open(name);
+    for (int i = 0; i < 10; i++) {
+      attached.add({i, i, 1.0f, i + 1, false});
+    }
+    _exit(0);
+  }
+  int status = 0;
+  waitpid(child, &status, 0);
+  ASSERT_TRUE(WIFEXITED(status));
+  replay_buffer::SharedPrioritizedReplayBuffer<
+      replay_buffer::Transition<int, int>>::unlink(name);
+
+  EXPECT_EQ(buffer.size(), 10);
+  for (const auto& sample : buffer.sample(20)) {
+    EXPECT_EQ(sample.transition.next_observation,
+              sample.transition.observation + 1);
+  }
+}
+
+TEST(SharedPrioritizedReplayBufferTest, SurvivesWriterKilledMidOperation) {
+  const std::string name = unique_name("kill");
+  auto buffer = replay_buffer::SharedPrioritizedReplayBuffer<int>::create(
+      name, {.capacity = 128});
+
+  for (int round = 0; round < 5; round++) {
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+      auto attached =
+          replay_buffer::SharedPrioritizedReplayBuffer<int>::open(name);
+      for (int i = 0;; i++) {
+        attached.add(i);
+        attached.update_priorities({static_cast<size_t>(i % 128)},
+                                   {static_cast<float>(i % 7)});
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+
+    // Must not deadlock even if the child died holding the lock
+    buffer.add(-1);
+    EXPECT_TRUE(buffer.is_consistent());
+    EXPECT_FALSE(buffer.sample(8).empty());
+  }
+  replay_buffer::SharedPrioritizedReplayBuffer<int>::unlink(name);
+}
@@ -0,0 +1,174 @@
+#include "replay_buffer/staging_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "replay_buffer/circular_buffer.h"
+#include "replay_buffer/prioritized_replay_buffer.h"
+
+namespace {
+using namespace std::chrono_literals;
+using StagedCircularBuffer =
+    replay_buffer::StagedReplayBuffer<replay_buffer::CircularBuffer<int>>;
+using StagedPrioritizedBuffer = replay_buffer::StagedReplayBuffer<
+    replay_buffer::PrioritizedReplayBuffer<int>>;
+
+// Fails every add_batch() while fail is set
+struct FlakyBuffer {
+  using value_type = int;
+
+  void add_batch(std::span<const int> batch) {
+    if (fail) {
+      throw std::runtime_error("Buffer unavailable");
+    }
+    items.insert(items.end(), batch.begin(), batch.end());
+  }
+
+  bool fail = false;
+  std::vector<int> items;
+};
+
+replay_buffer::StagingConfig make_config(size_t max_batch,
+                                         std::chrono::microseconds max_delay) {
+  replay_buffer::StagingConfig config;
+  config.max_batch = max_batch;
+  config.max_delay = max_delay;
+  return config;
+}
+}  // namespace
+
+TEST(StagingBufferTest, InvalidConfigThrows) {
+  EXPECT_THROW(StagedCircularBuffer(make_config(0, 0us), 8),
+               std::invalid_argument);
+  EXPECT_THROW(StagedCircularBuffer(make_config(4, -1us), 8),
+               std::invalid_argument);
+}
+
+TEST(StagingBufferTest, FlushesWhenBatchIsFull) {
+  StagedCircularBuffer staged(make_config(4, 0us), 16);
+  auto writer = staged.writer();
+  for (int i = 0; i < 3; i++) {
+    writer.add(i);
+  }
+  EXPECT_EQ(staged.buffer().size(), 0);
+  EXPECT_EQ(writer.staged(), 3);
+
+  writer.add(3);
+  EXPECT_EQ(staged.buffer().size(), 4);
+  EXPECT_EQ(writer.staged(), 0);
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_EQ(staged.buffer()[i], static_cast<int>(i));
+  }
+  const replay_buffer::StagingStats stats = staged.stats();
+  EXPECT_EQ(stats.items, 4);
+  EXPECT_EQ(stats.size_flushes, 1);
+}
+
+TEST(StagingBufferTest, ExplicitAndFinalFlushes) {
+  StagedCircularBuffer staged(make_config(100, 0us), 16);
+  auto first = staged.writer();
+  first.add(1);
+  first.flush();
+  EXPECT_EQ(staged.buffer().size(), 1);
+
+  {
+    auto second = staged.writer();
+    second.add(2);
+    first.add(3);
+    staged.flush();
+    EXPECT_EQ(staged.buffer().size(), 3);
+    second.add(4);
+  }
+  // Destroying a writer publishes what it still holds
+  EXPECT_EQ(staged.buffer().size(), 4);
+  EXPECT_EQ(staged.stats().explicit_flushes, 4);
+}
+
+TEST(StagingBufferTest, FlusherBoundsVisibilityLatency) {
+  StagedCircularBuffer staged(make_config(100, 5000us), 16);
+  auto writer = staged.writer();
+  const auto start = std::chrono::steady_clock::now();
+  writer.add(1);
+  while (staged.buffer().size() == 0 &&
+         std::chrono::steady_clock::now() - start < 5s) {
+    std::this_thread::sleep_for(1ms);
+  }
+  EXPECT_EQ(staged.buffer().size(), 1);
+  EXPECT_EQ(staged.stats().timed_flushes, 1);
+  EXPECT_EQ(writer.staged(), 0);
+}
+
+TEST(StagingBufferTest, PrioritizedWriterKeepsTdErrors) {
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 8;
+  config.alpha = 1.0f;
+  config.epsilon = 0.0f;
+  StagedPrioritizedBuffer staged(make_config(3, 0us), config);
+  auto writer = staged.writer();
+  writer.add(0, 1.0f);
+  writer.add(1, -2.0f);
+  EXPECT_EQ(staged.buffer().size(), 0);
+
+  // Switching to max-priority adds publishes the TD-error batch first
+  writer.add(2);
+  EXPECT_EQ(staged.buffer().size(), 2);
+  EXPECT_FLOAT_EQ(staged.buffer().total_priority(), 3.0f);
+  writer.flush();
+  EXPECT_EQ(staged.buffer().size(), 3);
+  EXPECT_FLOAT_EQ(staged.buffer().total_priority(), 5.0f);
+}
+
+TEST(StagingBufferTest, ConcurrentWritersPublishEverything) {
+  constexpr int kWriters = 4;
+  constexpr int kItemsPerWriter = 1000;
+  StagedCircularBuffer staged(make_config(64, 0us),
+                              kWriters * kItemsPerWriter);
+  std::vector<std::thread> actors;
+  for (int t = 0; t < kWriters; t++) {
+    actors.emplace_back([&staged, t]() {
+      auto writer = staged.writer();
+      for (int i = 0; i < kItemsPerWriter; i++) {
+        writer.add(t * kItemsPerWriter + i);
+      }
+    });
+  }
+  for (std::thread& actor : actors) {
+    actor.join();
+  }
+
+  EXPECT_EQ(staged.buffer().size(), kWriters * kItemsPerWriter);
+  std::vector<int> seen(kWriters * kItemsPerWriter, 0);
+  for (size_t i = 0; i < staged.buffer().size(); i++) {
+    seen[staged.buffer()[i]]++;
+  }
+  for (int count : seen) {
+    EXPECT_EQ(count, 1);
+  }
+  const replay_buffer::StagingStats stats = staged.stats();
+  EXPECT_EQ(stats.items, kWriters * kItemsPerWriter);
+  // One buffer lock per 64 items, plus each writer's final partial batch
+  EXPECT_EQ(stats.size_flushes, kWriters * (kItemsPerWriter / 64));
+  EXPECT_EQ(stats.explicit_flushes, kWriters);
+}
+
+TEST(StagingBufferTest, FailedFinalFlushKeepsItemsStaged) {
+  replay_buffer::StagedReplayBuffer<FlakyBuffer> staged(make_config(8, 0us));
+  staged.buffer().fail = true;
+  {
+    auto writer = staged.writer();
+    writer.add(1);
+    writer.add(2);
+    EXPECT_THROW(writer.flush(), std::runtime_error);
+    // Destroying the writer must not throw
+  }
+  EXPECT_THROW(staged.flush(), std::runtime_error);
+
+  staged.buffer().fail = false;
+  staged.flush();
+  EXPECT_EQ(staged.buffer().items, (std::vector<int>{1, 2}));
+}
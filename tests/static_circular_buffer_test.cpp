@@ -0,0 +1,93 @@
+#include "replay_buffer/static_circular_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "replay_buffer/circular_buffer.h"
+
+// Exercises both slot paths: a mask for 8, a modulo for 5
+template <typename Buffer>
+class StaticCircularBufferTest : public ::testing::Test {};
+
+using Capacities =
+    ::testing::Types<replay_buffer::StaticCircularBuffer<int, 8>,
+                     replay_buffer::StaticCircularBuffer<int, 5>>;
+TYPED_TEST_SUITE(StaticCircularBufferTest, Capacities);
+
+TYPED_TEST(StaticCircularBufferTest, MatchesCircularBuffer) {
+  TypeParam buffer;
+  replay_buffer::CircularBuffer<int> reference(TypeParam::capacity());
+  EXPECT_TRUE(buffer.is_empty());
+  for (int i = 0; i < 23; i++) {
+    EXPECT_EQ(buffer.add(i), reference.add(i));
+    ASSERT_EQ(buffer.size(), reference.size());
+    for (size_t j = 0; j < buffer.size(); j++) {
+      EXPECT_EQ(buffer[j], reference[j]);
+    }
+  }
+  EXPECT_TRUE(buffer.is_full());
+  EXPECT_THROW(buffer.at(TypeParam::capacity()), std::out_of_range);
+}
+
+TYPED_TEST(StaticCircularBufferTest, AddBatchMatchesCircularBuffer) {
+  TypeParam buffer;
+  replay_buffer::CircularBuffer<int> reference(TypeParam::capacity());
+  int next = 0;
+  for (size_t count : {3, 4, 1, 12, 0, 6}) {
+    std::vector<int> items(count);
+    for (int& item : items) {
+      item = next++;
+    }
+    const replay_buffer::IndexRange range = buffer.add_batch(items);
+    const replay_buffer::IndexRange expected = reference.add_batch(items);
+    EXPECT_EQ(range.first, expected.first);
+    EXPECT_EQ(range.count, expected.count);
+    ASSERT_EQ(buffer.size(), reference.size());
+    for (size_t j = 0; j < buffer.size(); j++) {
+      EXPECT_EQ(buffer[j], reference[j]);
+    }
+  }
+}
+
+TYPED_TEST(StaticCircularBufferTest, ClearContinuesAtTail) {
+  TypeParam buffer;
+  buffer.add(1);
+  buffer.add(2);
+  buffer.clear();
+  EXPECT_TRUE(buffer.is_empty());
+  EXPECT_THROW(buffer[0], std::out_of_range);
+  EXPECT_EQ(buffer.add(3), 2);
+  EXPECT_EQ(buffer[0], 3);
+}
+
+TYPED_TEST(StaticCircularBufferTest, SamplesLiveElementsUniformly) {
+  auto buffer = std::make_unique<TypeParam>();
+  EXPECT_THROW(buffer->sample(1), std::invalid_argument);
+  // Partly full, then full after wrapping
+  for (int fill : {3, 20}) {
+    for (int i = 0; i < fill; i++) {
+      buffer->add(i);
+    }
+    const size_t live = buffer->size();
+    std::map<int, int> counts;
+    const int draws = 20000;
+    // A batch may not exceed the number of live elements
+    for (int drawn = 0; drawn < draws; drawn += static_cast<int>(live)) {
+      for (int value : buffer->sample(live)) {
+        counts[value]++;
+      }
+    }
+    ASSERT_EQ(counts.size(), live);
+    for (size_t j = 0; j < live; j++) {
+      EXPECT_NEAR(counts[(*buffer)[j]], draws / static_cast<double>(live),
+                  draws * 0.03);
+    }
+  }
+  EXPECT_THROW(buffer->sample(0), std::invalid_argument);
+  EXPECT_THROW(buffer->sample(TypeParam::capacity() + 1),
+               std::invalid_argument);
+}
@@ -0,0 +1,90 @@
+#include "replay_buffer/static_sum_tree.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "replay_buffer/sum_tree.h"
+
+TEST(StaticSumTreeTest, RoundsLeavesUpToPowerOfTwo) {
+  EXPECT_EQ(replay_buffer::StaticSumTree<1>::kLeaves, 1);
+  EXPECT_EQ(replay_buffer::StaticSumTree<1>::kDepth, 0);
+  EXPECT_EQ(replay_buffer::StaticSumTree<8>::kLeaves, 8);
+  EXPECT_EQ(replay_buffer::StaticSumTree<8>::kDepth, 3);
+  EXPECT_EQ(replay_buffer::StaticSumTree<10>::kLeaves, 16);
+  EXPECT_EQ(replay_buffer::StaticSumTree<10>::capacity(), 10);
+}
+
+TEST(StaticSumTreeTest, MatchesSumTree) {
+  replay_buffer::StaticSumTree<10> tree;
+  replay_buffer::SumTree reference(10);
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> priority(0.0f, 4.0f);
+  for (int step = 0; step < 200; step++) {
+    const size_t index = gen() % 10;
+    const float value = priority(gen);
+    tree.set(index, value);
+    reference.set(index, value);
+    EXPECT_FLOAT_EQ(tree.get(index), value);
+    EXPECT_NEAR(tree.total(), reference.total(), 1e-4f);
+  }
+  for (int draw = 0; draw < 1000; draw++) {
+    const float value =
+        std::uniform_real_distribution<float>(0.0f, tree.total())(gen);
+    const size_t leaf = tree.sample(value);
+    ASSERT_LT(leaf, 10);
+    EXPECT_GT(tree.get(leaf), 0.0f);
+  }
+}
+
+TEST(StaticSumTreeTest, SampleFindsLeafByPrefixSum) {
+  replay_buffer::StaticSumTree<5> tree;
+  for (size_t i = 0; i < 5; i++) {
+    tree.set(i, 1.0f);
+  }
+  EXPECT_EQ(tree.sample(0.0f), 0);
+  EXPECT_EQ(tree.sample(0.5f), 0);
+  EXPECT_EQ(tree.sample(1.0f), 1);
+  EXPECT_EQ(tree.sample(3.5f), 3);
+  EXPECT_EQ(tree.sample(4.5f), 4);
+  // The padding leaves past index 4 are never returned
+  EXPECT_EQ(tree.sample(5.0f), 4);
+  EXPECT_THROW(tree.sample(5.5f), std::out_of_range);
+  EXPECT_THROW(tree.sample(-1.0f), std::out_of_range);
+}
+
+TEST(StaticSumTreeTest, SingleLeaf) {
+  replay_buffer::StaticSumTree<1> tree;
+  tree.set(0, 2.0f);
+  EXPECT_FLOAT_EQ(tree.total(), 2.0f);
+  EXPECT_EQ(tree.sample(1.0f), 0);
+}
+
+TEST(StaticSumTreeTest, SetRangeAndBuildMatchSets) {
+  const std::vector<float> priorities = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+  replay_buffer::StaticSumTree<12> by_set;
+  for (size_t i = 0; i < priorities.size(); i++) {
+    by_set.set(i, priorities[i]);
+  }
+  replay_buffer::StaticSumTree<12> by_range;
+  by_range.set_range(0, std::span(priorities).first(4));
+  by_range.set_range(4, std::span(priorities).subspan(4));
+  replay_buffer::StaticSumTree<12> by_build;
+  by_build.set(11, 9.0f);  // cleared by build()
+  by_build.build(priorities);
+
+  for (const auto* tree : {&by_range, &by_build}) {
+    EXPECT_FLOAT_EQ(tree->total(), by_set.total());
+    for (float value : {0.0f, 10.5f, 40.0f, 65.9f}) {
+      EXPECT_EQ(tree->sample(value), by_set.sample(value));
+    }
+  }
+  EXPECT_FLOAT_EQ(by_build.get(11), 0.0f);
+  EXPECT_THROW(by_range.set_range(10, std::span(priorities).first(3)),
+               std::out_of_range);
+  EXPECT_THROW(by_build.build(std::vector<float>(13, 1.0f)),
+               std::invalid_argument);
+  EXPECT_THROW(by_set.set(12, 1.0f), std::out_of_range);
+}
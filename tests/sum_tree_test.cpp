@@ -2,8 +2,10 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <random>
 #include <stdexcept>
+#include <vector>
 
 TEST(SumTreeConstructionTest, ValidCapacity) {
   replay_buffer::SumTree tree(10);
@@ -63,6 +65,25 @@ TEST(SumTreePropagationTest, SamplingVerifiesTreeStructure) {
   EXPECT_EQ(tree.sample(9.9f), 3);
 }
 
+TEST(SumTreePropagationTest, TotalDoesNotDriftUnderUpdates) {
+  constexpr size_t kCapacity = 1000;
+  replay_buffer::SumTree tree(kCapacity);
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> priority(0.0f, 100.0f);
+  std::uniform_int_distribution<size_t> index(0, kCapacity - 1);
+  for (int i = 0; i < 1000000; i++) {
+    tree.set(index(gen), priority(gen));
+  }
+
+  // Parents are recomputed from their children, so a million updates leave
+  // the tree bit-identical to one built from the final leaves alone
+  replay_buffer::SumTree fresh(kCapacity);
+  for (size_t i = 0; i < kCapacity; i++) {
+    fresh.set(i, tree.get(i));
+  }
+  EXPECT_EQ(tree.total(), fresh.total());
+}
+
 TEST(SumTreeSampleTest, SampleDistribution) {
   replay_buffer::SumTree tree(4);
 
@@ -130,3 +151,73 @@ TEST(SumTreeEdgeCaseTest, SingleElementCapacity) {
   EXPECT_EQ(tree.sample(0.5f), 0);
   EXPECT_EQ(tree.sample(4.9f), 0);
 }
+
+TEST(SumTreeSetRangeTest, MatchesIndividualSets) {
+  // Non power-of-two capacities have leaves on two depths
+  for (size_t capacity : {1, 2, 5, 8, 13, 100}) {
+    replay_buffer::SumTree batched(capacity);
+    replay_buffer::SumTree single(capacity);
+    std::mt19937 gen(static_cast<unsigned>(capacity));
+    std::uniform_real_distribution<float> dist(0.0f, 10.0f);
+    for (size_t first = 0; first < capacity; first += 3) {
+      const size_t count = std::min<size_t>(capacity - first, first % 7 + 1);
+      std::vector<float> priorities(count);
+      for (size_t i = 0; i < count; i++) {
+        priorities[i] = dist(gen);
+        single.set(first + i, priorities[i]);
+      }
+      batched.set_range(first, priorities);
+      ASSERT_NEAR(batched.total(), single.total(), 1e-3f) << capacity;
+    }
+    for (float value = 0.0f; value < single.total(); value += 0.37f) {
+      EXPECT_EQ(batched.sample(value), single.sample(value));
+    }
+  }
+}
+
+TEST(SumTreeSetRangeTest, OutOfRangeThrows) {
+  replay_buffer::SumTree tree(4);
+  const std::vector<float> priorities = {1.0f, 2.0f};
+  EXPECT_THROW(tree.set_range(3, priorities), std::out_of_range);
+  EXPECT_THROW(tree.set_range(5, {}), std::out_of_range);
+  EXPECT_NO_THROW(tree.set_range(2, priorities));
+  EXPECT_FLOAT_EQ(tree.total(), 3.0f);
+}
+
+TEST(SumTreeBuildTest, MatchesIndividualSets) {
+  // Small integers keep every partial sum exact in float. The larger
+  // capacity reduces its bottom levels on several threads.
+  for (size_t capacity : {size_t{1}, size_t{7}, size_t{1000},
+                          (size_t{1} << 20) + 3}) {
+    std::vector<float> priorities(capacity);
+    for (size_t i = 0; i < capacity; i++) {
+      priorities[i] = static_cast<float>(i % 5);
+    }
+    replay_buffer::SumTree built(capacity);
+    built.build(priorities);
+    replay_buffer::SumTree set(capacity);
+    for (size_t i = 0; i < capacity; i++) {
+      set.set(i, priorities[i]);
+    }
+
+    ASSERT_EQ(built.total(), set.total()) << "capacity " << capacity;
+    for (float value = 0.0f; value < set.total();
+         value += set.total() / 97.0f) {
+      EXPECT_EQ(built.sample(value), set.sample(value));
+    }
+    EXPECT_EQ(built.get(capacity - 1), priorities[capacity - 1]);
+  }
+}
+
+TEST(SumTreeBuildTest, ShortInputZeroesRemainingLeaves) {
+  replay_buffer::SumTree tree(8);
+  const std::vector<float> all(8, 1.0f);
+  tree.build(all);
+  const std::vector<float> some = {2.0f, 3.0f};
+  tree.build(some);
+  EXPECT_FLOAT_EQ(tree.total(), 5.0f);
+  EXPECT_FLOAT_EQ(tree.get(7), 0.0f);
+
+  const std::vector<float> too_many(9, 1.0f);
+  EXPECT_THROW(tree.build(too_many), std::invalid_argument);
+}
@@ -0,0 +1,68 @@
+#include "replay_buffer/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(ThreadPoolTest, RunsEveryTaskOnce) {
+  replay_buffer::ThreadPool pool(3);
+  EXPECT_EQ(pool.size(), 3);
+  std::vector<std::atomic<int>> runs(100);
+  pool.parallel_for(runs.size(), [&](size_t task) { runs[task]++; });
+  for (const std::atomic<int>& count : runs) {
+    EXPECT_EQ(count.load(), 1);
+  }
+}
+
+TEST(ThreadPoolTest, EmptyPoolRunsInline) {
+  replay_buffer::ThreadPool pool(0);
+  const std::thread::id caller = std::this_thread::get_id();
+  int runs = 0;
+  pool.parallel_for(5, [&](size_t) {
+    EXPECT_EQ(std::this_thread::get_id(), caller);
+    runs++;
+  });
+  EXPECT_EQ(runs, 5);
+}
+
+TEST(ThreadPoolTest, TaskCountRespectsMinimumAndThreads) {
+  replay_buffer::ThreadPool pool(3);
+  EXPECT_EQ(pool.task_count(100, 1000), 1);
+  EXPECT_EQ(pool.task_count(2500, 1000), 2);
+  EXPECT_EQ(pool.task_count(100000, 1000), 4);
+}
+
+TEST(ThreadPoolTest, RethrowsTaskException) {
+  replay_buffer::ThreadPool pool(2);
+  std::atomic<int> runs{0};
+  EXPECT_THROW(pool.parallel_for(10,
+                                 [&](size_t task) {
+                                   runs++;
+                                   if (task == 3) {
+                                     throw std::runtime_error("task failed");
+                                   }
+                                 }),
+               std::runtime_error);
+  // The other tasks still ran
+  EXPECT_EQ(runs.load(), 10);
+}
+
+TEST(ThreadPoolTest, ConcurrentCallers) {
+  replay_buffer::ThreadPool pool(2);
+  std::atomic<int> total{0};
+  std::vector<std::thread> callers;
+  for (int i = 0; i < 4; i++) {
+    callers.emplace_back([&]() {
+      for (int j = 0; j < 50; j++) {
+        pool.parallel_for(8, [&](size_t) { total++; });
+      }
+    });
+  }
+  for (std::thread& caller : callers) {
+    caller.join();
+  }
+  EXPECT_EQ(total.load(), 4 * 50 * 8);
+}
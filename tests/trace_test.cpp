@@ -0,0 +1,182 @@
+#include "replay_buffer/trace.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "replay_buffer/circular_buffer.h"
+#include "replay_buffer/prioritized_replay_buffer.h"
+#include "replay_buffer/sum_tree.h"
+
+static_assert(replay_buffer::kTracingEnabled,
+              "trace_test must be built with REPLAY_BUFFER_ENABLE_TRACING");
+
+namespace {
+// Tracing state is process-wide, so every test starts from an empty trace
+class TraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    replay_buffer::set_tracing_enabled(false);
+    replay_buffer::clear_trace();
+  }
+
+  void TearDown() override { replay_buffer::set_tracing_enabled(false); }
+};
+
+std::map<std::string, size_t> count_by_name(
+    const std::vector<replay_buffer::TraceEvent>& events) {
+  std::map<std::string, size_t> counts;
+  for (const replay_buffer::TraceEvent& event : events) {
+    counts[event.name]++;
+  }
+  return counts;
+}
+}  // namespace
+
+TEST_F(TraceTest, RecordsNothingWhileSwitchedOff) {
+  replay_buffer::CircularBuffer<int> buffer(4);
+  buffer.add(1);
+  buffer.sample(1);
+  EXPECT_FALSE(replay_buffer::tracing_enabled());
+  EXPECT_TRUE(replay_buffer::collect_trace().empty());
+}
+
+TEST_F(TraceTest, RecordsBufferOperations) {
+  replay_buffer::set_tracing_enabled(true);
+  replay_buffer::CircularBuffer<int> buffer(4);
+  for (int i = 0; i < 3; i++) {
+    buffer.add(i);
+  }
+  buffer.sample(2);
+  replay_buffer::SumTree tree(4);
+  tree.set(0, 1.0f);
+  tree.sample(0.5f);
+  replay_buffer::PrioritizedReplayBufferConfig config;
+  config.capacity = 4;
+  replay_buffer::PrioritizedReplayBuffer<int> prioritized(config);
+  prioritized.add(0);
+  prioritized.update_priorities(std::vector<size_t>{0}, {0.5f});
+
+  const auto counts = count_by_name(replay_buffer::collect_trace());
+  EXPECT_EQ(counts.at("CircularBuffer::add"), 4);
+  EXPECT_EQ(counts.at("CircularBuffer::sample"), 1);
+  EXPECT_EQ(counts.at("CircularBuffer::lock_wait"), 5);
+  EXPECT_EQ(counts.at("PrioritizedReplayBuffer::update_priorities"), 1);
+  EXPECT_EQ(counts.at("PrioritizedReplayBuffer::lock_wait"), 1);
+  EXPECT_GE(counts.at("SumTree::set"), 2);
+  EXPECT_EQ(counts.at("SumTree::sample"), 1);
+}
+
+TEST_F(TraceTest, LockWaitNestsInsideItsOperation) {
+  replay_buffer::set_tracing_enabled(true);
+  replay_buffer::CircularBuffer<int> buffer(4);
+  buffer.add(1);
+
+  const auto events = replay_buffer::collect_trace();
+  ASSERT_EQ(events.size(), 2);
+  // The inner span ends, and so is recorded, first
+  EXPECT_STREQ(events[0].name, "CircularBuffer::lock_wait");
+  EXPECT_STREQ(events[1].name, "CircularBuffer::add");
+  EXPECT_GE(events[0].start_ns, events[1].start_ns);
+  EXPECT_LE(events[0].start_ns + events[0].duration_ns,
+            events[1].start_ns + events[1].duration_ns);
+}
+
+TEST_F(TraceTest, RingKeepsLatestSpans) {
+  replay_buffer::set_tracing_enabled(true);
+  const size_t capacity = replay_buffer::detail::TraceRing::kCapacity;
+  for (size_t i = 0; i < capacity + 10; i++) {
+    replay_buffer::TraceSpan span(i < 10 ? "old" : "new");
+  }
+
+  const auto counts = count_by_name(replay_buffer::collect_trace());
+  EXPECT_EQ(counts.size(), 1);
+  EXPECT_EQ(counts.at("new"), capacity);
+
+  replay_buffer::clear_trace();
+  EXPECT_TRUE(replay_buffer::collect_trace().empty());
+}
+
+TEST_F(TraceTest, KeepsSpansOfExitedThreadsApart) {
+  replay_buffer::set_tracing_enabled(true);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([]() {
+      for (int i = 0; i < 10; i++) {
+        replay_buffer::TraceSpan span("worker");
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  std::map<uint32_t, size_t> per_thread;
+  for (const replay_buffer::TraceEvent& event :
+       replay_buffer::collect_trace()) {
+    per_thread[event.thread]++;
+  }
+  ASSERT_EQ(per_thread.size(), 4);
+  for (const auto& [thread, count] : per_thread) {
+    EXPECT_EQ(count, 10);
+  }
+}
+
+TEST_F(TraceTest, CollectsWhileThreadsRecord) {
+  replay_buffer::set_tracing_enabled(true);
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 2; t++) {
+    writers.emplace_back([&stop]() {
+      while (!stop.load()) {
+        replay_buffer::TraceSpan span("busy");
+      }
+    });
+  }
+  for (int i = 0; i < 50; i++) {
+    const auto events = replay_buffer::collect_trace();
+    std::map<uint32_t, uint64_t> last_start;
+    for (const replay_buffer::TraceEvent& event : events) {
+      // A slot torn by a concurrent overwrite would show up out of order
+      ASSERT_STREQ(event.name, "busy");
+      EXPECT_GE(event.start_ns, last_start[event.thread]);
+      last_start[event.thread] = event.start_ns;
+    }
+  }
+  stop = true;
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+}
+
+TEST_F(TraceTest, WritesChromeTraceJson) {
+  const std::vector<replay_buffer::TraceEvent> events = {
+      {"SumTree::set", 0, 1500, 250}, {"say \"hi\"", 1, 3000, 1000}};
+  std::ostringstream out;
+  replay_buffer::write_chrome_trace(out, events);
+  const std::string json = out.str();
+
+  EXPECT_EQ(json.rfind("{\"traceEvents\":[", 0), 0);
+  EXPECT_NE(json.find("\"name\":\"SumTree::set\",\"cat\":\"replay_buffer\","
+                      "\"ph\":\"X\""),
+            std::string::npos);
+  EXPECT_NE(json.find("\"tid\":0,\"ts\":1.500,\"dur\":0.250}"),
+            std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"say \\\"hi\\\"\""), std::string::npos);
+  EXPECT_NE(json.find("\"tid\":1,\"ts\":3.000,\"dur\":1.000}"),
+            std::string::npos);
+}
+
+TEST_F(TraceTest, DumpsRecordedSpans) {
+  replay_buffer::set_tracing_enabled(true);
+  replay_buffer::SumTree tree(2);
+  tree.set(1, 2.0f);
+  std::ostringstream out;
+  replay_buffer::write_chrome_trace(out);
+  EXPECT_NE(out.str().find("SumTree::set"), std::string::npos);
+}